@@ -23,6 +23,7 @@
 
 #include "Log.h"
 #include "LogUtil.h"
+#include <cstring>
 
 nowtech::Chunk& nowtech::Chunk::operator=(nowtech::Chunk&& aChunk) noexcept {
   mOsInterface = aChunk.mOsInterface;
@@ -32,6 +33,9 @@ nowtech::Chunk& nowtech::Chunk::operator=(nowtech::Chunk&& aChunk) noexcept {
   mBufferBytes = aChunk.mBufferBytes;
   mBlocks = aChunk.mBlocks;
   mIndex = aChunk.mIndex;
+  mDropped = aChunk.mDropped;
+  mAdmitted = aChunk.mAdmitted;
+  mDroppedBytes = aChunk.mDroppedBytes;
   aChunk.mOsInterface = nullptr;
   aChunk.mOrigin = nullptr;
   aChunk.mChunk = nullptr;
@@ -42,7 +46,16 @@ void nowtech::Chunk::push(char const mChar) noexcept {
   mChunk[mIndex] = mChar;
   ++mIndex;
   if(mIndex == mChunkSize) {
-    mOsInterface->push(mChunk, mBlocks);
+    if(mDropped) {
+      mDroppedBytes += mChunkSize - 1u;
+    }
+    else if(mOsInterface->push(mChunk, mBlocks)) {
+      mAdmitted = true;
+    }
+    else {
+      mDropped = true;
+      mDroppedBytes += mChunkSize - 1u;
+    }
     mIndex = 1u;
   }
   else { // nothing to do
@@ -76,9 +89,19 @@ constexpr nowtech::LogFormat nowtech::LogConfig::cX6;
 constexpr nowtech::LogFormat nowtech::LogConfig::cX8;
 
 constexpr char nowtech::Log::cUnknownApplicationName[cNameLength];
+constexpr char nowtech::Log::cSeparatorFailure;
+constexpr char nowtech::Log::cHeaderKeyframe;
+constexpr char nowtech::Log::cHeaderDelta;
+constexpr char nowtech::Log::cHeaderTask;
+constexpr char nowtech::Log::cHeaderTopic;
+constexpr char nowtech::Log::cTopicTag;
+constexpr nowtech::LogSizeType nowtech::Log::cTopicTagLength;
+constexpr char nowtech::Log::cSequenceTag;
+constexpr nowtech::LogSizeType nowtech::Log::cSequenceTagLength;
+constexpr char nowtech::Log::cIsrTaskNameString[];
 constexpr char nowtech::Log::cDigit2char[nowtech::NumericSystem::cHexadecimal];
 
-std::atomic<nowtech::LogTopicType> nowtech::Log::sNextFreeTopic;
+std::atomic<nowtech::LogTopicType> nowtech::Log::sNextFreeTopic(cFirstFreeTopic);
 nowtech::Log *nowtech::Log::sInstance;
 
 nowtech::LogShiftChainHelper& nowtech::LogShiftChainHelper::operator<<(LogShiftChainMarker const) noexcept {
@@ -90,16 +113,137 @@ nowtech::LogShiftChainHelper& nowtech::LogShiftChainHelper::operator<<(LogShiftC
   return *this;
 }
 
+nowtech::WallClockCache::WallClockCache() noexcept {
+  mSequence.store(0u);
+  mSecond.store(UINT64_MAX);
+  for(uint32_t i = 0u; i < cWords; ++i) {
+    mWords[i].store(0u);
+  }
+}
+
+bool nowtech::WallClockCache::read(uint64_t const aSecond, Entry &aEntry) const noexcept {
+  uint32_t const sequence = mSequence.load(std::memory_order_acquire);
+  bool result = (sequence & 1u) == 0u && mSecond.load(std::memory_order_relaxed) == aSecond;
+  if(result) {
+    uint64_t words[cWords];
+    for(uint32_t i = 0u; i < cWords; ++i) {
+      words[i] = mWords[i].load(std::memory_order_relaxed);
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    result = mSequence.load(std::memory_order_relaxed) == sequence;
+    std::memcpy(&aEntry, words, sizeof(aEntry));
+  }
+  else { // nothing to do
+  }
+  return result;
+}
+
+void nowtech::WallClockCache::write(uint64_t const aSecond, Entry const &aEntry) noexcept {
+  uint32_t sequence = mSequence.load(std::memory_order_relaxed);
+  if((sequence & 1u) == 0u && mSequence.compare_exchange_strong(sequence, sequence + 1u, std::memory_order_acquire)) {
+    std::atomic_thread_fence(std::memory_order_release);
+    uint64_t words[cWords] = {};
+    std::memcpy(words, &aEntry, sizeof(aEntry));
+    mSecond.store(aSecond, std::memory_order_relaxed);
+    for(uint32_t i = 0u; i < cWords; ++i) {
+      mWords[i].store(words[i], std::memory_order_relaxed);
+    }
+    mSequence.store(sequence + 2u, std::memory_order_release);
+  }
+  else { // nothing to do
+  }
+}
+
+namespace {
+  constexpr uint32_t cSecondsPerMinute = 60u;
+  constexpr uint32_t cSecondsPerHour   = 3600u;
+  constexpr uint32_t cSecondsPerDay    = 86400u;
+  constexpr uint64_t cNsPerSec         = 1000000000u;
+
+  void render2(char * const aWhere, uint32_t const aValue) noexcept {
+    aWhere[0] = static_cast<char>('0' + aValue / 10u);
+    aWhere[1] = static_cast<char>('0' + aValue % 10u);
+  }
+}
+
+void nowtech::WallClockCache::render(uint64_t const aSecond, int32_t const aUtcOffset, bool const aLocal, Entry &aEntry) noexcept {
+  int64_t const offset = aLocal ? aUtcOffset : 0;
+  int64_t const local = static_cast<int64_t>(aSecond) + offset;
+  aEntry.utcOffset = static_cast<int32_t>(offset);
+  uint64_t const second = local > 0 ? static_cast<uint64_t>(local) : 0u;
+  // Civil date from days since the epoch in the proleptic Gregorian calendar.
+  uint64_t const shifted = second / cSecondsPerDay + 719468u;
+  uint64_t const era = shifted / 146097u;
+  uint64_t const dayOfEra = shifted - era * 146097u;
+  uint64_t const yearOfEra = (dayOfEra - dayOfEra / 1460u + dayOfEra / 36524u - dayOfEra / 146096u) / 365u;
+  uint64_t const dayOfYear = dayOfEra - (365u * yearOfEra + yearOfEra / 4u - yearOfEra / 100u);
+  uint64_t const monthIndex = (5u * dayOfYear + 2u) / 153u;
+  uint32_t const day = static_cast<uint32_t>(dayOfYear - (153u * monthIndex + 2u) / 5u + 1u);
+  uint32_t const month = static_cast<uint32_t>(monthIndex < 10u ? monthIndex + 3u : monthIndex - 9u);
+  uint32_t const year = static_cast<uint32_t>(yearOfEra + era * 400u + (month <= 2u ? 1u : 0u)) % 10000u;
+  uint32_t const timeOfDay = static_cast<uint32_t>(second % cSecondsPerDay);
+  render2(aEntry.dateTime, year / 100u);
+  render2(aEntry.dateTime + 2u, year % 100u);
+  aEntry.dateTime[4] = '-';
+  render2(aEntry.dateTime + 5u, month);
+  aEntry.dateTime[7] = '-';
+  render2(aEntry.dateTime + 8u, day);
+  aEntry.dateTime[10] = 'T';
+  render2(aEntry.dateTime + 11u, timeOfDay / cSecondsPerHour);
+  aEntry.dateTime[13] = ':';
+  render2(aEntry.dateTime + 14u, timeOfDay % cSecondsPerHour / cSecondsPerMinute);
+  aEntry.dateTime[16] = ':';
+  render2(aEntry.dateTime + 17u, timeOfDay % cSecondsPerMinute);
+  if(aLocal) {
+    uint32_t const magnitude = static_cast<uint32_t>(offset < 0 ? -offset : offset) / cSecondsPerMinute;
+    aEntry.zone[0] = offset < 0 ? '-' : '+';
+    render2(aEntry.zone + 1u, magnitude / 60u % 100u);
+    aEntry.zone[3] = ':';
+    render2(aEntry.zone + 4u, magnitude % 60u);
+    aEntry.zoneLength = cMaxZoneLength;
+  }
+  else {
+    aEntry.zone[0] = 'Z';
+    aEntry.zoneLength = 1u;
+  }
+}
+
 nowtech::Log::Log(LogOsInterface &aOsInterface, LogConfig const &aConfig) noexcept
+  : Log(aOsInterface, aConfig, nullptr) {
+}
+
+nowtech::Log::Log(LogOsInterface &aOsInterface, LogConfig const &aConfig, LogStorage const &aStorage) noexcept
+  : Log(aOsInterface, aConfig, &aStorage) {
+}
+
+nowtech::Log::Log(LogOsInterface &aOsInterface, LogConfig const &aConfig, LogStorage const * const aStorage) noexcept
   : mOsInterface(aOsInterface)
   , mConfig(aConfig)
-  , mChunkSize(aConfig.chunkSize) {
-  sInstance = this;
-  sNextFreeTopic.store(cFirstFreeTopic);
+  , mChunkSize(aConfig.chunkSize)
+  , mTickOrigin(aConfig.relativeTick ? readTick() : 0u)
+  , mStorage(aStorage) {
+  if(sInstance == nullptr) {
+    sInstance = this;
+  }
+  else { // nothing to do
+  }
+  mDroppedMessages.store(0u);
+  mDroppedBytes.store(0u);
   mKeepRunning.store(true);
+  mParkRequested.store(false);
+  mParked.store(false);
+  mTransmitterThreadId.store(0u);
+  mFlushRequested.store(0u);
+  mFlushCompleted.store(0u);
+  mNextSequence.store(0u);
+  mCircularBuffer.store(nullptr);
+  mTransmitBuffers.store(nullptr);
+  for(uint32_t i = 0u; i < cTaskSlotCount; ++i) {
+    mTaskSlotIds[i].store(Chunk::cInvalidTaskId, std::memory_order_relaxed);
+  }
   mOsInterface.createTransmitterThread(this, logTransmitterThreadFunction);
   if(aConfig.allowShiftChainingCalls) {
-    mShiftChainingCallBuffers = new char[(std::numeric_limits<TaskIdType>::max() + static_cast<LogSizeType>(1u)) * mChunkSize];
+    mShiftChainingCallBuffers = (aStorage == nullptr ? new char[LogStorage::getShiftChainingCallBufferSize(mChunkSize)] : aStorage->shiftChainingCallBuffers);
   }
   else { // nothing to do
   }
@@ -114,9 +258,10 @@ void nowtech::Log::doRegisterCurrentTask(char const * const aTaskName) noexcept
     else { // nothing to do
     }
     uint32_t taskHandle = mOsInterface.getCurrentThreadId();
-    auto found = mTaskIds.find(taskHandle);
-    if(found == mTaskIds.end()) {
-      mTaskIds[taskHandle] = mNextTaskId;
+    uint32_t const slot = findTaskSlot(taskHandle);
+    if(mTaskSlotIds[slot].load(std::memory_order_relaxed) == Chunk::cInvalidTaskId) {
+      mTaskHandles[slot] = taskHandle;
+      mTaskSlotIds[slot].store(mNextTaskId, std::memory_order_release);
       if(mConfig.allowRegistrationLog) {
         send("-=- Registered task: ", mOsInterface.getThreadName(taskHandle), " (", mNextTaskId, ") -=-");
       }
@@ -135,20 +280,69 @@ nowtech::TaskIdType nowtech::Log::getCurrentTaskId() const noexcept {
     return Chunk::cIsrTaskId;
   }
   else {
-    auto found = mTaskIds.find(mOsInterface.getCurrentThreadId());
-    return found == mTaskIds.end() ? Chunk::cInvalidTaskId : found->second;
+    return mTaskSlotIds[findTaskSlot(mOsInterface.getCurrentThreadId())].load(std::memory_order_acquire);
+  }
+}
+
+uint32_t nowtech::Log::findTaskSlot(uint32_t const aHandle) const noexcept {
+  uint32_t slot = (aHandle * cTaskHashMultiplier) >> (std::numeric_limits<uint32_t>::digits - cTaskSlotBits);
+  // The table never gets more than half full, so an empty slot ends the probing.
+  while(mTaskSlotIds[slot].load(std::memory_order_acquire) != Chunk::cInvalidTaskId && mTaskHandles[slot] != aHandle) {
+    slot = (slot + 1u) & (cTaskSlotCount - 1u);
   }
+  return slot;
 }
 
 void nowtech::Log::transmitterThreadFunction() noexcept {
   // we assume all the buffers are valid
-  CircularBuffer circularBuffer(mOsInterface, mConfig.circularBufferLength, mChunkSize);
-  TransmitBuffers transmitBuffers(mOsInterface, mConfig.transmitBufferLength, mChunkSize);
+  CircularBuffer circularBuffer(mOsInterface, mConfig.circularBufferLength, mChunkSize, mStorage == nullptr ? nullptr : mStorage->circularBuffer);
+  TransmitBuffers transmitBuffers(mOsInterface, mConfig.transmitBufferLength, mConfig.transmitBufferCount, mChunkSize, mStorage);
+  if(mConfig.compactHeader && !mConfig.binaryFormat && !mConfig.emitTopicTags) {
+    transmitBuffers.enableCompactHeader(mConfig.tickFormat.base, mConfig.keyframePeriod);
+  }
+  else { // nothing to do
+  }
+  transmitBuffers.enableFlush(&mFlushCompleted);
+  uint32_t reportedDroppedMessages = 0u;
+  uint32_t reportedDroppedBytes = 0u;
+  uint32_t reportedTransmitErrors = 0u;
+  mCircularBuffer.store(&circularBuffer);
+  mTransmitBuffers.store(&transmitBuffers);
+  mTransmitterThreadId.store(mOsInterface.getCurrentThreadId());
   while(mKeepRunning.load()) {
+    if(mParkRequested.load()) {
+      // The buffers handed over to the OsInterface are not drained.
+      while(transmitBuffers.isTransmitting()) {
+        mOsInterface.pause();
+      }
+      mParked.store(true);
+      while(mKeepRunning.load()) {
+        mOsInterface.pause();
+      }
+      break;
+    }
+    else { // nothing to do
+    }
+    if(!transmitBuffers.hasActiveTask() && mDroppedMessages.load() != reportedDroppedMessages) {
+      uint32_t droppedMessages = mDroppedMessages.load();
+      uint32_t droppedBytes = mDroppedBytes.load();
+      reportDrop(transmitBuffers, droppedMessages - reportedDroppedMessages, droppedBytes - reportedDroppedBytes);
+      reportedDroppedMessages = droppedMessages;
+      reportedDroppedBytes = droppedBytes;
+    }
+    else { // nothing to do
+    }
+    if(!transmitBuffers.hasActiveTask() && mOsInterface.getTransmitErrorCount() != reportedTransmitErrors) {
+      uint32_t transmitErrors = mOsInterface.getTransmitErrorCount();
+      reportTransmitErrors(transmitBuffers, transmitErrors - reportedTransmitErrors, mOsInterface.getLastTransmitError());
+      reportedTransmitErrors = transmitErrors;
+    }
+    else { // nothing to do
+    }
     // At this point the transmitBuffers must have free space for a chunk
     if(!transmitBuffers.hasActiveTask()) {
       if(circularBuffer.isEmpty()) {
-        static_cast<void>(transmitBuffers << circularBuffer.fetch());
+        transmitBuffers.popDirectly();
       }
       else { // the circularbuffer may be full or not
         static_cast<void>(transmitBuffers << circularBuffer.peek());
@@ -206,14 +400,231 @@ void nowtech::Log::transmitterThreadFunction() noexcept {
     }
     transmitBuffers.transmitIfNeeded();
   }
+  mTransmitterThreadId.store(0u);
+  mTransmitBuffers.store(nullptr);
+  mCircularBuffer.store(nullptr);
+}
+
+bool nowtech::Log::flush(Log &aLog, uint32_t const aTimeout) noexcept {
+  static constexpr uint32_t cFlushPollPeriod = 1u;
+  bool result = true;
+  if(aLog.mChunkSize < Chunk::cFlushMarkerLength) {
+    result = false;
+  }
+  else if(aLog.mOsInterface.hasTransmitterThread()) {
+    char marker[aLog.mChunkSize];
+    std::memset(marker, 0, aLog.mChunkSize);
+    TaskIdType const taskId = aLog.getCurrentTaskId();
+    marker[0] = static_cast<char>(taskId == Chunk::cInvalidTaskId ? Chunk::cIsrTaskId : taskId);
+    marker[1] = Chunk::cFlushMarker;
+    uint32_t ticket = 0u;
+    uint32_t waited = 0u;
+    bool pushed = false;
+    while(!pushed && waited <= aTimeout) {
+      // The lock keeps the tickets in the order of the markers in the queue.
+      // The push does not block, so the lock is not held while the queue is
+      // full. A ticket whose marker could not be pushed is skipped.
+      aLog.mOsInterface.lock();
+      ticket = aLog.mFlushRequested.fetch_add(1u) + 1u;
+      std::memcpy(marker + 2u, &ticket, sizeof(ticket));
+      pushed = aLog.mOsInterface.push(marker, false);
+      aLog.mOsInterface.unlock();
+      if(!pushed) {
+        aLog.mOsInterface.sleep(cFlushPollPeriod);
+        waited += cFlushPollPeriod;
+      }
+      else { // nothing to do
+      }
+    }
+    result = pushed;
+    // Tells if mFlushCompleted is still before the ticket, even after wrapping around.
+    for(; result && aLog.mFlushCompleted.load() - ticket > std::numeric_limits<uint32_t>::max() / 2u; waited += cFlushPollPeriod) {
+      if(waited < aTimeout) {
+        aLog.mOsInterface.sleep(cFlushPollPeriod);
+      }
+      else {
+        result = false;
+      }
+    }
+  }
+  else { // nothing to do
+  }
+  return result;
 }
 
-nowtech::LogShiftChainHelper nowtech::Log::i() noexcept {
-  if(sInstance->mShiftChainingCallBuffers != nullptr) {
-    nowtech::TaskIdType taskId = sInstance->getCurrentTaskId();
-    nowtech::Chunk appender = sInstance->startSend(sInstance->mShiftChainingCallBuffers + (taskId * sInstance->mChunkSize), taskId);
+void nowtech::Log::parkTransmitter(Log &aLog) noexcept {
+  aLog.mParkRequested.store(true);
+}
+
+bool nowtech::Log::isTransmitterParked(Log const &aLog) noexcept {
+  uint32_t const transmitterThreadId = aLog.mTransmitterThreadId.load();
+  return transmitterThreadId == 0u || aLog.mParked.load() || transmitterThreadId == aLog.mOsInterface.getCurrentThreadId();
+}
+
+void nowtech::Log::drainAfterCrash(Log &aLog, char * const aChunks, bool * const aUsed, LogSizeType const aCapacity, LogCrashWrite const aWrite) noexcept {
+  LogSizeType const chunkSize = aLog.mChunkSize;
+  LogSizeType count = 0u;
+  CircularBuffer * const circularBuffer = aLog.mCircularBuffer.load();
+  if(circularBuffer != nullptr) {
+    Chunk chunk = circularBuffer->peek();
+    for(LogSizeType i = 0u; i < circularBuffer->getCount() && count < aCapacity; ++i) {
+      if(chunk.getTaskId() != Chunk::cInvalidTaskId) {
+        std::memcpy(aChunks + count * chunkSize, chunk.getData(), chunkSize);
+        ++count;
+      }
+      else { // removed after inspection
+      }
+      ++chunk;
+    }
+  }
+  else { // nothing to do
+  }
+  while(count < aCapacity && aLog.mOsInterface.tryPop(aChunks + count * chunkSize)) {
+    if(*reinterpret_cast<TaskIdType*>(aChunks + count * chunkSize) != Chunk::cInvalidTaskId) {
+      ++count;
+    }
+    else { // nothing to do
+    }
+  }
+  for(LogSizeType i = 0u; i < count; ++i) {
+    aUsed[i] = false;
+  }
+  TransmitBuffers * const transmitBuffers = aLog.mTransmitBuffers.load();
+  if(transmitBuffers != nullptr) {
+    transmitBuffers->drain(aWrite);
+    if(transmitBuffers->hasActiveTask()) {
+      aLog.drainMessage(aChunks, aUsed, count, 0u, transmitBuffers->getActiveTaskId(), true, aWrite);
+    }
+    else { // nothing to do
+    }
+  }
+  else { // nothing to do
+  }
+  for(LogSizeType i = 0u; i < count; ++i) {
+    if(!aUsed[i]) {
+      aLog.drainMessage(aChunks, aUsed, count, i, *reinterpret_cast<TaskIdType*>(aChunks + i * chunkSize), false, aWrite);
+    }
+    else { // nothing to do
+    }
+  }
+}
+
+void nowtech::Log::drainMessage(char const * const aChunks, bool * const aUsed, LogSizeType const aCount, LogSizeType const aFrom
+  , TaskIdType const aTaskId, bool const aStarted, LogCrashWrite const aWrite) noexcept {
+  static constexpr char cTruncated[] = { cSeparatorFailure, Chunk::cEndOfLine };
+  bool started = aStarted;
+  bool ended = false;
+  for(LogSizeType i = aFrom; i < aCount && !ended; ++i) {
+    char const * const chunk = aChunks + i * mChunkSize;
+    if(!aUsed[i] && *reinterpret_cast<TaskIdType const*>(chunk) == aTaskId) {
+      aUsed[i] = true;
+      if(chunk[1] == Chunk::cFlushMarker) {
+        // Belongs to no message, its ticket is not text.
+      }
+      else if(chunk[1] == Chunk::cAbortMessage) {
+        ended = true;
+      }
+      else {
+        LogSizeType const first = chunk[1] == Chunk::cSingleChunk ? 2u : 1u;
+        LogSizeType length = first;
+        while(length < mChunkSize && chunk[length] != Chunk::cEndOfMessage) {
+          ++length;
+        }
+        aWrite(chunk + first, length - first);
+        started = true;
+        if(length < mChunkSize) {
+          // Only the line end.
+          aWrite(cTruncated + 1u, 1u);
+          started = false;
+          ended = true;
+        }
+        else { // nothing to do
+        }
+      }
+    }
+    else { // nothing to do
+    }
+  }
+  if(started) {
+    aWrite(cTruncated, sizeof(cTruncated));
+  }
+  else { // nothing to do
+  }
+}
+
+void nowtech::Log::reportDrop(TransmitBuffers &aTransmitBuffers, uint32_t const aMessages, uint32_t const aBytes) noexcept {
+  // -=- 4294967295 messages dropped (4294967295 bytes) -=-
+  char marker[cDropMarkerLength];
+  char *end = marker;
+  end = render(end, "-=- ");
+  end = render(end, aMessages);
+  end = render(end, " messages dropped (");
+  end = render(end, aBytes);
+  end = render(end, " bytes) -=-\n");
+  *end = 0;
+  aTransmitBuffers << static_cast<char const*>(marker);
+}
+
+void nowtech::Log::reportTransmitErrors(TransmitBuffers &aTransmitBuffers, uint32_t const aErrors, uint32_t const aLastError) noexcept {
+  // -=- 4294967295 transmit errors (last 4294967295) -=-
+  char marker[cDropMarkerLength];
+  char *end = marker;
+  end = render(end, "-=- ");
+  end = render(end, aErrors);
+  end = render(end, " transmit errors (last ");
+  end = render(end, aLastError);
+  end = render(end, ") -=-\n");
+  *end = 0;
+  aTransmitBuffers << static_cast<char const*>(marker);
+}
+
+char *nowtech::Log::render(char * const aWhere, char const * const aString) noexcept {
+  char *where = aWhere;
+  for(char const *pointer = aString; *pointer != 0; ++pointer) {
+    *where = *pointer;
+    ++where;
+  }
+  return where;
+}
+
+char *nowtech::Log::render(char * const aWhere, uint32_t const aValue) noexcept {
+  char digits[std::numeric_limits<uint32_t>::digits10 + 1];
+  uint8_t count = 0u;
+  uint32_t value = aValue;
+  do {
+    digits[count] = cDigit2char[value % NumericSystem::cDecimal];
+    ++count;
+    value /= NumericSystem::cDecimal;
+  } while(value != 0u);
+  char *where = aWhere;
+  while(count > 0u) {
+    --count;
+    *where = digits[count];
+    ++where;
+  }
+  return where;
+}
+
+void nowtech::Log::finishSend(Chunk &aChunk) noexcept {
+  if(!aChunk.flush()) {
+    mDroppedMessages.fetch_add(1u);
+    mDroppedBytes.fetch_add(aChunk.getDroppedBytes());
+    if(aChunk.isPartiallyAdmitted()) {
+      mAbortPending[aChunk.getTaskId()] = !aChunk.pushAbort();
+    }
+    else { // nothing to do
+    }
+  }
+  else { // nothing to do
+  }
+}
+
+nowtech::LogShiftChainHelper nowtech::Log::i(Log &aLog) noexcept {
+  if(aLog.mShiftChainingCallBuffers != nullptr) {
+    nowtech::TaskIdType taskId = aLog.getCurrentTaskId();
+    nowtech::Chunk appender = aLog.startSend(aLog.mShiftChainingCallBuffers + (taskId * aLog.mChunkSize), taskId);
     if(appender.isValid()) {
-      return nowtech::LogShiftChainHelper(sInstance, appender);
+      return nowtech::LogShiftChainHelper(&aLog, appender);
     }
     else {
       return nowtech::LogShiftChainHelper();
@@ -224,12 +635,12 @@ nowtech::LogShiftChainHelper nowtech::Log::i() noexcept {
   }
 }
 
-nowtech::LogShiftChainHelper Log::i(LogTopicType const aTopic) noexcept {
-  if(sInstance->mShiftChainingCallBuffers != nullptr) {
-    nowtech::TaskIdType taskId = sInstance->getCurrentTaskId();
-    nowtech::Chunk appender = sInstance->startSend(sInstance->mShiftChainingCallBuffers + (taskId * sInstance->mChunkSize), taskId, aTopic);
+nowtech::LogShiftChainHelper Log::i(Log &aLog, LogTopicType const aTopic) noexcept {
+  if(aLog.mShiftChainingCallBuffers != nullptr) {
+    nowtech::TaskIdType taskId = aLog.getCurrentTaskId();
+    nowtech::Chunk appender = aLog.startSend(aLog.mShiftChainingCallBuffers + (taskId * aLog.mChunkSize), taskId, aTopic);
     if(appender.isValid()) {
-      return nowtech::LogShiftChainHelper(sInstance, appender);
+      return nowtech::LogShiftChainHelper(&aLog, appender);
     }
     else {
       return nowtech::LogShiftChainHelper();
@@ -240,12 +651,12 @@ nowtech::LogShiftChainHelper Log::i(LogTopicType const aTopic) noexcept {
   }
 }
 
-nowtech::LogShiftChainHelper Log::n() noexcept {
-  if(sInstance->mShiftChainingCallBuffers != nullptr) {
-    nowtech::TaskIdType taskId = sInstance->getCurrentTaskId();
-    nowtech::Chunk appender = sInstance->startSendNoHeader(sInstance->mShiftChainingCallBuffers + (taskId * sInstance->mChunkSize), taskId);
+nowtech::LogShiftChainHelper Log::n(Log &aLog) noexcept {
+  if(aLog.mShiftChainingCallBuffers != nullptr) {
+    nowtech::TaskIdType taskId = aLog.getCurrentTaskId();
+    nowtech::Chunk appender = aLog.startSendNoHeader(aLog.mShiftChainingCallBuffers + (taskId * aLog.mChunkSize), taskId);
     if(appender.isValid()) {
-      return nowtech::LogShiftChainHelper(sInstance, appender);
+      return nowtech::LogShiftChainHelper(&aLog, appender);
     }
     else {
       return nowtech::LogShiftChainHelper();
@@ -256,12 +667,12 @@ nowtech::LogShiftChainHelper Log::n() noexcept {
   }
 }
 
-nowtech::LogShiftChainHelper Log::n(LogTopicType const aTopic) noexcept {
-  if(sInstance->mShiftChainingCallBuffers != nullptr) {
-    nowtech::TaskIdType taskId = sInstance->getCurrentTaskId();
-    nowtech::Chunk appender = sInstance->startSendNoHeader(sInstance->mShiftChainingCallBuffers + (taskId * sInstance->mChunkSize), taskId, aTopic);
+nowtech::LogShiftChainHelper Log::n(Log &aLog, LogTopicType const aTopic) noexcept {
+  if(aLog.mShiftChainingCallBuffers != nullptr) {
+    nowtech::TaskIdType taskId = aLog.getCurrentTaskId();
+    nowtech::Chunk appender = aLog.startSendNoHeader(aLog.mShiftChainingCallBuffers + (taskId * aLog.mChunkSize), taskId, aTopic);
     if(appender.isValid()) {
-      return nowtech::LogShiftChainHelper(sInstance, appender);
+      return nowtech::LogShiftChainHelper(&aLog, appender);
     }
     else {
       return nowtech::LogShiftChainHelper();
@@ -320,8 +731,149 @@ nowtech::LogShiftChainHelper nowtech::Log::operator<<(LogShiftChainMarker const)
 }
 
 nowtech::Chunk nowtech::Log::startSend(char * const aChunkBuffer, TaskIdType const aTaskId) noexcept {
-  nowtech::Chunk appender = startSendNoHeader(aChunkBuffer, aTaskId);
-  if(appender.isValid()) {
+  return startSend(aChunkBuffer, aTaskId, LogTopicInstance::cInvalidTopic, nullptr);
+}
+
+nowtech::Chunk nowtech::Log::startSend(char * const aChunkBuffer, TaskIdType const aTaskId, LogTopicType const aTopic) noexcept {
+  if(mTopicRegistered[aTopic]) {
+    return startSend(aChunkBuffer, aTaskId, aTopic, mTopicPrefixes[aTopic]);
+  }
+  else { // nothing to do
+    return nowtech::Chunk();
+  }
+}
+
+uint64_t nowtech::Log::readTick() const noexcept {
+  if(mConfig.tickSource == LogConfig::TickSource::cMicroseconds) {
+    return mOsInterface.getLogTimeNs() / 1000u;
+  }
+  else if(mConfig.tickSource == LogConfig::TickSource::cNanoseconds) {
+    return mOsInterface.getLogTimeNs();
+  }
+  else {
+    return mOsInterface.getLogTime();
+  }
+}
+
+uint64_t nowtech::Log::getTick() const noexcept {
+  uint64_t const tick = readTick() - mTickOrigin;
+  // The 32-bit log time wraps, so must its difference.
+  return mConfig.tickSource == LogConfig::TickSource::cLogTime ? static_cast<uint32_t>(tick) : tick;
+}
+
+void nowtech::Log::getWallClockEntry(uint64_t const aSecond, WallClockCache::Entry &aEntry) noexcept {
+  if(!mWallClockCache.read(aSecond, aEntry)) {
+    WallClockCache::render(aSecond, mConfig.localWallClock ? mOsInterface.getUtcOffset(aSecond) : 0, mConfig.localWallClock, aEntry);
+    mWallClockCache.write(aSecond, aEntry);
+  }
+  else { // nothing to do
+  }
+}
+
+void nowtech::Log::appendWallClock(Chunk &aChunk) noexcept {
+  uint64_t const now = mOsInterface.getWallTimeNs();
+  uint64_t const second = now / cNsPerSec;
+  uint8_t const digits = mConfig.wallClock == LogConfig::WallClock::cMicroseconds ? 6u : (mConfig.wallClock == LogConfig::WallClock::cMilliseconds ? 3u : 0u);
+  if(mConfig.binaryFormat) {
+    pushBinary(aChunk, static_cast<char>(LogBinary::makeTag(LogBinary::cWallClock, mConfig.localWallClock ? LogBinary::cWallClockLocal : 0u, true)));
+    pushBinary(aChunk, static_cast<char>(digits));
+    pushVarint(aChunk, now);
+    if(mConfig.localWallClock) {
+      WallClockCache::Entry entry;
+      getWallClockEntry(second, entry);
+      int64_t const offset = entry.utcOffset;
+      pushVarint(aChunk, (static_cast<uint64_t>(offset) << 1u) ^ static_cast<uint64_t>(offset >> 63u));
+    }
+    else { // nothing to do
+    }
+  }
+  else {
+    WallClockCache::Entry entry;
+    getWallClockEntry(second, entry);
+    for(LogSizeType i = 0u; i < WallClockCache::cDateTimeLength; ++i) {
+      aChunk.push(entry.dateTime[i]);
+    }
+    if(digits > 0u) {
+      aChunk.push('.');
+      uint32_t fraction = static_cast<uint32_t>(now % cNsPerSec);
+      char text[9];
+      for(uint8_t i = 0u; i < 9u; ++i) {
+        text[8u - i] = static_cast<char>('0' + fraction % 10u);
+        fraction /= 10u;
+      }
+      for(uint8_t i = 0u; i < digits; ++i) {
+        aChunk.push(text[i]);
+      }
+    }
+    else { // nothing to do
+    }
+    for(uint8_t i = 0u; i < entry.zoneLength; ++i) {
+      aChunk.push(entry.zone[i]);
+    }
+    aChunk.push(cSeparatorNormal);
+  }
+}
+
+nowtech::Chunk nowtech::Log::startSend(char * const aChunkBuffer, TaskIdType const aTaskId, LogTopicType const aTopic, char const * const aTopicName) noexcept {
+  nowtech::Chunk appender = startSendTagged(aChunkBuffer, aTaskId, aTopic);
+  if(appender.isValid() && mConfig.wallClock != LogConfig::WallClock::cNone && (mConfig.binaryFormat || !mConfig.compactHeader)) {
+    appendWallClock(appender);
+  }
+  else { // nothing to do
+  }
+  if(appender.isValid() && mConfig.binaryFormat) {
+    if(mConfig.taskRepresentation == LogConfig::TaskRepresentation::cId) {
+      appendBinary(appender, LogBinary::cTaskId, *reinterpret_cast<uint8_t*>(appender.getData()), mConfig.taskIdFormat.base, mConfig.taskIdFormat.fill);
+    }
+    else if(mConfig.taskRepresentation == LogConfig::TaskRepresentation::cName) {
+      appendBinary(appender, LogBinary::cTaskName, mOsInterface.isInterrupt() ? cIsrTaskNameString : mOsInterface.getCurrentThreadName());
+    }
+    else { // nothing to do
+    }
+    if(mConfig.tickFormat.base != 0) {
+      appendBinary(appender, LogBinary::cTick, getTick(), mConfig.tickFormat.base, mConfig.tickFormat.fill);
+    }
+    else { // nothing to do
+    }
+    if(aTopicName != nullptr) {
+      appendBinary(appender, LogBinary::cTopic, aTopicName);
+    }
+    else { // nothing to do
+    }
+  }
+  else if(appender.isValid() && mConfig.compactHeader) {
+    // Always a full header, the transmitter shortens it knowing the previous message.
+    appender.push(cHeaderKeyframe);
+    if(mConfig.tickFormat.base != 0) {
+      append(appender, getTick(), static_cast<uint64_t>(mConfig.tickFormat.base), mConfig.tickFormat.fill);
+    }
+    else { // nothing to do
+    }
+    if(mConfig.taskRepresentation == LogConfig::TaskRepresentation::cId) {
+      appender.push(cHeaderTask);
+      append(appender, *reinterpret_cast<uint8_t*>(appender.getData()), mConfig.taskIdFormat.base, mConfig.taskIdFormat.fill);
+    }
+    else if(mConfig.taskRepresentation == LogConfig::TaskRepresentation::cName) {
+      appender.push(cHeaderTask);
+      append(appender, mOsInterface.isInterrupt() ? cIsrTaskNameString : mOsInterface.getCurrentThreadName());
+    }
+    else { // nothing to do
+    }
+    if(aTopicName != nullptr) {
+      appender.push(cHeaderTopic);
+      append(appender, aTopicName);
+    }
+    else { // nothing to do
+    }
+    appender.push(cSeparatorNormal);
+    // After the separator, because the transmitter rewrites everything before it.
+    if(mConfig.wallClock != LogConfig::WallClock::cNone) {
+      appendWallClock(appender);
+    }
+    else { // nothing to do
+    }
+  }
+  else if(appender.isValid()) {
     if(mConfig.taskRepresentation == LogConfig::TaskRepresentation::cId) {
       append(appender, *reinterpret_cast<uint8_t*>(appender.getData()), mConfig.taskIdFormat.base, mConfig.taskIdFormat.fill);
       append(appender, cSeparatorNormal);
@@ -338,47 +890,73 @@ nowtech::Chunk nowtech::Log::startSend(char * const aChunkBuffer, TaskIdType con
     else { // nothing to do
     }
     if(mConfig.tickFormat.base != 0) {
-      append(appender, mOsInterface.getLogTime(), static_cast<uint32_t>(mConfig.tickFormat.base), mConfig.tickFormat.fill);
+      append(appender, getTick(), static_cast<uint64_t>(mConfig.tickFormat.base), mConfig.tickFormat.fill);
       append(appender, cSeparatorNormal);
     }
     else { // nothing to do
     }
-  }
-  else { // nothing to do
-  }
-  return appender;
-}
-
-nowtech::Chunk nowtech::Log::startSend(char * const aChunkBuffer, TaskIdType const aTaskId, LogTopicType const aTopic) noexcept {
-  auto found = mRegisteredTopics.find(aTopic);
-  if(found != mRegisteredTopics.end()) {
-    nowtech::Chunk appender = startSend(aChunkBuffer, aTaskId);
-    if(appender.isValid()) {
-      append(appender, found->second);
+    if(aTopicName != nullptr) {
+      append(appender, aTopicName);
       append(appender, cSeparatorNormal);
     }
     else { // nothing to do
     }
-    return appender;
   }
   else { // nothing to do
-    return nowtech::Chunk();
   }
+  return appender;
 }
 
 nowtech::Chunk nowtech::Log::startSendNoHeader(char * const aChunkBuffer, TaskIdType const aTaskId) noexcept {
-  if(!mOsInterface.isInterrupt() || mConfig.logFromIsr) {
-    TaskIdType taskId = aTaskId == Chunk::cInvalidTaskId ? getCurrentTaskId() : aTaskId;
-    return nowtech::Chunk(&mOsInterface, aChunkBuffer, 1u, taskId, mConfig.blocks);
+  return startSendTagged(aChunkBuffer, aTaskId, LogTopicInstance::cInvalidTopic);
+}
+
+nowtech::Chunk nowtech::Log::startSendNoHeader(char * const aChunkBuffer, TaskIdType const aTaskId, LogTopicType const aTopic) noexcept {
+  if(mTopicRegistered[aTopic]) {
+    return startSendTagged(aChunkBuffer, aTaskId, aTopic);
   }
   else {
     return nowtech::Chunk();
   }
 }
 
-nowtech::Chunk nowtech::Log::startSendNoHeader(char * const aChunkBuffer, TaskIdType const aTaskId, LogTopicType const aTopic) noexcept {
-  if(mRegisteredTopics.find(aTopic) != mRegisteredTopics.end()) {
-    return startSendNoHeader(aChunkBuffer, aTaskId);
+nowtech::Chunk nowtech::Log::startSendTagged(char * const aChunkBuffer, TaskIdType const aTaskId, LogTopicType const aTopic) noexcept {
+  if(!mOsInterface.isInterrupt() || mConfig.logFromIsr) {
+    TaskIdType taskId = aTaskId == Chunk::cInvalidTaskId ? getCurrentTaskId() : aTaskId;
+    nowtech::Chunk appender(&mOsInterface, aChunkBuffer, 1u, taskId, mConfig.blocks);
+    if(mAbortPending[taskId]) {
+      // The transmitter must learn about the previous broken message before anything new arrives.
+      mAbortPending[taskId] = !appender.pushAbort();
+      if(mAbortPending[taskId]) {
+        appender.drop();
+      }
+      else { // nothing to do
+      }
+    }
+    else { // nothing to do
+    }
+    if(mConfig.emitSequenceTags) {
+      uint32_t const sequence = mNextSequence.fetch_add(1u);
+      appender.push(cSequenceTag);
+      for(LogSizeType digit = cSequenceTagLength - 1u; digit > 0u; --digit) {
+        appender.push(cDigit2char[(sequence >> ((digit - 1u) * 4u)) & 0xfu]);
+      }
+    }
+    else { // nothing to do
+    }
+    if(mConfig.emitTopicTags) {
+      appender.push(cTopicTag);
+      appender.push(cDigit2char[aTopic >> 4u]);
+      appender.push(cDigit2char[aTopic & 0xfu]);
+    }
+    else { // nothing to do
+    }
+    if(mConfig.binaryFormat) {
+      appender.push(LogBinary::cRecordStart);
+    }
+    else { // nothing to do
+    }
+    return appender;
   }
   else {
     return nowtech::Chunk();
@@ -386,6 +964,16 @@ nowtech::Chunk nowtech::Log::startSendNoHeader(char * const aChunkBuffer, TaskId
 }
 
 void nowtech::Log::append(nowtech::Chunk &aChunk, double const aValue, uint8_t const aDigitsNeeded) noexcept {
+  if(mConfig.binaryFormat) {
+    uint64_t bits;
+    std::memcpy(&bits, &aValue, sizeof(bits));
+    pushBinary(aChunk, static_cast<char>(LogBinary::makeTag(LogBinary::cDouble, 0u, true)));
+    pushBinary(aChunk, static_cast<char>(aDigitsNeeded));
+    pushLittleEndian(aChunk, bits, sizeof(bits));
+    return;
+  }
+  else { // nothing to do
+  }
   if(std::isnan(aValue)) {
     append(aChunk, "nan");
     return;
@@ -442,18 +1030,44 @@ void nowtech::Log::append(nowtech::Chunk &aChunk, double const aValue, uint8_t c
   }
 }
 
+void nowtech::Log::append(nowtech::Chunk &aChunk, float const aValue, uint8_t const aDigitsNeeded) noexcept {
+  if(mConfig.binaryFormat) {
+    uint32_t bits;
+    std::memcpy(&bits, &aValue, sizeof(bits));
+    pushBinary(aChunk, static_cast<char>(LogBinary::makeTag(LogBinary::cFloat, 0u, true)));
+    pushBinary(aChunk, static_cast<char>(aDigitsNeeded));
+    pushLittleEndian(aChunk, bits, sizeof(bits));
+  }
+  else {
+    append(aChunk, static_cast<double>(aValue), aDigitsNeeded);
+  }
+}
 
+void nowtech::Log::pushVarint(nowtech::Chunk &aChunk, uint64_t const aValue) noexcept {
+  uint64_t value = aValue;
+  while(value >= cVarintContinuation) {
+    pushBinary(aChunk, static_cast<char>((value & cVarintMask) | cVarintContinuation));
+    value >>= cVarintShift;
+  }
+  pushBinary(aChunk, static_cast<char>(value));
+}
 
+void nowtech::Log::appendBinary(nowtech::Chunk &aChunk, uint8_t const aType, uint64_t const aValue, uint32_t const aBase, uint8_t const aFill) noexcept {
+  pushBinary(aChunk, static_cast<char>(LogBinary::makeTag(aType, LogBinary::encodeBase(aBase), aFill > 0u)));
+  if(aFill > 0u) {
+    pushBinary(aChunk, static_cast<char>(aFill));
+  }
+  else { // nothing to do
+  }
+  pushVarint(aChunk, aValue);
+}
 
-
-
-
-
-
-
-
-
-
-
-
-
+void nowtech::Log::appendBinary(nowtech::Chunk &aChunk, uint8_t const aType, char const * const aString) noexcept {
+  char const * const string = aString != nullptr ? aString : "";
+  LogSizeType const length = static_cast<LogSizeType>(std::strlen(string));
+  pushBinary(aChunk, static_cast<char>(LogBinary::makeTag(aType, 0u, false)));
+  pushVarint(aChunk, length);
+  for(LogSizeType i = 0u; i < length; ++i) {
+    pushBinary(aChunk, string[i]);
+  }
+}
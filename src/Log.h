@@ -25,12 +25,12 @@
 #define NOWTECH_LOG_INCLUDED
 
 #include "BanCopyMove.h"
+#include "LogBinary.h"
 #include <cstdint>
 #include <type_traits>
 #include <atomic>
 #include <limits>
 #include <cmath>
-#include <map>
 
 namespace nowtech {
 
@@ -49,6 +49,8 @@ namespace nowtech {
   typedef uint8_t LogTopicType;
 
   class Log;
+  class CircularBuffer;
+  class TransmitBuffers;
 
   class LogTopicInstance final {
     friend class Log;
@@ -102,12 +104,52 @@ namespace nowtech {
     }
   };
 
+  /// Struct describing how a task waits for a queue in implementations
+  /// which poll before putting the task to sleep.
+  struct LogWaitStrategy {
+    /// Number of busy retries before yielding.
+    uint32_t spinCount;
+
+    /// Number of retries with yielding the processor before sleeping.
+    uint32_t yieldCount;
+
+    /// Constructor.
+    constexpr LogWaitStrategy(uint32_t const aSpinCount, uint32_t const aYieldCount)
+    : spinCount(aSpinCount)
+    , yieldCount(aYieldCount) {
+    }
+
+    LogWaitStrategy(LogWaitStrategy const &) = default;
+    LogWaitStrategy(LogWaitStrategy &&) = default;
+    LogWaitStrategy& operator=(LogWaitStrategy const &) = default;
+    LogWaitStrategy& operator=(LogWaitStrategy &&) = default;
+  };
+
+  /// Describes one of the ready transmission buffers handed over to the
+  /// OsInterface in a single gathering transmit call.
+  struct LogBufferSlice {
+    char const * buffer;
+    LogSizeType length;
+  };
+
+  /// Writes the output of Log::drainAfterCrash(). Must be async-signal-safe.
+  typedef void (*LogCrashWrite)(char const * const aData, LogSizeType const aLength);
+
   /// Configuration struct with default values for general usage.
   struct LogConfig final : public BanCopyMove {
   public:
     /// Type of info to log about the sender task
     enum class TaskRepresentation : uint8_t {cNone, cId, cName};
 
+    /// Source of the tick in the message header.
+    /// cLogTime is LogOsInterface::getLogTime(), OS dependent and 32 bits.
+    /// cMicroseconds and cNanoseconds come from LogOsInterface::getLogTimeNs(),
+    /// 64 bits, so they never wrap.
+    enum class TickSource : uint8_t {cLogTime, cMicroseconds, cNanoseconds};
+
+    /// Resolution of the wall clock in the message header, if any.
+    enum class WallClock : uint8_t {cNone, cSeconds, cMilliseconds, cMicroseconds};
+
     /// This is the default logging format and the only one I will document
     /// here. For the others, the letter represents the base of the number
     /// system and the number represents the minimum digits to write, possibly
@@ -157,6 +199,8 @@ namespace nowtech {
     /// Total message chunk size to use in queue and buffers. The net capacity is
     /// one less, because the task ID takes a character. Messages are not handled
     /// in characters os as a string, but as chunks. \r signs the end of a message.
+    /// A message fitting in one chunk with a flag byte is marked with
+    /// Chunk::cSingleChunk, and bypasses the de-interleaving in the transmitter.
     LogSizeType chunkSize = 8u;
 
     /// Length of a FreeRTOS queue in chunks.
@@ -166,9 +210,14 @@ namespace nowtech {
     /// chunks.
     LogSizeType circularBufferLength = 64u;
 
-    /// Length of a buffer in the transmission double-buffer pair, in chunks.
+    /// Length of a buffer in the transmission buffer ring, in chunks.
     LogSizeType transmitBufferLength = 32u;
 
+    /// Number of buffers in the transmission buffer ring, at least 2. While
+    /// the sink is busy with some of them, the transmitter fills the next
+    /// free one, so more buffers absorb longer bursts.
+    LogSizeType transmitBufferCount = 2u;
+
     /// Length of stack-reserved buffer for number to string conversion. Can be
     /// reduced if no binary output is used.
     LogSizeType appendStackBufferLength = 34u;
@@ -182,12 +231,26 @@ namespace nowtech {
     uint32_t refreshPeriod = 1000u;
 
     /// Signs if writing the FreeRTOS queue can block or should return on the expense
-    /// of losing chunks. Note, that even in blocking mode the throughput can not
+    /// of losing messages. Note, that even in blocking mode the throughput can not
     /// reach the theoretical UART bps limit.
-    /// Important! In non-blocking mode high demands will result in loss of complete
-    /// messages and often an internal lockup of the log system.
+    /// In non-blocking mode a message is either admitted completely or dropped
+    /// completely. Dropped messages and bytes are counted, and the transmitter
+    /// emits a -=- N messages dropped (M bytes) -=- line when loss occurs.
     bool blocks = true;
 
+    /// Maximum time in ms a task waits for free space in the queue in blocking
+    /// mode. When it elapses, the message is dropped like in non-blocking mode.
+    /// 0 means waiting forever.
+    uint32_t blockTimeout = 0u;
+
+    /// How the logging tasks wait for free space in the queue in blocking mode,
+    /// before sleeping until the transmitter frees a chunk.
+    LogWaitStrategy producerWait = LogWaitStrategy(64u, 16u);
+
+    /// How the transmitter waits for chunks before sleeping until a logging
+    /// task enqueues one or pauseLength elapses.
+    LogWaitStrategy consumerWait = LogWaitStrategy(32u, 4u);
+
     /// Representation of a task in the message header, if any. It can be missing,
     /// numeric task ID or FreeRTOS task name.
     TaskRepresentation taskRepresentation = TaskRepresentation::cId;
@@ -202,6 +265,28 @@ namespace nowtech {
     /// LogFormat::cNone to disable tick output.
     LogFormat tickFormat   = cD5;
 
+    /// What the tick in the header means, see TickSource.
+    TickSource tickSource = TickSource::cLogTime;
+
+    /// If true, the tick is the time elapsed since the Log construction,
+    /// otherwise the absolute value of the clock. The value is read once per
+    /// message in the logging task. In binary format it is sent as it is,
+    /// and the decoder can render it relative to the first message.
+    bool relativeTick = false;
+
+    /// If not cNone, the header starts with the wall clock time in ISO-8601
+    /// format, like 2026-10-18T12:34:56.789Z. The date and time of day part
+    /// is rendered once per second and cached in WallClockCache, so a message
+    /// only copies it and appends the fraction. In compact header mode it
+    /// comes right after the compact header. In binary format the raw time is
+    /// sent, and the decoder renders it. Needs an OS interface implementing
+    /// LogOsInterface::getWallTimeNs().
+    WallClock wallClock = WallClock::cNone;
+
+    /// If true, the wall clock shows the local time with its UTC offset, like
+    /// +02:00, otherwise UTC with Z.
+    bool localWallClock = false;
+
     /// These are default formats for some types.
     LogFormat int8Format   = cDefault;
     LogFormat int16Format  = cDefault;
@@ -217,9 +302,90 @@ namespace nowtech {
     /// If true, positive numbers will be prepended with a space to let them align negatives.
     bool alignSigned = false;
 
+    /// If true, messages are sent in the binary format described in LogBinary
+    /// instead of text. Literals wrapped in LOG_LITERAL are sent as 4-byte IDs,
+    /// and tools/logdecode.cpp restores the text on the host using the
+    /// dictionary in the executable. Number formats are sent along and
+    /// applied by the decoder.
+    bool binaryFormat = false;
+
+    /// If true, the text header of a message holds only what changed since
+    /// the previous message in the output: the tick difference, and the task
+    /// and topic if they are different. A compact header looks like
+    /// +5.01:system and a full one like =12345.01:system, see Log::cHeaderKeyframe.
+    /// Task names and topics must not contain space, and task names not colon.
+    /// tools/logexpand.cpp restores the full headers. Has no effect on the
+    /// binary format. With emitTopicTags all headers stay full, because the
+    /// sinks using the topics pass on only some of the messages.
+    bool compactHeader = false;
+
+    /// In compact header mode every keyframePeriod-th message has a full
+    /// header, to let a reader start anywhere. Regardless of this, full
+    /// headers are sent after an aborted message, or if the compact one would
+    /// not be shorter. 0 means no periodic full headers.
+    uint32_t keyframePeriod = 32u;
+
+    /// If true, each message starts with Log::cTopicTag and its topic in 2
+    /// hexadecimal digits, 00 for messages without topic. LogTeeSink uses
+    /// and removes them, other sinks would write them.
+    bool emitTopicTags = false;
+
+    /// If true, each message starts with Log::cSequenceTag and a global
+    /// sequence number in 8 hexadecimal digits, before the topic tag. The
+    /// number is taken when the message is started, and counts from 0 for
+    /// each Log. LogOrderingSink uses them to write the messages in sequence
+    /// order and report the gaps, other sinks would write them.
+    bool emitSequenceTags = false;
+
+    /// If true, each line end inside a text message is preceded by
+    /// Log::cLineBreakTag, so a sink can tell it from the end of the message.
+    /// Implied by emitTopicTags and emitSequenceTags. LogFramingSink needs it
+    /// in Mode::cMessage, other sinks would write the tags.
+    bool tagLineBreaks = false;
+
+    /// The destructor of Log waits at most this many ms for the messages
+    /// enqueued before to be transmitted, see Log::flush(). 0 means no wait,
+    /// and the rest is lost.
+    uint32_t shutdownDrainTimeout = 1000u;
+
     LogConfig() noexcept = default;
   };
 
+  /// Memory for the buffers of a Log instance and its transmitter, given by
+  /// the user instead of being allocated on the heap. The sizes must match
+  /// the LogConfig used with it. LogStaticStorage provides arrays sized at
+  /// compile time, and sets the config accordingly.
+  struct LogStorage {
+    /// getShiftChainingCallBufferSize() bytes if LogConfig::allowShiftChainingCalls.
+    char *shiftChainingCallBuffers = nullptr;
+
+    /// circularBufferLength * chunkSize bytes.
+    char *circularBuffer = nullptr;
+
+    /// transmitBufferCount times getTransmitBufferSize() bytes, and the
+    /// bookkeeping of the transmitBufferCount buffers.
+    char *transmitBuffers = nullptr;
+    char **transmitBufferStarts = nullptr;
+    LogSizeType *transmitChunkCounts = nullptr;
+    LogSizeType *transmitIndices = nullptr;
+    LogBufferSlice *transmitSlices = nullptr;
+
+    /// Memory of the queue for the OS interfaces accepting it, like LogPosix.
+    void *queue = nullptr;
+
+    static constexpr LogSizeType getShiftChainingCallBufferSize(LogSizeType const aChunkSize) noexcept {
+      return (std::numeric_limits<TaskIdType>::max() + static_cast<LogSizeType>(1u)) * aChunkSize;
+    }
+
+    /// Leading bytes reserved to let TransmitBuffers::popDirectly() receive
+    /// the task ID and Chunk::cSingleChunk, which are later overwritten.
+    static constexpr LogSizeType cTransmitBufferReserve = 2u;
+
+    static constexpr LogSizeType getTransmitBufferSize(LogSizeType const aBufferLength, LogSizeType const aChunkSize) noexcept {
+      return aBufferLength * (aChunkSize - 1u) + cTransmitBufferReserve;
+    }
+  };
+
   /// Abstract base class for OS/architecture/dependent log functionality under
   /// the Log class. The instance directly referenced by the Log object will
   /// contain an OS thread to let the actual write into the sink happen
@@ -237,19 +403,24 @@ namespace nowtech {
     /// See in LogConfig.
     uint32_t mRefreshPeriod;
 
+    /// See in LogConfig.
+    uint32_t mBlockTimeout;
+
   public:
     /// Has default constructor to let the stub versions work.
     LogOsInterface()
       : mChunkSize(1u)
       , mPauseLength(1u)
-      , mRefreshPeriod(1u) {
+      , mRefreshPeriod(1u)
+      , mBlockTimeout(0u) {
     }
 
     /// Has default constructor to let the stub versions work.
     LogOsInterface(LogConfig const & aConfig)
       : mChunkSize(aConfig.chunkSize)
       , mPauseLength(aConfig.pauseLength)
-      , mRefreshPeriod(aConfig.refreshPeriod) {
+      , mRefreshPeriod(aConfig.refreshPeriod)
+      , mBlockTimeout(aConfig.blockTimeout) {
     }
 
     /// Has default destructor to let the stub versions work.
@@ -291,6 +462,24 @@ namespace nowtech {
     /// Can be anything from OS ticks, ms or s.
     virtual uint32_t getLogTime() const noexcept = 0;
 
+    /// Returns a monotonic time in ns in 64 bits. The default assumes that
+    /// getLogTime() is in ms, so it has neither better resolution nor range.
+    virtual uint64_t getLogTimeNs() const noexcept {
+      return static_cast<uint64_t>(getLogTime()) * 1000000u;
+    }
+
+    /// Returns the wall clock time in ns since the Unix epoch in UTC, or 0
+    /// if there is no wall clock.
+    virtual uint64_t getWallTimeNs() const noexcept {
+      return 0u;
+    }
+
+    /// Returns the offset of the local time from UTC in seconds at the
+    /// given time. Called at most once per second.
+    virtual int32_t getUtcOffset(uint64_t const /*aUnixSeconds*/) const noexcept {
+      return 0;
+    }
+
     /// Creates a separate thread for sending log contents to the sink.
     /// @param log the Log instance to be passed as parameter to the function in the other parameter
     /// @param threadFunc the function to serve as the body of the new thread.
@@ -301,11 +490,30 @@ namespace nowtech {
     };
 
     /// Enqueues the chunks, possibly blocking if the queue is full.
-    virtual void push(char const * const aChunkStart, bool const aBlocks) noexcept = 0;
+    /// @return true if the chunk was admitted, false if it was dropped.
+    virtual bool push(char const * const aChunkStart, bool const aBlocks) noexcept = 0;
 
     /// Removes the oldest chunk from the queue.
     virtual bool pop(char * const aChunkStart) noexcept = 0;
 
+    /// @return true if the chunks are transmitted by a thread of this
+    /// OsInterface, which Log::flush() has to wait for. This returns false.
+    virtual bool hasTransmitterThread() const noexcept {
+      return false;
+    }
+
+    /// Sleeps the calling thread for about aMs ms while Log::flush() waits,
+    /// so it must not touch the sink. This does nothing.
+    virtual void sleep(uint32_t const) noexcept {
+    }
+
+    /// Removes the oldest chunk from the queue without waiting, using only
+    /// async-signal-safe operations. Used by Log::drainAfterCrash(). This
+    /// returns false, meaning the queue can not be drained this way.
+    virtual bool tryPop(char * const) noexcept {
+      return false;
+    }
+
     /// Pauses the current thread for a period determined during construction
     /// of the derived object.
     virtual void pause() noexcept = 0;
@@ -317,9 +525,39 @@ namespace nowtech {
     virtual void transmit(char const * const buffer, LogSizeType const length, std::atomic<bool> *mProgressFlag) noexcept {
     }
 
+    /// @return the maximum number of buffers transmitGathered() accepts in
+    /// one call. 1 means the OsInterface transmits the buffers one by one.
+    virtual LogSizeType getGatherLimit() const noexcept {
+      return 1u;
+    }
+
+    /// Called once by the transmitter thread with the whole transmission
+    /// buffers before any transmission, to let the OsInterface prepare them
+    /// for zero-copy I/O if possible.
+    virtual void registerTransmitBuffers(LogBufferSlice const * const, LogSizeType const) noexcept {
+    }
+
+    /// Transmits several ready buffers in one go, like writev, and clears the
+    /// progress flag when all of them are done. Called with at most
+    /// getGatherLimit() slices. This default handles only the first one.
+    virtual void transmitGathered(LogBufferSlice const * const aSlices, LogSizeType const /*aCount*/, std::atomic<bool> *aProgressFlag) noexcept {
+      transmit(aSlices[0].buffer, aSlices[0].length, aProgressFlag);
+    }
+
     virtual void startRefreshTimer(std::atomic<bool> *aRefreshFlag) noexcept {
     }
 
+    /// @return the number of failed transmissions so far, if the OsInterface
+    /// can detect them.
+    virtual uint32_t getTransmitErrorCount() const noexcept {
+      return 0u;
+    }
+
+    /// @return an OS-specific code of the last failed transmission, like errno.
+    virtual uint32_t getLastTransmitError() const noexcept {
+      return 0u;
+    }
+
     /// Calls az OS-specific lock to acquire a critical section, if implemented
     virtual void lock() noexcept {
     }
@@ -333,12 +571,25 @@ namespace nowtech {
   class Chunk final {
   public:
     static constexpr TaskIdType cInvalidTaskId = 0u;
+    /// Terminates the last chunk of a message, written only by flush().
     static constexpr char       cEndOfMessage  = '\r';
+    /// The transmitter replaces cEndOfMessage with it in the output.
     static constexpr char       cEndOfLine     = '\n';
+    /// Placed right after the task ID of a message which fits in a single
+    /// chunk, so the transmitter can copy it without de-interleaving. The
+    /// text still ends in cEndOfMessage.
+    static constexpr char       cSingleChunk   = '\x16';
+    /// Placed right after the task ID, tells the transmitter to discard the
+    /// partially enqueued message of this task.
+    static constexpr char       cAbortMessage  = '\x18';
+    /// Placed right after the task ID and followed by a 4-byte ticket, marks
+    /// the point in the queue Log::flush() waits for.
+    static constexpr char       cFlushMarker   = '\x17';
+    /// The chunk size needed for a flush marker.
+    static constexpr LogSizeType cFlushMarkerLength = 2u + sizeof(uint32_t);
     /// Artificial task ID for interrupts.
     static constexpr TaskIdType cIsrTaskId = std::numeric_limits<TaskIdType>::max();
 
-
   private:
     LogOsInterface *mOsInterface;
     char * mOrigin;
@@ -348,6 +599,16 @@ namespace nowtech {
     LogSizeType mIndex = 1;
     bool mBlocks;
 
+    /// True if a chunk of this message could not be enqueued, and the rest
+    /// should be discarded.
+    bool mDropped = false;
+
+    /// True if at least one chunk of this message was enqueued.
+    bool mAdmitted = false;
+
+    /// Number of payload bytes discarded in this message.
+    LogSizeType mDroppedBytes = 0u;
+
   public:
     Chunk() noexcept
       : mOsInterface(nullptr)
@@ -408,6 +669,24 @@ namespace nowtech {
       return mOsInterface != nullptr;
     }
 
+    bool isDropped() const noexcept {
+      return mDropped;
+    }
+
+    /// True if the message was dropped after some of its chunks were enqueued.
+    bool isPartiallyAdmitted() const noexcept {
+      return mDropped && mAdmitted;
+    }
+
+    LogSizeType getDroppedBytes() const noexcept {
+      return mDroppedBytes;
+    }
+
+    /// Makes the Chunk discard all the contents appended to it.
+    void drop() noexcept {
+      mDropped = true;
+    }
+
     char * const operator++() noexcept {
       mIndex = 1u;
       mChunk += mChunkSize;
@@ -443,10 +722,42 @@ namespace nowtech {
     /// defined in .cpp to allow stub.
     void push(char const mChar) noexcept;
 
-    void flush() noexcept {
-      mChunk[mIndex] = cEndOfMessage;
-      mOsInterface->push(mChunk, mBlocks);
+    /// Terminates and enqueues the last chunk of the message.
+    /// @return false if the message was dropped.
+    bool flush() noexcept {
+      if(!mDropped) {
+        LogSizeType const length = mIndex - 1u;
+        if(!mAdmitted && mIndex + 1u < mChunkSize) {
+          for(LogSizeType i = mIndex; i > 1u; --i) {
+            mChunk[i] = mChunk[i - 1u];
+          }
+          mChunk[1] = cSingleChunk;
+          ++mIndex;
+        }
+        else { // nothing to do
+        }
+        mChunk[mIndex] = cEndOfMessage;
+        if(mOsInterface->push(mChunk, mBlocks)) {
+          mAdmitted = true;
+        }
+        else {
+          mDropped = true;
+          mDroppedBytes += length;
+        }
+      }
+      else {
+        mDroppedBytes += mIndex - 1u;
+      }
       mIndex = 1u;
+      return !mDropped;
+    }
+
+    /// Enqueues a chunk telling the transmitter to discard the partially
+    /// enqueued message of this task.
+    /// @return true if the chunk was admitted.
+    bool pushAbort() noexcept {
+      mChunk[1] = cAbortMessage;
+      return mOsInterface->push(mChunk, mBlocks);
     }
 
     void pop() noexcept {
@@ -464,6 +775,49 @@ namespace nowtech {
     cEnd      = 0u
   };
 
+  /// Auxiliary class, not part of the Log API.
+  /// Holds the rendered date and time of day of the latest second for
+  /// LogConfig::wallClock, shared by the logging tasks without locking. It is
+  /// a sequence lock: a task finding it being updated or holding another
+  /// second renders the entry on its own, and tries to store it.
+  class WallClockCache final : public BanCopyMove {
+  public:
+    /// 2026-10-18T12:34:56
+    static constexpr LogSizeType cDateTimeLength = 19u;
+
+    /// Z or +02:00
+    static constexpr LogSizeType cMaxZoneLength = 6u;
+
+    struct Entry final {
+      char dateTime[cDateTimeLength];
+      char zone[cMaxZoneLength];
+      uint8_t zoneLength;
+      /// The offset of the local time in seconds, 0 for UTC.
+      int32_t utcOffset;
+    };
+
+  private:
+    static constexpr uint32_t cWords = (sizeof(Entry) + sizeof(uint64_t) - 1u) / sizeof(uint64_t);
+
+    /// Odd while being updated.
+    std::atomic<uint32_t> mSequence;
+    std::atomic<uint64_t> mSecond;
+    std::atomic<uint64_t> mWords[cWords];
+
+  public:
+    WallClockCache() noexcept;
+
+    /// @return true if the cache holds aSecond and aEntry could be copied.
+    bool read(uint64_t const aSecond, Entry &aEntry) const noexcept;
+
+    /// Stores the entry, unless an other task is doing the same.
+    void write(uint64_t const aSecond, Entry const &aEntry) noexcept;
+
+    /// Renders the entry for aSecond in UTC seconds since the Unix epoch.
+    /// @param aUtcOffset offset of the local time in seconds, if aLocal.
+    static void render(uint64_t const aSecond, int32_t const aUtcOffset, bool const aLocal, Entry &aEntry) noexcept;
+  };
+
   class LogShiftChainHelper final {
     Log *       mLog;
     Chunk       mAppender;
@@ -518,8 +872,11 @@ namespace nowtech {
   /// one may be transmitted via DMA. A timeout value is used to ensure transmission
   /// in a defined amount of time even if the transmission buffer is not full.
   /// This class can has a stub implementation in an other .cpp file to prevent
-  /// logging in release without the need of #ifdefs and macros. This class shall
-  /// have only one instance, and can be accessed via a static method.
+  /// logging in release without the need of #ifdefs and macros. Each instance
+  /// has its own queue, transmitter, OS interface and task registry, so
+  /// separate subsystems may log to separate sinks without backpressuring
+  /// each other. The static methods without a Log parameter use the default
+  /// instance, which is the first one constructed.
   /// If code size matters, the template argument pattern should come from
   /// a limited number parameter type combinations, and possibly only a small
   /// number of parameters.
@@ -533,6 +890,38 @@ namespace nowtech {
     /// Output for unknown LogTopicType parameter
     static constexpr char cUnknownApplicationName[cNameLength] = "UNKNOWN";
 
+    /// Separator signing message truncation due to buffer overflow or a
+    /// message aborted after its beginning was already transmitted.
+    static constexpr char cSeparatorFailure = '@';
+
+    /// Starts a full header in compact header mode. The producers send full
+    /// headers, which the transmitter shortens to ones starting with
+    /// cHeaderDelta, followed by the tick difference, if any, in tickFormat's
+    /// numeric system, with - sign if negative. In both kinds the task follows
+    /// cHeaderTask and the topic cHeaderTopic, and a space ends the header.
+    static constexpr char cHeaderKeyframe = '=';
+    static constexpr char cHeaderDelta    = '+';
+    static constexpr char cHeaderTask     = '.';
+    static constexpr char cHeaderTopic    = ':';
+
+    /// Starts the topic tag of LogConfig::emitTopicTags.
+    static constexpr char        cTopicTag       = '\x11';
+    static constexpr LogSizeType cTopicTagLength = 3u;
+
+    /// Starts the sequence tag of LogConfig::emitSequenceTags.
+    static constexpr char        cSequenceTag       = '\x12';
+    static constexpr LogSizeType cSequenceTagLength = 9u;
+
+    /// If LogConfig::tagLineBreaks, emitTopicTags or emitSequenceTags is set,
+    /// precedes each line end inside a text message, so the sinks parsing the
+    /// messages can tell it from the end of the message. The sinks removing
+    /// the tags remove it.
+    static constexpr char        cLineBreakTag      = '\x13';
+
+    /// Follow a 0 in the prefix of LogConfig::appendBasePrefix.
+    static constexpr char cNumericMarkBinary      = 'b';
+    static constexpr char cNumericMarkHexadecimal = 'x';
+
   private:
     static constexpr LogTopicType cFreeTopicIncrement = 1u;
     static constexpr LogTopicType cFirstFreeTopic = LogTopicInstance::cInvalidTopic + cFreeTopicIncrement;
@@ -547,17 +936,19 @@ namespace nowtech {
 
     /// Zero-fill character.
     static constexpr char cNumericFill            = '0';
-    static constexpr char cNumericMarkBinary      = 'b';
-    static constexpr char cNumericMarkHexadecimal = 'x';
     static constexpr char cMinus = '-';
     static constexpr char cSpace = ' ';
 
     /// Separator between header fields of the log message.
     static constexpr char cSeparatorNormal = ' ';
 
-    /// Separator signing message truncation due to buffer overflow. An unknown
-    /// amount of subsequent messages may be missing.
-    static constexpr char cSeparatorFailure = '@';
+    /// cIsrTaskName as string for the binary format.
+    static constexpr char cIsrTaskNameString[] = "?";
+
+    /// LEB128 varint encoding.
+    static constexpr uint8_t cVarintContinuation = 0x80u;
+    static constexpr uint8_t cVarintMask         = 0x7fu;
+    static constexpr uint8_t cVarintShift        = 7u;
 
     /// Used to convert digits to characters.
     static constexpr char cDigit2char[NumericSystem::cHexadecimal] = {
@@ -578,22 +969,73 @@ namespace nowtech {
     /// See in LogConfig.
     LogSizeType const mChunkSize;
 
+    /// Subtracted from the tick if LogConfig::relativeTick is set.
+    uint64_t const mTickOrigin;
+
+    /// See LogConfig::wallClock.
+    WallClockCache mWallClockCache;
+
+    /// See LogConfig::emitSequenceTags.
+    std::atomic<uint32_t> mNextSequence;
+
     /// The next value of the artificial task ID. If overflows to 0, will
     /// remain there, so at most 255 tasks are allowed.
     TaskIdType mNextTaskId = 1u;
 
+    /// Shared by all the instances and never reset, so a topic value is
+    /// never given twice, even if the instances come and go.
     static std::atomic<LogTopicType> sNextFreeTopic;
 
-    /// Map used to turn OS-specific task IDs into the artificial counterparts.
-    std::map<uint32_t, TaskIdType> mTaskIds;
+    /// Open addressing hash table used to turn OS-specific task IDs into the
+    /// artificial counterparts. It has twice as many slots as task IDs, so
+    /// lookups stay short. Entries are never removed, and a slot is taken
+    /// once its ID is stored, so lookups need no lock.
+    static constexpr uint32_t cTaskSlotBits       = 9u;
+    static constexpr uint32_t cTaskSlotCount      = 1u << cTaskSlotBits;
+    static constexpr uint32_t cTaskHashMultiplier = 2654435769u;
+    uint32_t mTaskHandles[cTaskSlotCount] = {};
+    std::atomic<TaskIdType> mTaskSlotIds[cTaskSlotCount];
 
     /// Registry to check calls like Log::send(nowtech::LogTopicType::cSystem, "stuff to log")
-    std::map<LogTopicType, char const *> mRegisteredTopics;
+    bool mTopicRegistered[std::numeric_limits<LogTopicType>::max() + 1u] = {};
+    char const *mTopicPrefixes[std::numeric_limits<LogTopicType>::max() + 1u] = {};
+
+    /// Memory given by the user, nullptr to use the heap.
+    LogStorage const * const mStorage;
 
     /// Used for Chunk buffers during shift chain-type calls.
     char *mShiftChainingCallBuffers = nullptr;
 
-    /// Instance for static access.
+    /// Number of messages dropped in non-blocking mode.
+    std::atomic<uint32_t> mDroppedMessages;
+
+    /// Number of payload bytes lost in the dropped messages.
+    std::atomic<uint32_t> mDroppedBytes;
+
+    /// True for a task whose last message was dropped after some of its
+    /// chunks were enqueued, and the transmitter could not be notified yet.
+    /// Each flag is written only by the task owning the ID.
+    bool mAbortPending[std::numeric_limits<TaskIdType>::max() + 1u] = {};
+
+    /// Set by parkTransmitter() to stop the transmitter thread.
+    std::atomic<bool> mParkRequested;
+
+    /// Set by the transmitter thread when it has stopped using its buffers.
+    std::atomic<bool> mParked;
+
+    /// OS-specific ID of the transmitter thread, 0 while it does not run.
+    std::atomic<uint32_t> mTransmitterThreadId;
+
+    /// Tickets of Log::flush() calls, and of the last one whose preceding
+    /// messages are transmitted.
+    std::atomic<uint32_t> mFlushRequested;
+    std::atomic<uint32_t> mFlushCompleted;
+
+    /// Buffers of the transmitter thread, for drainAfterCrash().
+    std::atomic<CircularBuffer*> mCircularBuffer;
+    std::atomic<TransmitBuffers*> mTransmitBuffers;
+
+    /// The default instance for static access, the first one constructed.
     static Log *sInstance;
 
   public:
@@ -605,11 +1047,37 @@ namespace nowtech {
     /// @param aConfig configuration.
     Log(LogOsInterface &aOsInterface, LogConfig const &aConfig) noexcept;
 
-    /// Does nothing, because this object is not intended to be destroyed.
+    /// Creates a new Log instance using the buffers in aStorage, so it does
+    /// not allocate heap memory.
+    /// @param aStorage buffers sized according to aConfig, which must
+    /// outlive the Log instance.
+    Log(LogOsInterface &aOsInterface, LogConfig const &aConfig, LogStorage const &aStorage) noexcept;
+
+    /// Waits at most LogConfig::shutdownDrainTimeout for the messages
+    /// enqueued so far to be transmitted, then stops the transmitter thread.
     ~Log() noexcept {
+      if(mConfig.shutdownDrainTimeout > 0u) {
+        flush(*this, mConfig.shutdownDrainTimeout);
+      }
+      else { // nothing to do
+      }
       mKeepRunning.store(false);
       mOsInterface.joinTransmitterThread();
-      delete[] mShiftChainingCallBuffers;
+      if(mStorage == nullptr) {
+        delete[] mShiftChainingCallBuffers;
+      }
+      else { // nothing to do
+      }
+      if(sInstance == this) {
+        sInstance = nullptr;
+      }
+      else { // nothing to do
+      }
+    }
+
+    /// @return the default instance, or nullptr if there is none.
+    static Log *getDefault() noexcept {
+      return sInstance;
     }
 
     /// Registers the current task if not already present. It can register
@@ -619,6 +1087,12 @@ namespace nowtech {
       sInstance->doRegisterCurrentTask(nullptr);
     }
 
+    /// Registers the current task in aLog, like registerCurrentTask().
+    /// Tasks logging to several instances register in each of them.
+    static void registerCurrentTask(Log &aLog) noexcept {
+      aLog.doRegisterCurrentTask(nullptr);
+    }
+
     /// Registers the current task if not already present. It can register
     /// at most 255 tasks. All others will be handled as one.
     /// NOTE: this method locks to inhibit concurrent access of methods with the same name.
@@ -627,34 +1101,156 @@ namespace nowtech {
       sInstance->doRegisterCurrentTask(aTaskName);
     }
 
+    /// Registers the current task in aLog with the given name.
+    static void registerCurrentTask(Log &aLog, char const * const aTaskName) noexcept {
+      aLog.doRegisterCurrentTask(aTaskName);
+    }
+
     /// Registers the current log application
     /// at most 255 tasks. All others will be handled as one.
     static void registerTopic(LogTopicInstance &aTopic, char const * const aPrefix) noexcept {
-      aTopic = sNextFreeTopic.fetch_add(cFreeTopicIncrement);
-      sInstance->mRegisteredTopics[aTopic] = aPrefix;
+      registerTopic(*sInstance, aTopic, aPrefix);
+    }
+
+    /// Registers the topic in aLog. A topic already registered in an other
+    /// instance keeps its value, so it can be used with both.
+    static void registerTopic(Log &aLog, LogTopicInstance &aTopic, char const * const aPrefix) noexcept {
+      if(aTopic.mValue == LogTopicInstance::cInvalidTopic) {
+        aTopic = sNextFreeTopic.fetch_add(cFreeTopicIncrement);
+      }
+      else { // nothing to do
+      }
+      aLog.mTopicPrefixes[aTopic.mValue] = aPrefix;
+      aLog.mTopicRegistered[aTopic.mValue] = true;
     }
 
     /// Returns true if the given app was registered.
     static bool isRegistered(LogTopicType const aTopic) noexcept {
-      return sInstance->mRegisteredTopics.find(aTopic) != sInstance->mRegisteredTopics.end();
+      return isRegistered(*sInstance, aTopic);
+    }
+
+    static bool isRegistered(Log const &aLog, LogTopicType const aTopic) noexcept {
+      return aLog.mTopicRegistered[aTopic];
+    }
+
+    /// Returns the number of messages dropped so far in non-blocking mode.
+    static uint32_t getDroppedMessageCount() noexcept {
+      return getDroppedMessageCount(*sInstance);
+    }
+
+    static uint32_t getDroppedMessageCount(Log const &aLog) noexcept {
+      return aLog.mDroppedMessages.load();
+    }
+
+    /// Returns the number of payload bytes lost in the dropped messages.
+    static uint32_t getDroppedByteCount() noexcept {
+      return getDroppedByteCount(*sInstance);
+    }
+
+    static uint32_t getDroppedByteCount(Log const &aLog) noexcept {
+      return aLog.mDroppedBytes.load();
+    }
+
+    /// Returns the number of failed transmissions reported by the OsInterface.
+    static uint32_t getTransmitErrorCount() noexcept {
+      return getTransmitErrorCount(*sInstance);
+    }
+
+    static uint32_t getTransmitErrorCount(Log const &aLog) noexcept {
+      return aLog.mOsInterface.getTransmitErrorCount();
     }
 
     /// Transmitter thread implementation.
     void transmitterThreadFunction() noexcept;
 
+    /// Waits until every message enqueued before the call has been written
+    /// to the sink, for example before a planned exit or handover. Messages
+    /// still being composed by other tasks are not waited for. Returns at
+    /// once without a transmitter thread, like in a producer process of
+    /// LogShmRing, where the collector transmits. Needs a chunkSize of at
+    /// least Chunk::cFlushMarkerLength, and returns false at once otherwise.
+    /// @param aTimeout the longest wait in ms, including the wait for room in
+    /// the queue.
+    /// @return true if everything was written in time.
+    static bool flush(uint32_t const aTimeout) noexcept {
+      return sInstance == nullptr || flush(*sInstance, aTimeout);
+    }
+
+    /// Like flush(aTimeout) for aLog.
+    static bool flush(Log &aLog, uint32_t const aTimeout) noexcept;
+
+    /// Makes the transmitter thread stop before its next step, and leave its
+    /// buffers to drainAfterCrash(). Async-signal-safe.
+    static void parkTransmitter() noexcept {
+      if(sInstance != nullptr) {
+        parkTransmitter(*sInstance);
+      }
+      else { // nothing to do
+      }
+    }
+
+    static void parkTransmitter(Log &aLog) noexcept;
+
+    /// @return true if the transmitter thread does not use its buffers any
+    /// more: it has parked, it does not run, or it is the calling thread.
+    static bool isTransmitterParked() noexcept {
+      return sInstance == nullptr || isTransmitterParked(*sInstance);
+    }
+
+    static bool isTransmitterParked(Log const &aLog) noexcept;
+
+    /// Writes out everything pending in the TransmitBuffers, the
+    /// CircularBuffer and the queue, for use in a crash handler. The pending
+    /// message of the TransmitBuffers is continued first, then the messages
+    /// follow in the order of their first chunks. Messages whose end is not
+    /// there are terminated with cSeparatorFailure. Call after
+    /// parkTransmitter(), once isTransmitterParked() or after a timeout.
+    /// Async-signal-safe if aWrite and LogOsInterface::tryPop() are.
+    /// @param aChunks room for aCapacity chunks, allocated in advance.
+    /// @param aUsed room for aCapacity flags, allocated in advance.
+    static void drainAfterCrash(char * const aChunks, bool * const aUsed, LogSizeType const aCapacity, LogCrashWrite const aWrite) noexcept {
+      if(sInstance != nullptr) {
+        drainAfterCrash(*sInstance, aChunks, aUsed, aCapacity, aWrite);
+      }
+      else { // nothing to do
+      }
+    }
+
+    static void drainAfterCrash(Log &aLog, char * const aChunks, bool * const aUsed, LogSizeType const aCapacity, LogCrashWrite const aWrite) noexcept;
+
+    /// Helpers to render the reports without a Chunk, also used by the sinks.
+    /// No terminating zero is written.
+    /// @return the position after the last character written.
+    static char *render(char * const aWhere, char const * const aString) noexcept;
+    static char *render(char * const aWhere, uint32_t const aValue) noexcept;
+
     /// Starts a << operator chain with no argument
     /// Prefer using this starter instead of directly accessing the Log object,
     /// because this way less templates will be instantiated.
-    static LogShiftChainHelper i() noexcept;
+    static LogShiftChainHelper i() noexcept {
+      return i(*sInstance);
+    }
 
     /// Starts a << operator chain with the specified app
-    static LogShiftChainHelper i(LogTopicType const aTopic) noexcept;
+    static LogShiftChainHelper i(LogTopicType const aTopic) noexcept {
+      return i(*sInstance, aTopic);
+    }
 
     /// Starts a << operator chain with no argument, without printing header.
-    static LogShiftChainHelper n() noexcept;
+    static LogShiftChainHelper n() noexcept {
+      return n(*sInstance);
+    }
 
     /// Starts a << operator chain with the specified app, without printing header.
-    static LogShiftChainHelper n(LogTopicType const aTopic) noexcept;
+    static LogShiftChainHelper n(LogTopicType const aTopic) noexcept {
+      return n(*sInstance, aTopic);
+    }
+
+    /// The same starters logging to aLog.
+    static LogShiftChainHelper i(Log &aLog) noexcept;
+    static LogShiftChainHelper i(Log &aLog, LogTopicType const aTopic) noexcept;
+    static LogShiftChainHelper n(Log &aLog) noexcept;
+    static LogShiftChainHelper n(Log &aLog, LogTopicType const aTopic) noexcept;
 
     /// Starts a << operator chain with the specified argument.
     template<typename ArgumentType>
@@ -687,11 +1283,17 @@ namespace nowtech {
     /// If aTopic is registered, calls the normal send to process the arguments
     template<typename... Args>
     static void send(LogTopicType const aTopic, Args... args) noexcept {
-      if(sInstance->mConfig.allowVariadicTemplatesWork) {
-        char chunk[sInstance->mChunkSize];
-        Chunk appender = sInstance->startSend(static_cast<char*>(chunk), Chunk::cInvalidTaskId, aTopic);
+      send(*sInstance, aTopic, args...);
+    }
+
+    /// Like the one above, logging to aLog.
+    template<typename... Args>
+    static void send(Log &aLog, LogTopicType const aTopic, Args... args) noexcept {
+      if(aLog.mConfig.allowVariadicTemplatesWork) {
+        char chunk[aLog.mChunkSize];
+        Chunk appender = aLog.startSend(static_cast<char*>(chunk), Chunk::cInvalidTaskId, aTopic);
         if(appender.isValid()) {
-          sInstance->doSend(appender, args...);
+          aLog.doSend(appender, args...);
         }
         else { // nothing to do
         }
@@ -721,11 +1323,17 @@ namespace nowtech {
     /// automatically in the end.
     template<typename... Args>
     static void send(Args... args) noexcept {
-      if(sInstance->mConfig.allowVariadicTemplatesWork) {
-        char chunk[sInstance->mChunkSize];
-        Chunk appender = sInstance->startSend(static_cast<char*>(chunk), Chunk::cInvalidTaskId);
+      send(*sInstance, args...);
+    }
+
+    /// Like the one above, logging to aLog.
+    template<typename... Args>
+    static void send(Log &aLog, Args... args) noexcept {
+      if(aLog.mConfig.allowVariadicTemplatesWork) {
+        char chunk[aLog.mChunkSize];
+        Chunk appender = aLog.startSend(static_cast<char*>(chunk), Chunk::cInvalidTaskId);
         if(appender.isValid()) {
-          sInstance->doSend(appender, args...);
+          aLog.doSend(appender, args...);
         }
         else { // nothing to do
         }
@@ -737,11 +1345,17 @@ namespace nowtech {
     /// Similar to send but does not emit any preconfigured header.
     template<typename... Args>
     static void sendNoHeader(LogTopicType aTopic, Args... args) noexcept {
-      if(sInstance->mConfig.allowVariadicTemplatesWork) {
-        char chunk[sInstance->mChunkSize];
-        Chunk appender = sInstance->startSendNoHeader(static_cast<char*>(chunk), Chunk::cInvalidTaskId, aTopic);
+      sendNoHeader(*sInstance, aTopic, args...);
+    }
+
+    /// Like the one above, logging to aLog.
+    template<typename... Args>
+    static void sendNoHeader(Log &aLog, LogTopicType aTopic, Args... args) noexcept {
+      if(aLog.mConfig.allowVariadicTemplatesWork) {
+        char chunk[aLog.mChunkSize];
+        Chunk appender = aLog.startSendNoHeader(static_cast<char*>(chunk), Chunk::cInvalidTaskId, aTopic);
         if(appender.isValid()) {
-          sInstance->doSend(appender, args...);
+          aLog.doSend(appender, args...);
         }
         else { // nothing to do
         }
@@ -753,11 +1367,17 @@ namespace nowtech {
     /// Similar to send but does not emit any preconfigured header.
     template<typename... Args>
     static void sendNoHeader(Args... args) noexcept {
-      if(sInstance->mConfig.allowVariadicTemplatesWork) {
-        char chunk[sInstance->mChunkSize];
-        Chunk appender = sInstance->startSendNoHeader(static_cast<char*>(chunk), Chunk::cInvalidTaskId);
+      sendNoHeader(*sInstance, args...);
+    }
+
+    /// Like the one above, logging to aLog.
+    template<typename... Args>
+    static void sendNoHeader(Log &aLog, Args... args) noexcept {
+      if(aLog.mConfig.allowVariadicTemplatesWork) {
+        char chunk[aLog.mChunkSize];
+        Chunk appender = aLog.startSendNoHeader(static_cast<char*>(chunk), Chunk::cInvalidTaskId);
         if(appender.isValid()) {
-          sInstance->doSend(appender, args...);
+          aLog.doSend(appender, args...);
         }
         else { // nothing to do
         }
@@ -766,14 +1386,19 @@ namespace nowtech {
       }
     }
 
-    /// Sends the trailing newline character.
-    void finishSend(Chunk &aChunk) noexcept {
-      aChunk.flush();
-    }
+    /// Sends the trailing newline character and accounts the message if
+    /// it was dropped.
+    void finishSend(Chunk &aChunk) noexcept;
 
 private:
+    Log(LogOsInterface &aOsInterface, LogConfig const &aConfig, LogStorage const * const aStorage) noexcept;
+
     void doRegisterCurrentTask(char const * const) noexcept;
 
+    /// @return the slot of aHandle in the task hash table, or the empty slot
+    /// where it would go.
+    uint32_t findTaskSlot(uint32_t const aHandle) const noexcept;
+
     /// Defined in .cpp to allow stub
     TaskIdType getCurrentTaskId() const noexcept;
 
@@ -805,10 +1430,41 @@ private:
       doSend(aChunk, aArgs...);
     }
 
+    /// Length of the buffer holding the line reporting dropped messages.
+    static constexpr LogSizeType cDropMarkerLength = 64u;
+
+    /// Emits a line about the messages dropped since the last report.
+    void reportDrop(TransmitBuffers &aTransmitBuffers, uint32_t const aMessages, uint32_t const aBytes) noexcept;
+
+    /// Writes the chunks of aTaskId from aFrom on up to the end of its
+    /// message, and marks them used.
+    /// @param aStarted true if the beginning of the message was already written.
+    void drainMessage(char const * const aChunks, bool * const aUsed, LogSizeType const aCount, LogSizeType const aFrom
+      , TaskIdType const aTaskId, bool const aStarted, LogCrashWrite const aWrite) noexcept;
+
+    /// Emits a line about the transmission errors since the last report.
+    void reportTransmitErrors(TransmitBuffers &aTransmitBuffers, uint32_t const aErrors, uint32_t const aLastError) noexcept;
+
     Chunk startSend(char * const aChunkBuffer, TaskIdType const aTaskId) noexcept;
     Chunk startSend(char * const aChunkBuffer, TaskIdType const aTaskId, LogTopicType aTopic) noexcept;
+    Chunk startSend(char * const aChunkBuffer, TaskIdType const aTaskId, LogTopicType const aTopic, char const * const aTopicName) noexcept;
     Chunk startSendNoHeader(char * const aChunkBuffer, TaskIdType const aTaskId) noexcept;
     Chunk startSendNoHeader(char * const aChunkBuffer, TaskIdType const aTaskId, LogTopicType aTopic) noexcept;
+    /// Reads the clock given in LogConfig::tickSource, without mTickOrigin.
+    uint64_t readTick() const noexcept;
+
+    /// Returns the tick for the message header.
+    uint64_t getTick() const noexcept;
+
+    /// Appends the wall clock with a separator as in LogConfig::wallClock.
+    void appendWallClock(Chunk &aChunk) noexcept;
+
+    /// Fills aEntry for aSecond from mWallClockCache, or renders and caches
+    /// it, so LogOsInterface::getUtcOffset() is called at most once a second.
+    void getWallClockEntry(uint64_t const aSecond, WallClockCache::Entry &aEntry) noexcept;
+
+    /// Starts the message with its topic tag, if needed.
+    Chunk startSendTagged(char * const aChunkBuffer, TaskIdType const aTaskId, LogTopicType const aTopic) noexcept;
 
     void append(Chunk &aChunk, LogFormat const & aFormat, char const * const aValue) noexcept {
       append(aChunk, aValue);
@@ -847,20 +1503,27 @@ private:
     }
 
     void append(Chunk &aChunk, LogFormat const & aFormat, float const aValue) noexcept {
-      append(aChunk, static_cast<double>(aValue), aFormat.fill);
+      append(aChunk, aValue, aFormat.fill);
     }
 
     void append(Chunk &aChunk, LogFormat const & aFormat, double const aValue) noexcept {
       append(aChunk, aValue, aFormat.fill);
     }
 
+    void append(Chunk &aChunk, LogFormat const & /*aFormat*/, LogLiteral const aValue) noexcept {
+      append(aChunk, aValue);
+    }
+
     template<typename T>
     void append(Chunk &aChunk, LogFormat const & aFormat, T const aValue) noexcept {
       append(aChunk, "-=unknown=-");
     }
 
     void append(Chunk &aChunk, bool const aBool) noexcept {
-      if(aBool) {
+      if(mConfig.binaryFormat) {
+        pushBinary(aChunk, static_cast<char>(LogBinary::makeTag(LogBinary::cBool, 0u, aBool)));
+      }
+      else if(aBool) {
         append(aChunk, "true");
       }
       else {
@@ -875,7 +1538,13 @@ private:
     /// @param ch character to append.
     /// @return true if succeeded, false if truncation occurs or buffer was full.
     void append(Chunk &aChunk, char const aCh) noexcept {
-      aChunk.push(aCh);
+      if(mConfig.binaryFormat) {
+        pushBinary(aChunk, static_cast<char>(LogBinary::makeTag(LogBinary::cChar, 0u, false)));
+        pushBinary(aChunk, aCh);
+      }
+      else {
+        pushText(aChunk, aCh);
+      }
     }
 
     /// Uses append(char const ch) to send the string character by character.
@@ -883,9 +1552,12 @@ private:
     /// @return the return value of the last append(char const ch) call.
     void append(Chunk &aChunk, char const * const aString) noexcept {
       char const * pointer = aString;
-      if(pointer != nullptr) {
+      if(mConfig.binaryFormat) {
+        appendBinary(aChunk, LogBinary::cString, aString);
+      }
+      else if(pointer != nullptr) {
         while(*pointer != 0) {
-          aChunk.push(*pointer);
+          pushText(aChunk, *pointer);
           ++pointer;
         }
       }
@@ -952,13 +1624,24 @@ private:
     }
 
     void append(Chunk &aChunk, float const aValue) noexcept {
-      append(aChunk, static_cast<double>(aValue), mConfig.floatFormat.fill);
+      append(aChunk, aValue, mConfig.floatFormat.fill);
     }
 
     void append(Chunk &aChunk, double const aValue) noexcept {
       append(aChunk, aValue, mConfig.doubleFormat.fill);
     }
 
+    /// Appends the text of the literal, or only its ID in binary mode.
+    void append(Chunk &aChunk, LogLiteral const aValue) noexcept {
+      if(mConfig.binaryFormat) {
+        pushBinary(aChunk, static_cast<char>(LogBinary::makeTag(LogBinary::cLiteral, 0u, false)));
+        pushLittleEndian(aChunk, aValue.id, sizeof(aValue.id));
+      }
+      else {
+        append(aChunk, aValue.text);
+      }
+    }
+
     /// Converts the number to string in a stack buffer and uses append(char
     /// const ch) to send it character by character. If the conversion fails
     /// (due to invalid base or too small buffer on stack) a # will be appended
@@ -971,6 +1654,18 @@ private:
     /// @return the return value of the last append(char const ch) call.
     template<typename T>
     void append(Chunk &aChunk, T const value, T const base, uint8_t const fill) noexcept {
+      if(mConfig.binaryFormat) {
+        if(std::is_signed<T>::value) {
+          int64_t const signedValue = static_cast<int64_t>(value);
+          appendBinary(aChunk, LogBinary::cSigned, (static_cast<uint64_t>(signedValue) << 1u) ^ static_cast<uint64_t>(signedValue >> 63u), static_cast<uint32_t>(base), fill);
+        }
+        else {
+          appendBinary(aChunk, LogBinary::cUnsigned, static_cast<uint64_t>(value), static_cast<uint32_t>(base), fill);
+        }
+        return;
+      }
+      else { // nothing to do
+      }
       T tmpValue = value;
       uint8_t tmpFill = fill;
       if((base != NumericSystem::cBinary) && (base != NumericSystem::cDecimal) && (base != NumericSystem::cHexadecimal)) {
@@ -1034,6 +1729,45 @@ private:
     }
 
     void append(Chunk &aChunk, double const aValue, uint8_t const aDigitsNeeded) noexcept;
+
+    /// Sends floats as 4 bytes in binary mode, otherwise as doubles.
+    void append(Chunk &aChunk, float const aValue, uint8_t const aDigitsNeeded) noexcept;
+
+    /// Pushes a character of a text message, marking the line ends for the
+    /// sinks parsing the messages, see cLineBreakTag.
+    void pushText(Chunk &aChunk, char const aCh) noexcept {
+      if(aCh == Chunk::cEndOfLine && (mConfig.tagLineBreaks || mConfig.emitTopicTags || mConfig.emitSequenceTags)) {
+        aChunk.push(cLineBreakTag);
+      }
+      else { // nothing to do
+      }
+      aChunk.push(aCh);
+    }
+
+    /// Pushes a byte of a binary item, escaping the ones the transmitter would interpret.
+    void pushBinary(Chunk &aChunk, char const aByte) noexcept {
+      if(LogBinary::needsEscape(aByte)) {
+        aChunk.push(LogBinary::cEscape);
+        aChunk.push(static_cast<char>(aByte ^ LogBinary::cEscapeFlip));
+      }
+      else {
+        aChunk.push(aByte);
+      }
+    }
+
+    void pushLittleEndian(Chunk &aChunk, uint64_t const aValue, uint8_t const aBytes) noexcept {
+      for(uint8_t i = 0u; i < aBytes; ++i) {
+        pushBinary(aChunk, static_cast<char>(aValue >> (i * 8u)));
+      }
+    }
+
+    void pushVarint(Chunk &aChunk, uint64_t const aValue) noexcept;
+
+    /// Appends a numeric item of the given type with its format.
+    void appendBinary(Chunk &aChunk, uint8_t const aType, uint64_t const aValue, uint32_t const aBase, uint8_t const aFill) noexcept;
+
+    /// Appends a string item of the given type.
+    void appendBinary(Chunk &aChunk, uint8_t const aType, char const * const aString) noexcept;
   };// class Log
 
   template<typename ArgumentType>
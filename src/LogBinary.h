@@ -0,0 +1,126 @@
+/*
+ * Copyright 2018 Now Technologies Zrt.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+ * THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef NOWTECH_LOG_BINARY_INCLUDED
+#define NOWTECH_LOG_BINARY_INCLUDED
+
+#include <cstdint>
+
+namespace nowtech {
+
+  /// Constants of the binary wire format, used when LogConfig::binaryFormat
+  /// is true. Each message still ends in Chunk::cEndOfLine, and starts with
+  /// cRecordStart to tell it from the textual lines of the transmitter.
+  /// Items follow, each starting with a tag byte: the high nibble is the item
+  /// type, bits 3..2 are the numeric system and bit 0 tells if a fill or
+  /// digit count byte follows. For cBool bit 0 is the value itself.
+  /// Integers are LEB128 varints, signed ones zigzag encoded first. Floating
+  /// point numbers and literal IDs are little endian. Strings have a varint
+  /// length prefix.
+  /// Any byte equal to Chunk::cEndOfLine, Chunk::cEndOfMessage,
+  /// Chunk::cAbortMessage, Chunk::cFlushMarker, Chunk::cSingleChunk,
+  /// Log::cLineBreakTag or cEscape is sent as cEscape and the byte XOR
+  /// cEscapeFlip.
+  class LogBinary final {
+  public:
+    static constexpr char    cRecordStart = '\x1e';
+    static constexpr char    cEscape      = '\x1b';
+    static constexpr uint8_t cEscapeFlip  = 0x20u;
+
+    static constexpr uint8_t cTypeShift   = 4u;
+    static constexpr uint8_t cBaseShift   = 2u;
+    static constexpr uint8_t cBaseMask    = 3u;
+    static constexpr uint8_t cFollowsFlag = 1u;
+
+    static constexpr uint8_t cUnsigned = 1u;
+    static constexpr uint8_t cSigned   = 2u;
+    static constexpr uint8_t cFloat    = 3u;
+    static constexpr uint8_t cDouble   = 4u;
+    static constexpr uint8_t cLiteral  = 5u;
+    static constexpr uint8_t cString   = 6u;
+    static constexpr uint8_t cChar     = 7u;
+    static constexpr uint8_t cBool     = 8u;
+    static constexpr uint8_t cTaskId   = 9u;
+    static constexpr uint8_t cTaskName = 10u;
+    static constexpr uint8_t cTick     = 11u;
+    static constexpr uint8_t cTopic    = 12u;
+    /// Varint ns since the Unix epoch in UTC, the fill byte is the number of
+    /// fraction digits to show. If the numeric system bits are
+    /// cWallClockLocal, a zigzag encoded varint UTC offset in seconds follows.
+    static constexpr uint8_t cWallClock = 13u;
+
+    static constexpr uint8_t cWallClockLocal = 1u;
+
+    /// Codes of the numeric systems in the tag. 0 means invalid.
+    static constexpr uint8_t cBaseBinary      = 1u;
+    static constexpr uint8_t cBaseDecimal     = 2u;
+    static constexpr uint8_t cBaseHexadecimal = 3u;
+
+    static constexpr uint8_t makeTag(uint8_t const aType, uint8_t const aBase, bool const aFollows) noexcept {
+      return static_cast<uint8_t>((aType << cTypeShift) | ((aBase & cBaseMask) << cBaseShift) | (aFollows ? cFollowsFlag : 0u));
+    }
+
+    static constexpr uint8_t encodeBase(uint32_t const aBase) noexcept {
+      return aBase == 2u ? cBaseBinary : (aBase == 10u ? cBaseDecimal : (aBase == 16u ? cBaseHexadecimal : 0u));
+    }
+
+    static constexpr bool needsEscape(char const aByte) noexcept {
+      return aByte == '\n' || aByte == '\r' || aByte == '\x18' || aByte == '\x17' || aByte == '\x16' || aByte == '\x13' || aByte == cEscape;
+    }
+  };
+
+  /// FNV-1a hash of the literal, used as its ID in the binary format.
+  constexpr uint32_t logLiteralId(char const * const aText) noexcept {
+    uint32_t hash = 2166136261u;
+    for(char const *pointer = aText; *pointer != 0; ++pointer) {
+      hash = (hash ^ static_cast<uint8_t>(*pointer)) * 16777619u;
+    }
+    return hash;
+  }
+
+  /// A string literal with its ID. Should be created using LOG_LITERAL. In
+  /// text mode the text is appended, in binary mode only the ID.
+  struct LogLiteral final {
+    uint32_t const id;
+    char const * const text;
+
+    constexpr LogLiteral(uint32_t const aId, char const * const aText) noexcept
+      : id(aId)
+      , text(aText) {
+    }
+  };
+
+} //namespace nowtech
+
+/// Turns a string literal into a LogLiteral and records it in the
+/// nowtech_log_dict ELF section as a zero terminated string. The section is
+/// not allocated, so the dictionary takes no space in the image. It can be
+/// extracted using objcopy --dump-section nowtech_log_dict=dict.bin app.
+/// Only a single string literal is allowed, not a concatenation of several
+/// ones.
+#define LOG_LITERAL(aText) ([]() noexcept { \
+  __asm__ __volatile__(".pushsection nowtech_log_dict,\"\",%progbits\n.asciz " #aText "\n.popsection"); \
+  return nowtech::LogLiteral(nowtech::logLiteralId(aText), aText); \
+}())
+
+#endif // NOWTECH_LOG_BINARY_INCLUDED
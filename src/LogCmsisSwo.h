@@ -76,15 +76,20 @@ namespace nowtech {
     }
 
     /// Sends the chunk contents immediately.
-    virtual void push(char const * const aChunkStart, bool const) noexcept {
+    virtual bool push(char const * const aChunkStart, bool const) noexcept {
+      LogSizeType const first = aChunkStart[1] == Chunk::cSingleChunk ? 2u : 1u;
       LogSizeType length;
-      for(length = 0; length < mChunkSize - 1; ++length) {
-        ITM_SendChar(static_cast<uint32_t>(aChunkStart[length + 1]));
-        if(aChunkStart[length + 1] == '\n') {
+      for(length = 0; length < mChunkSize - first; ++length) {
+        if(aChunkStart[length + first] == Chunk::cEndOfMessage) {
+          ITM_SendChar(static_cast<uint32_t>(Chunk::cEndOfLine));
           ++length;
           break;
         }
+        else {
+          ITM_SendChar(static_cast<uint32_t>(aChunkStart[length + first]));
+        }
       }
+      return true;
     }
 
     /// Does nothing.
@@ -0,0 +1,57 @@
+/*
+ * Copyright 2018 Now Technologies Zrt.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+ * THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef NOWTECH_LOG_COMPRESSING_SINK_INCLUDED
+#define NOWTECH_LOG_COMPRESSING_SINK_INCLUDED
+
+#include "LogSink.h"
+#include "LogLz.h"
+
+namespace nowtech {
+
+  /// Sink compressing each transmission buffer into an independent,
+  /// self-delimiting LogLz block, and passing the blocks to the next sink.
+  /// The stream can be decompressed by tools/logunz.cpp. As the blocks are
+  /// independent, a truncated stream loses at most its last block.
+  class LogCompressingSink final : public LogDecoratorSink {
+  private:
+    uint32_t         mHashTable[LogLz::cHashTableLength];
+
+  public:
+    /// @param aNext the sink receiving the compressed blocks, not owned.
+    LogCompressingSink(LogSink &aNext) noexcept
+      : LogDecoratorSink(aNext) {
+    }
+
+    /// The next sink clears the progress flag.
+    virtual void write(LogBufferSlice const * const aSlices, LogSizeType const aCount, std::atomic<bool> *aProgressFlag) noexcept override;
+
+  protected:
+    virtual LogSizeType getOutputLength(LogSizeType const aInputLength) const noexcept override {
+      return static_cast<LogSizeType>(LogLz::getBound(aInputLength));
+    }
+  };
+
+} //namespace nowtech
+
+#endif // NOWTECH_LOG_COMPRESSING_SINK_INCLUDED
@@ -0,0 +1,145 @@
+//
+// Copyright 2018 Now Technologies Zrt.
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge,
+// publish, distribute, sublicense, and/or sell copies of the Software,
+// and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#include "LogCrashHandler.h"
+#include "LogFlightRecorderSink.h"
+#include <cerrno>
+#include <ctime>
+#include <unistd.h>
+
+constexpr int nowtech::LogCrashHandler::cSignals[];
+constexpr uint32_t nowtech::LogCrashHandler::cSignalCount;
+constexpr uint32_t nowtech::LogCrashHandler::cParkTimeout;
+constexpr size_t nowtech::LogCrashHandler::cAltStackSize;
+
+nowtech::LogCrashHandler *nowtech::LogCrashHandler::sInstance = nullptr;
+std::atomic<bool> nowtech::LogCrashHandler::sEntered(false);
+
+nowtech::LogCrashHandler::LogCrashHandler(int const aFd, LogConfig const &aConfig, LogSizeType const aCapacity, LogFlightRecorderSink * const aRecorder) noexcept
+  : mFd(aFd)
+  , mCapacity(aCapacity)
+  , mChunks(new char[aCapacity * aConfig.chunkSize])
+  , mUsed(new bool[aCapacity])
+  , mAltStack(new char[cAltStackSize])
+  , mRecorder(aRecorder) {
+  sInstance = this;
+  stack_t stack;
+  stack.ss_sp = mAltStack;
+  stack.ss_size = cAltStackSize;
+  stack.ss_flags = 0;
+  sigaltstack(&stack, nullptr);
+  struct sigaction action;
+  action.sa_sigaction = handle;
+  sigemptyset(&action.sa_mask);
+  action.sa_flags = SA_SIGINFO | SA_ONSTACK;
+  for(uint32_t i = 0u; i < cSignalCount; ++i) {
+    sigaction(cSignals[i], &action, &mPrevious[i]);
+  }
+}
+
+nowtech::LogCrashHandler::~LogCrashHandler() noexcept {
+  for(uint32_t i = 0u; i < cSignalCount; ++i) {
+    sigaction(cSignals[i], &mPrevious[i], nullptr);
+  }
+  stack_t stack;
+  stack.ss_sp = nullptr;
+  stack.ss_size = 0u;
+  stack.ss_flags = SS_DISABLE;
+  sigaltstack(&stack, nullptr);
+  sInstance = nullptr;
+  delete[] mAltStack;
+  delete[] mUsed;
+  delete[] mChunks;
+}
+
+void nowtech::LogCrashHandler::handle(int const aSignal, siginfo_t * const, void * const) noexcept {
+  LogCrashHandler * const self = sInstance;
+  if(self != nullptr && !sEntered.exchange(true)) {
+    Log::parkTransmitter();
+    timespec step;
+    step.tv_sec = 0;
+    step.tv_nsec = 1000000;
+    for(uint32_t i = 0u; i < cParkTimeout && !Log::isTransmitterParked(); ++i) {
+      nanosleep(&step, nullptr);
+    }
+    // -=- signal 11, draining -=-
+    char marker[32] = "-=- signal ";
+    char *end = marker + sizeof("-=- signal ") - 1u;
+    char digits[4];
+    int count = 0;
+    for(int value = aSignal; value > 0 && count < 4; value /= 10) {
+      digits[count] = static_cast<char>('0' + value % 10);
+      ++count;
+    }
+    while(count > 0) {
+      --count;
+      *end = digits[count];
+      ++end;
+    }
+    for(char const *pointer = ", draining -=-\n"; *pointer != 0; ++pointer) {
+      *end = *pointer;
+      ++end;
+    }
+    write(marker, static_cast<LogSizeType>(end - marker));
+    if(self->mRecorder != nullptr) {
+      self->mRecorder->dumpAfterCrash(write);
+    }
+    else { // nothing to do
+    }
+    Log::drainAfterCrash(self->mChunks, self->mUsed, self->mCapacity, write);
+  }
+  else { // nothing to do
+  }
+  if(self != nullptr) {
+    for(uint32_t i = 0u; i < cSignalCount; ++i) {
+      if(cSignals[i] == aSignal) {
+        sigaction(aSignal, &self->mPrevious[i], nullptr);
+      }
+      else { // nothing to do
+      }
+    }
+  }
+  else { // nothing to do
+  }
+  // Delivered when the handler returns, as the signal is blocked until then.
+  raise(aSignal);
+}
+
+void nowtech::LogCrashHandler::write(char const * const aData, LogSizeType const aLength) noexcept {
+  int const savedErrno = errno;
+  char const *data = aData;
+  LogSizeType left = aLength;
+  while(left > 0u) {
+    ssize_t const written = ::write(sInstance->mFd, data, left);
+    if(written > 0) {
+      data += written;
+      left -= static_cast<LogSizeType>(written);
+    }
+    else if(written < 0 && errno == EINTR) { // try again
+    }
+    else {
+      left = 0u;
+    }
+  }
+  errno = savedErrno;
+}
@@ -0,0 +1,92 @@
+/*
+ * Copyright 2018 Now Technologies Zrt.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+ * THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef NOWTECH_LOG_CRASH_HANDLER_INCLUDED
+#define NOWTECH_LOG_CRASH_HANDLER_INCLUDED
+
+#include "Log.h"
+#include <atomic>
+#include <csignal>
+
+namespace nowtech {
+
+  class LogFlightRecorderSink;
+
+  /// Opt-in emergency drain for Linux. On a fatal signal it stops the
+  /// transmitter thread, writes everything still pending in its buffers and
+  /// in the queue to a file descriptor with raw write() calls, then lets the
+  /// signal have the effect of the previous handler. It uses only
+  /// async-signal-safe operations: the memory is allocated in advance and
+  /// nothing is locked. Messages not completely enqueued are terminated with
+  /// Log::cSeparatorFailure. The transmitter is given cParkTimeout ms to
+  /// finish its current write, after that its buffers are read anyway.
+  /// If a LogFlightRecorderSink is given, its ring is written first, as it
+  /// holds the oldest messages.
+  /// Only one instance may exist, constructed after the Log.
+  class LogCrashHandler final : public BanCopyMove {
+  public:
+    /// The signals handled.
+    static constexpr int cSignals[] = { SIGSEGV, SIGBUS, SIGFPE, SIGILL, SIGABRT };
+    static constexpr uint32_t cSignalCount = sizeof(cSignals) / sizeof(cSignals[0]);
+
+    /// ms to wait at most for the transmitter thread to park.
+    static constexpr uint32_t cParkTimeout = 200u;
+
+    /// Size of the alternate signal stack, so a stack overflow can be handled.
+    static constexpr size_t cAltStackSize = 65536u;
+
+  private:
+    int const          mFd;
+    LogSizeType const  mCapacity;
+    char * const       mChunks;
+    bool * const       mUsed;
+    char * const       mAltStack;
+    LogFlightRecorderSink * const mRecorder;
+    struct sigaction   mPrevious[cSignalCount];
+
+    static LogCrashHandler *sInstance;
+    static std::atomic<bool> sEntered;
+
+  public:
+    /// Installs the handler. The alternate signal stack is set for the
+    /// calling thread only.
+    /// @param aFd where to write, like the log file or STDERR_FILENO.
+    /// @param aConfig the configuration of the Log.
+    /// @param aCapacity how many chunks of the CircularBuffer and the queue
+    /// are drained at most.
+    /// @param aRecorder the flight recorder to dump, if any, not owned.
+    LogCrashHandler(int const aFd, LogConfig const &aConfig, LogSizeType const aCapacity = 1024u, LogFlightRecorderSink * const aRecorder = nullptr) noexcept;
+
+    /// Restores the previous handlers.
+    ~LogCrashHandler() noexcept;
+
+  private:
+    static void handle(int const aSignal, siginfo_t * const, void * const) noexcept;
+
+    /// Writes all the data, retrying on EINTR and partial writes.
+    static void write(char const * const aData, LogSizeType const aLength) noexcept;
+  };
+
+} //namespace nowtech
+
+#endif // NOWTECH_LOG_CRASH_HANDLER_INCLUDED
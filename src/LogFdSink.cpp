@@ -0,0 +1,110 @@
+//
+// Copyright 2018 Now Technologies Zrt.
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge,
+// publish, distribute, sublicense, and/or sell copies of the Software,
+// and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#include "LogFdSink.h"
+#include <unistd.h>
+#include <cerrno>
+#include <ctime>
+
+nowtech::LogFdSink::LogFdSink(int const aFd, uint32_t const aSyncBytes, uint32_t const aSyncPeriod) noexcept
+  : mFd(aFd)
+  , mSyncBytes(aSyncBytes)
+  , mSyncPeriod(aSyncPeriod)
+  , mLastSync(now()) {
+}
+
+nowtech::LogFdSink::~LogFdSink() noexcept {
+  sync();
+}
+
+void nowtech::LogFdSink::write(LogBufferSlice const * const aSlices, LogSizeType const aCount, std::atomic<bool> *aProgressFlag) noexcept {
+  iovec vectors[cMaxGather];
+  for(LogSizeType i = 0u; i < aCount; ++i) {
+    vectors[i].iov_base = const_cast<char*>(aSlices[i].buffer);
+    vectors[i].iov_len = aSlices[i].length;
+  }
+  mUnsyncedBytes += writeVectors(vectors, static_cast<int>(aCount));
+  aProgressFlag->store(false);
+  if(mSyncBytes > 0u && mUnsyncedBytes >= mSyncBytes) {
+    sync();
+  }
+  else {
+    poll();
+  }
+}
+
+void nowtech::LogFdSink::poll() noexcept {
+  if(mSyncPeriod > 0u && mUnsyncedBytes > 0u && now() - mLastSync >= mSyncPeriod) {
+    sync();
+  }
+  else { // nothing to do
+  }
+}
+
+uint64_t nowtech::LogFdSink::writeVectors(iovec *aVectors, int aCount) noexcept {
+  uint64_t result = 0u;
+  while(aCount > 0) {
+    ssize_t written = writev(mFd, aVectors, aCount);
+    if(written >= 0) {
+      result += static_cast<uint64_t>(written);
+      while(aCount > 0 && static_cast<size_t>(written) >= aVectors->iov_len) {
+        written -= static_cast<ssize_t>(aVectors->iov_len);
+        ++aVectors;
+        --aCount;
+      }
+      if(aCount > 0) {
+        aVectors->iov_base = static_cast<char*>(aVectors->iov_base) + written;
+        aVectors->iov_len -= static_cast<size_t>(written);
+      }
+      else { // nothing to do
+      }
+    }
+    else if(errno == EINTR) { // retry
+    }
+    else {
+      reportError(static_cast<uint32_t>(errno));
+      break;
+    }
+  }
+  return result;
+}
+
+void nowtech::LogFdSink::sync() noexcept {
+  if((mSyncBytes > 0u || mSyncPeriod > 0u) && mUnsyncedBytes > 0u) {
+    if(fdatasync(mFd) != 0) {
+      reportError(static_cast<uint32_t>(errno));
+    }
+    else { // nothing to do
+    }
+    mUnsyncedBytes = 0u;
+  }
+  else { // nothing to do
+  }
+  mLastSync = now();
+}
+
+uint64_t nowtech::LogFdSink::now() noexcept {
+  timespec time;
+  clock_gettime(CLOCK_MONOTONIC_COARSE, &time);
+  return static_cast<uint64_t>(time.tv_sec) * 1000u + static_cast<uint64_t>(time.tv_nsec) / 1000000u;
+}
@@ -0,0 +1,88 @@
+/*
+ * Copyright 2018 Now Technologies Zrt.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+ * THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef NOWTECH_LOG_FD_SINK_INCLUDED
+#define NOWTECH_LOG_FD_SINK_INCLUDED
+
+#include "LogSink.h"
+#include <sys/uio.h>
+#include <cstdint>
+
+namespace nowtech {
+
+  /// Sink writing a file descriptor with writev, several transmission buffers
+  /// in one call. Optionally makes the data durable with fdatasync, which is
+  /// batched like a group commit: it happens once aSyncBytes were written or
+  /// aSyncPeriod ms elapsed since the previous one, whichever comes first.
+  class LogFdSink : public LogSink {
+  public:
+    /// Maximum number of buffers handed over in a single writev call.
+    static constexpr LogSizeType cMaxGather = 64u;
+
+  protected:
+    /// File descriptor to write, not owned.
+    int mFd;
+
+  private:
+    uint32_t const mSyncBytes;
+    uint32_t const mSyncPeriod;
+    uint64_t mUnsyncedBytes = 0u;
+
+    /// CLOCK_MONOTONIC_COARSE time of the last synchronization in ms.
+    uint64_t mLastSync;
+
+  public:
+    /// The class does not own the file descriptor and only writes to it.
+    /// Opening and closing it is user responsibility.
+    /// @param aFd file descriptor to write, like STDOUT_FILENO.
+    /// @param aSyncBytes fdatasync after this many bytes, 0 to disable.
+    /// @param aSyncPeriod fdatasync after this many ms if there was any write
+    /// since the previous one, 0 to disable. The precision is limited by
+    /// LogConfig::pauseLength.
+    LogFdSink(int const aFd, uint32_t const aSyncBytes = 0u, uint32_t const aSyncPeriod = 0u) noexcept;
+
+    virtual ~LogFdSink() noexcept;
+
+    virtual LogSizeType getGatherLimit() const noexcept override {
+      return cMaxGather;
+    }
+
+    virtual void write(LogBufferSlice const * const aSlices, LogSizeType const aCount, std::atomic<bool> *aProgressFlag) noexcept override;
+
+    /// Synchronizes if the period has elapsed.
+    virtual void poll() noexcept override;
+
+  protected:
+    /// Writes the whole iovec array, continuing after partial writes and EINTR.
+    /// @return the number of bytes written.
+    uint64_t writeVectors(iovec *aVectors, int aCount) noexcept;
+
+    /// Synchronizes the pending data, if any and synchronization is enabled.
+    void sync() noexcept;
+
+    static uint64_t now() noexcept;
+  };
+
+} //namespace nowtech
+
+#endif // NOWTECH_LOG_FD_SINK_INCLUDED
@@ -0,0 +1,204 @@
+//
+// Copyright 2018 Now Technologies Zrt.
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge,
+// publish, distribute, sublicense, and/or sell copies of the Software,
+// and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#include "LogFlightRecorderSink.h"
+
+constexpr char nowtech::LogFlightRecorderSink::cDumpStart[];
+constexpr char nowtech::LogFlightRecorderSink::cDumpEnd[];
+
+nowtech::LogFlightRecorderSink::LogFlightRecorderSink(LogSink &aNext, LogTopicMask const &aRecorded, LogTopicMask const &aTriggers, LogSizeType const aCapacity) noexcept
+  : LogDecoratorSink(aNext)
+  , mRecorded(aRecorded)
+  , mTriggers(aTriggers)
+  , mCapacity(aCapacity)
+  , mRing(new char[aCapacity]) {
+  mTriggered.store(false);
+  mDumpCount.store(0u);
+  mDroppedMessages.store(0u);
+}
+
+nowtech::LogFlightRecorderSink::~LogFlightRecorderSink() noexcept {
+  delete[] mRing;
+}
+
+void nowtech::LogFlightRecorderSink::write(LogBufferSlice const * const aSlices, LogSizeType const aCount, std::atomic<bool> *aProgressFlag) noexcept {
+  if(checkOutputs(aProgressFlag)) {
+    if(mTriggered.exchange(false)) {
+      dump();
+    }
+    else { // nothing to do
+    }
+    LogSizeType outputCount = 0u;
+    for(LogSizeType i = 0u; i < aCount; ++i) {
+      mSlices[outputCount].buffer = mOutputs[outputCount];
+      mSlices[outputCount].length = 0u;
+      char const *data = aSlices[i].buffer;
+      char const * const end = data + aSlices[i].length;
+      while(data < end) {
+        char const *part;
+        bool messageStart;
+        bool messageEnd;
+        LogSizeType const length = mParser.parse(data, end, part, messageStart, messageEnd);
+        if(length > 0u && messageStart) {
+          mRecording = false;
+          mDropping = false;
+          mMessageLength = 0u;
+          if(mTriggers.contains(mParser.getTopic())) {
+            // The history goes right before the message triggering it.
+            if(outputCount > 0u || mSlices[outputCount].length > 0u) {
+              forward(mSlices, outputCount + (mSlices[outputCount].length > 0u ? 1u : 0u));
+              outputCount = 0u;
+              mSlices[outputCount].buffer = mOutputs[outputCount];
+              mSlices[outputCount].length = 0u;
+            }
+            else { // nothing to do
+            }
+            dump();
+          }
+          else {
+            mRecording = mRecorded.contains(mParser.getTopic());
+          }
+        }
+        else { // nothing to do
+        }
+        if(length == 0u) { // only a tag
+        }
+        else if(mRecording) {
+          record(part, length);
+          mMessageLength = messageEnd ? 0u : mMessageLength;
+        }
+        else {
+          LogMessageParser::forEachPiece(part, length, [this, outputCount](char const * const aPiece, LogSizeType const aPieceLength) {
+            std::memcpy(mOutputs[outputCount] + mSlices[outputCount].length, aPiece, aPieceLength);
+            mSlices[outputCount].length += aPieceLength;
+          });
+        }
+      }
+      if(mSlices[outputCount].length > 0u) {
+        ++outputCount;
+      }
+      else { // nothing to do
+      }
+    }
+    passOn(mSlices, outputCount, aProgressFlag);
+  }
+  else { // nothing to do
+  }
+}
+
+void nowtech::LogFlightRecorderSink::poll() noexcept {
+  LogDecoratorSink::poll();
+  // Our buffers must not be written while the next sink may still use them.
+  if(!isNextBusy() && mTriggered.exchange(false)) {
+    dump();
+  }
+  else { // nothing to do
+  }
+}
+
+void nowtech::LogFlightRecorderSink::record(char const * const aData, LogSizeType const aLength) noexcept {
+  if(mDropping) { // nothing to do
+  }
+  else if(mMessageLength + aLength > mCapacity) {
+    mRingLength -= mMessageLength;
+    mMessageLength = 0u;
+    mDropping = true;
+    mDroppedMessages.fetch_add(1u);
+  }
+  else {
+    while(mCapacity - mRingLength < aLength) {
+      evict();
+    }
+    LogSizeType const where = (mRingStart + mRingLength) % mCapacity;
+    LogSizeType const first = mCapacity - where < aLength ? mCapacity - where : aLength;
+    std::memcpy(mRing + where, aData, first);
+    std::memcpy(mRing, aData + first, aLength - first);
+    mRingLength += aLength;
+    mMessageLength += aLength;
+  }
+}
+
+void nowtech::LogFlightRecorderSink::evict() noexcept {
+  // There is at least one complete message, as the current one fits in the
+  // ring, and complete messages end with a line end.
+  LogSizeType const complete = mRingLength - mMessageLength;
+  LogSizeType const first = mCapacity - mRingStart < complete ? mCapacity - mRingStart : complete;
+  bool tagged = false;
+  char const *found = LogMessageParser::findMessageEnd(mRing + mRingStart, mRing + mRingStart + first, tagged);
+  LogSizeType evicted;
+  if(found != nullptr) {
+    evicted = static_cast<LogSizeType>(found - (mRing + mRingStart)) + 1u;
+  }
+  else {
+    found = LogMessageParser::findMessageEnd(mRing, mRing + complete - first, tagged);
+    evicted = first + static_cast<LogSizeType>(found - mRing) + 1u;
+  }
+  mRingStart = (mRingStart + evicted) % mCapacity;
+  mRingLength -= evicted;
+}
+
+void nowtech::LogFlightRecorderSink::dump() noexcept {
+  LogSizeType const complete = mRingLength - mMessageLength;
+  if(complete > 0u) {
+    LogSizeType const first = mCapacity - mRingStart < complete ? mCapacity - mRingStart : complete;
+    LogSizeType count = 0u;
+    auto const add = [this, &count](char const * const aPiece, LogSizeType const aLength) {
+      mDumpSlices[count].buffer = aPiece;
+      mDumpSlices[count].length = aLength;
+      ++count;
+      if(count == mGatherLimit) {
+        forward(mDumpSlices, count);
+        count = 0u;
+      }
+      else { // nothing to do
+      }
+    };
+    add(cDumpStart, sizeof(cDumpStart) - 1u);
+    LogMessageParser::forEachPiece(mRing + mRingStart, first, add);
+    LogMessageParser::forEachPiece(mRing, complete - first, add);
+    add(cDumpEnd, sizeof(cDumpEnd) - 1u);
+    if(count > 0u) {
+      forward(mDumpSlices, count);
+    }
+    else { // nothing to do
+    }
+    mRingStart = (mRingStart + complete) % mCapacity;
+    mRingLength = mMessageLength;
+    mDumpCount.fetch_add(1u);
+  }
+  else { // nothing to do
+  }
+}
+
+void nowtech::LogFlightRecorderSink::dumpAfterCrash(LogCrashWrite const aWrite) const noexcept {
+  LogSizeType const complete = mRingLength - mMessageLength;
+  if(complete > 0u) {
+    LogSizeType const first = mCapacity - mRingStart < complete ? mCapacity - mRingStart : complete;
+    aWrite(cDumpStart, sizeof(cDumpStart) - 1u);
+    LogMessageParser::forEachPiece(mRing + mRingStart, first, aWrite);
+    LogMessageParser::forEachPiece(mRing, complete - first, aWrite);
+    aWrite(cDumpEnd, sizeof(cDumpEnd) - 1u);
+  }
+  else { // nothing to do
+  }
+}
@@ -0,0 +1,123 @@
+/*
+ * Copyright 2018 Now Technologies Zrt.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+ * THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef NOWTECH_LOG_FLIGHT_RECORDER_SINK_INCLUDED
+#define NOWTECH_LOG_FLIGHT_RECORDER_SINK_INCLUDED
+
+#include "LogSink.h"
+
+namespace nowtech {
+
+  /// Decorator keeping the messages of the recorded topics in a memory ring
+  /// of the last aCapacity bytes instead of passing them to the next sink.
+  /// The ring is written out, between cDumpStart and cDumpEnd lines, right
+  /// before a message of a trigger topic, or after trigger() was called.
+  /// Other messages pass through. This way debug topics cost only their
+  /// formatting, and their history is still there when something fails.
+  /// The topics are known from the tags of LogConfig::emitTopicTags, which
+  /// are removed. Without them all messages count as having no topic. The
+  /// ring keeps the Log::cLineBreakTag bytes to find the message ends, they
+  /// are removed when it is written out.
+  class LogFlightRecorderSink final : public LogDecoratorSink {
+  public:
+    static constexpr char cDumpStart[] = "-=- flight recorder start -=-\n";
+    static constexpr char cDumpEnd[]   = "-=- flight recorder end -=-\n";
+
+  private:
+    LogTopicMask const mRecorded;
+    LogTopicMask const mTriggers;
+    LogSizeType const  mCapacity;
+    char * const       mRing;
+    LogSizeType        mRingStart = 0u;
+    LogSizeType        mRingLength = 0u;
+
+    /// Bytes of the message being recorded, already in the ring.
+    LogSizeType        mMessageLength = 0u;
+
+    /// True if the current message goes into the ring.
+    bool               mRecording = false;
+
+    /// True if the current message did not fit in the ring.
+    bool               mDropping = false;
+
+    LogMessageParser   mParser;
+    LogBufferSlice     mDumpSlices[cMaxGather];
+    std::atomic<bool>  mTriggered;
+    std::atomic<uint32_t> mDumpCount;
+    std::atomic<uint32_t> mDroppedMessages;
+
+  public:
+    /// @param aNext the sink receiving the output, not owned.
+    /// @param aRecorded the topics kept in the ring.
+    /// @param aTriggers the topics causing a dump. These are never recorded.
+    /// @param aCapacity length of the ring in bytes.
+    LogFlightRecorderSink(LogSink &aNext, LogTopicMask const &aRecorded, LogTopicMask const &aTriggers, LogSizeType const aCapacity) noexcept;
+
+    virtual ~LogFlightRecorderSink() noexcept;
+
+    /// Requests a dump, done by the transmitter thread in its next write or
+    /// poll. Can be called from any thread, and from signal handlers which
+    /// return. After a crash the transmitter does not run again, so
+    /// LogCrashHandler calls dumpAfterCrash() instead.
+    void trigger() noexcept {
+      mTriggered.store(true);
+    }
+
+    /// Writes the complete messages of the ring with aWrite, between the
+    /// cDumpStart and cDumpEnd lines, once the transmitter thread does not
+    /// run any more. Async-signal-safe if aWrite is.
+    void dumpAfterCrash(LogCrashWrite const aWrite) const noexcept;
+
+    /// @return the number of dumps done.
+    uint32_t getDumpCount() const noexcept {
+      return mDumpCount.load();
+    }
+
+    /// @return the number of messages longer than the whole ring, which were
+    /// not recorded.
+    uint32_t getDroppedMessages() const noexcept {
+      return mDroppedMessages.load();
+    }
+
+    /// The next sink clears the progress flag, or this one if nothing passed.
+    virtual void write(LogBufferSlice const * const aSlices, LogSizeType const aCount, std::atomic<bool> *aProgressFlag) noexcept override;
+
+    /// Dumps if trigger() was called.
+    virtual void poll() noexcept override;
+
+  private:
+    /// Appends a part of the current message to the ring, evicting the oldest
+    /// messages if needed.
+    void record(char const * const aData, LogSizeType const aLength) noexcept;
+
+    /// Removes the oldest complete message from the ring.
+    void evict() noexcept;
+
+    /// Writes the complete messages of the ring to the next sink, and waits
+    /// for it.
+    void dump() noexcept;
+  };
+
+} //namespace nowtech
+
+#endif // NOWTECH_LOG_FLIGHT_RECORDER_SINK_INCLUDED
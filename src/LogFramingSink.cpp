@@ -0,0 +1,123 @@
+//
+// Copyright 2018 Now Technologies Zrt.
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge,
+// publish, distribute, sublicense, and/or sell copies of the Software,
+// and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#include "LogFramingSink.h"
+#include <cerrno>
+
+constexpr char nowtech::LogFramingSink::cEnd;
+constexpr char nowtech::LogFramingSink::cEscape;
+constexpr char nowtech::LogFramingSink::cEscapedEnd;
+constexpr char nowtech::LogFramingSink::cEscapedEscape;
+
+void nowtech::LogFramingSink::write(LogBufferSlice const * const aSlices, LogSizeType const aCount, std::atomic<bool> *aProgressFlag) noexcept {
+  if(checkOutputs(aProgressFlag)) {
+    for(LogSizeType i = 0u; i < aCount; ++i) {
+      mWhere = mOutputs[i];
+      mLimit = mOutputs[i] + mOutputLength;
+      mOverflow = false;
+      char const * const end = aSlices[i].buffer + aSlices[i].length;
+      if(mMode == Mode::cBuffer) {
+        openFrame();
+        for(char const *pointer = aSlices[i].buffer; pointer < end; ++pointer) {
+          putTracked(*pointer);
+        }
+        closeFrame();
+      }
+      else {
+        for(char const *pointer = aSlices[i].buffer; pointer < end; ++pointer) {
+          if(!mInFrame) {
+            openFrame();
+          }
+          else { // nothing to do
+          }
+          if(*pointer == Chunk::cEndOfLine && !mLineBreakTagged) {
+            closeFrame();
+          }
+          else if(*pointer != Log::cLineBreakTag || mLineBreakTagged) {
+            putTracked(*pointer);
+          }
+          else { // the tag itself is not framed
+          }
+          mLineBreakTagged = *pointer == Log::cLineBreakTag && !mLineBreakTagged;
+        }
+      }
+      if(mOverflow) {
+        // Only a flood of tiny messages can get here. The receiver drops
+        // the cut frame due to its CRC.
+        reportError(ENOBUFS);
+      }
+      else { // nothing to do
+      }
+      mSlices[i].buffer = mOutputs[i];
+      mSlices[i].length = static_cast<LogSizeType>(mWhere - mOutputs[i]);
+    }
+    passOn(mSlices, aCount, aProgressFlag);
+  }
+  else { // nothing to do
+  }
+}
+
+void nowtech::LogFramingSink::put(char const aByte) noexcept {
+  if(mWhere < mLimit) {
+    *mWhere = aByte;
+    ++mWhere;
+  }
+  else {
+    mOverflow = true;
+  }
+}
+
+void nowtech::LogFramingSink::putEscaped(char const aByte) noexcept {
+  if(aByte == cEnd) {
+    put(cEscape);
+    put(cEscapedEnd);
+  }
+  else if(aByte == cEscape) {
+    put(cEscape);
+    put(cEscapedEscape);
+  }
+  else {
+    put(aByte);
+  }
+}
+
+void nowtech::LogFramingSink::putTracked(char const aByte) noexcept {
+  mCrc = updateCrc(mCrc, aByte);
+  putEscaped(aByte);
+}
+
+void nowtech::LogFramingSink::openFrame() noexcept {
+  put(cEnd);
+  mCrc = cCrcInitial;
+  mInFrame = true;
+  putTracked(static_cast<char>(mSequence));
+}
+
+void nowtech::LogFramingSink::closeFrame() noexcept {
+  uint16_t const crc = mCrc;
+  putEscaped(static_cast<char>(crc));
+  putEscaped(static_cast<char>(crc >> 8u));
+  put(cEnd);
+  ++mSequence;
+  mInFrame = false;
+}
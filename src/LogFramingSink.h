@@ -0,0 +1,114 @@
+/*
+ * Copyright 2018 Now Technologies Zrt.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+ * THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef NOWTECH_LOG_FRAMING_SINK_INCLUDED
+#define NOWTECH_LOG_FRAMING_SINK_INCLUDED
+
+#include "LogSink.h"
+
+namespace nowtech {
+
+  /// Sink wrapping the stream into SLIP (RFC 1055) frames and passing them
+  /// to the next sink. Each frame starts and ends with cEnd, and contains a
+  /// sequence byte, the payload and a CRC-16/CCITT of these two, little
+  /// endian. A receiver losing bytes resynchronizes at the next cEnd, detects
+  /// the damaged frame by its CRC and the lost ones by the sequence numbers.
+  /// tools/logdeframe.cpp decodes the stream.
+  /// SLIP was chosen over COBS because it encodes byte by byte, so a message
+  /// spanning two transmission buffers needs no lookahead.
+  class LogFramingSink final : public LogDecoratorSink {
+  public:
+    /// What a frame contains.
+    enum class Mode : uint8_t {
+      /// One message without its line end. For text or binary format logs.
+      /// The line ends inside a message stay in it if
+      /// LogConfig::tagLineBreaks is set, the tags are removed.
+      cMessage,
+      /// One whole transmission buffer, like a compressed block of
+      /// LogCompressingSink placed before this sink.
+      cBuffer
+    };
+
+    static constexpr char cEnd        = '\xc0';
+    static constexpr char cEscape     = '\xdb';
+    static constexpr char cEscapedEnd = '\xdc';
+    static constexpr char cEscapedEscape = '\xdd';
+
+    /// Bytes a frame adds at most: 2 cEnd, the escaped sequence number and CRC.
+    static constexpr LogSizeType cMaxFrameOverhead = 8u;
+
+    static constexpr uint16_t cCrcInitial = 0xffffu;
+
+    /// Updates the CRC-16/CCITT (polynomial 0x1021) with a byte.
+    static uint16_t updateCrc(uint16_t const aCrc, char const aByte) noexcept {
+      uint16_t crc = aCrc ^ static_cast<uint16_t>(static_cast<uint8_t>(aByte) << 8u);
+      for(uint8_t i = 0u; i < 8u; ++i) {
+        crc = (crc & 0x8000u) != 0u ? static_cast<uint16_t>((crc << 1u) ^ 0x1021u) : static_cast<uint16_t>(crc << 1u);
+      }
+      return crc;
+    }
+
+  private:
+    Mode const       mMode;
+    uint8_t          mSequence = 0u;
+    uint16_t         mCrc = cCrcInitial;
+
+    /// True in cMessage mode if a message continues in the next buffer.
+    bool             mInFrame = false;
+
+    /// True if the last byte was Log::cLineBreakTag.
+    bool             mLineBreakTagged = false;
+
+    /// Output position while framing a buffer.
+    char            *mWhere = nullptr;
+    char            *mLimit = nullptr;
+    bool             mOverflow = false;
+
+  public:
+    /// @param aNext the sink receiving the frames, not owned.
+    LogFramingSink(LogSink &aNext, Mode const aMode) noexcept
+      : LogDecoratorSink(aNext)
+      , mMode(aMode) {
+    }
+
+    /// The next sink clears the progress flag.
+    virtual void write(LogBufferSlice const * const aSlices, LogSizeType const aCount, std::atomic<bool> *aProgressFlag) noexcept override;
+
+  protected:
+    /// A message of at least 5 bytes with its line end fits in 3 times its
+    /// length even if all its bytes are escaped.
+    virtual LogSizeType getOutputLength(LogSizeType const aInputLength) const noexcept override {
+      return (mMode == Mode::cBuffer ? 2u : 3u) * aInputLength + cMaxFrameOverhead;
+    }
+
+  private:
+    void put(char const aByte) noexcept;
+    void putEscaped(char const aByte) noexcept;
+    void putTracked(char const aByte) noexcept;
+    void openFrame() noexcept;
+    void closeFrame() noexcept;
+  };
+
+} //namespace nowtech
+
+#endif // NOWTECH_LOG_FRAMING_SINK_INCLUDED
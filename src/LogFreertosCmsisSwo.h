@@ -134,7 +134,9 @@ namespace nowtech {
       vTaskDelete(mTaskHandle);
     }
 
-    /// Enqueues the chunks, possibly blocking if the queue is full.
+    /// Enqueues the chunks, possibly blocking if the queue is full, at most
+    /// for LogConfig::blockTimeout if given.
+    /// Returns false if the chunk could not be enqueued.
     /// In ISR, we do not use pxHigherPriorityTaskWoken because
     /// if it ever causes a problem, the first thing to do will
     /// be to remove logging from ISR.
@@ -144,18 +146,26 @@ namespace nowtech {
     /// the end of the ISR. Depending on your use-case this may
     /// be acceptable or not."
     /// https://stackoverflow.com/questions/28985010/about-pxhigherprioritytaskwoken
-    virtual void push(char const * const aChunkStart, bool const aBlocks) noexcept override {
+    virtual bool push(char const * const aChunkStart, bool const aBlocks) noexcept override {
+      BaseType_t result;
       if(stm32utils::isInterrupt()) {
         BaseType_t higherPriorityTaskWoken;
-        xQueueSendFromISR(mQueue, aChunkStart, &higherPriorityTaskWoken);
+        result = xQueueSendFromISR(mQueue, aChunkStart, &higherPriorityTaskWoken);
         if(higherPriorityTaskWoken == pdTRUE) {
           //TODO consider if needed. In theory not necessary
           portYIELD_FROM_ISR(pdTRUE);
         }
       }
       else {
-        xQueueSend(mQueue, aChunkStart, aBlocks ? portMAX_DELAY : 0);
+        TickType_t wait = 0;
+        if(aBlocks) {
+          wait = mBlockTimeout == 0u ? portMAX_DELAY : pdMS_TO_TICKS(mBlockTimeout);
+        }
+        else { // nothing to do
+        }
+        result = xQueueSend(mQueue, aChunkStart, wait);
       }
+      return result == pdTRUE;
     }
 
     /// Removes the oldest chunk from the queue.
@@ -169,6 +179,14 @@ namespace nowtech {
       vTaskDelay(pdMS_TO_TICKS(mPauseLength));
     }
 
+    virtual bool hasTransmitterThread() const noexcept override {
+      return true;
+    }
+
+    virtual void sleep(uint32_t const aMs) noexcept override {
+      vTaskDelay(pdMS_TO_TICKS(aMs));
+    }
+
     /// Transmits the data using the serial descriptor given in the constructor.
     /// @param buffer start of data
     /// @param length length of data
@@ -180,6 +198,18 @@ namespace nowtech {
       aProgressFlag->store(false);
     }
 
+    /// SWO output is synchronous, so any number of buffers can be sent at once.
+    virtual LogSizeType getGatherLimit() const noexcept override {
+      return std::numeric_limits<LogSizeType>::max();
+    }
+
+    /// Sends the buffers one after the other.
+    virtual void transmitGathered(LogBufferSlice const * const aSlices, LogSizeType const aCount, std::atomic<bool> *aProgressFlag) noexcept override {
+      for(LogSizeType i = 0u; i < aCount; ++i) {
+        transmit(aSlices[i].buffer, aSlices[i].length, aProgressFlag);
+      }
+    }
+
     /// Starts the timer after which a partially filled buffer should be sent.
     virtual void startRefreshTimer(std::atomic<bool> *aRefreshFlag) noexcept override {
       sRefreshNeeded = aRefreshFlag;
@@ -143,7 +143,9 @@ namespace nowtech {
       vTaskDelete(mTaskHandle);
     }
 
-    /// Enqueues the chunks, possibly blocking if the queue is full.
+    /// Enqueues the chunks, possibly blocking if the queue is full, at most
+    /// for LogConfig::blockTimeout if given.
+    /// Returns false if the chunk could not be enqueued.
     /// In ISR, we do not use pxHigherPriorityTaskWoken because
     /// if it ever causes a problem, the first thing to do will
     /// be to remove logging from ISR.
@@ -153,18 +155,26 @@ namespace nowtech {
     /// the end of the ISR. Depending on your use-case this may
     /// be acceptable or not."
     /// https://stackoverflow.com/questions/28985010/about-pxhigherprioritytaskwoken
-    virtual void push(char const * const aChunkStart, bool const aBlocks) noexcept override {
+    virtual bool push(char const * const aChunkStart, bool const aBlocks) noexcept override {
+      BaseType_t result;
       if(stm32utils::isInterrupt()) {
         BaseType_t higherPriorityTaskWoken;
-        xQueueSendFromISR(mQueue, aChunkStart, &higherPriorityTaskWoken);
+        result = xQueueSendFromISR(mQueue, aChunkStart, &higherPriorityTaskWoken);
         if(higherPriorityTaskWoken == pdTRUE) {
           //TODO consider if needed. In theory not necessary
           portYIELD_FROM_ISR(pdTRUE);
         }
       }
       else {
-        xQueueSend(mQueue, aChunkStart, aBlocks ? portMAX_DELAY : 0);
+        TickType_t wait = 0;
+        if(aBlocks) {
+          wait = mBlockTimeout == 0u ? portMAX_DELAY : nowtech::OsUtil::msToRtosTick(mBlockTimeout);
+        }
+        else { // nothing to do
+        }
+        result = xQueueSend(mQueue, aChunkStart, wait);
       }
+      return result == pdTRUE;
     }
 
     /// Removes the oldest chunk from the queue.
@@ -178,6 +188,14 @@ namespace nowtech {
       nowtech::OsUtil::taskDelayMillis(mPauseLength);
     }
 
+    virtual bool hasTransmitterThread() const noexcept override {
+      return true;
+    }
+
+    virtual void sleep(uint32_t const aMs) noexcept override {
+      nowtech::OsUtil::taskDelayMillis(aMs);
+    }
+
     /// Transmits the data using the serial descriptor given in the constructor.
     /// @param buffer start of data
     /// @param length length of data
@@ -0,0 +1,189 @@
+//
+// Copyright 2018 Now Technologies Zrt.
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge,
+// publish, distribute, sublicense, and/or sell copies of the Software,
+// and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#include "LogFutexQueue.h"
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <climits>
+#include <ctime>
+#include <new>
+#include <sched.h>
+
+namespace {
+  constexpr uint64_t cNsPerMs  = 1000000u;
+  constexpr uint64_t cNsPerSec = 1000000000u;
+
+  uint64_t now() noexcept {
+    timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return static_cast<uint64_t>(time.tv_sec) * cNsPerSec + static_cast<uint64_t>(time.tv_nsec);
+  }
+}
+
+nowtech::LogFutexQueue::LogFutexQueue(size_t const aBlockCount, size_t const aBlockSize, LogConfig const &aConfig) noexcept
+  : mRing(aBlockCount, aBlockSize)
+  , mShared(mOwnShared)
+  , mWaitOperation(FUTEX_WAIT_PRIVATE)
+  , mWakeOperation(FUTEX_WAKE_PRIVATE)
+  , mProducerWait(aConfig.producerWait)
+  , mConsumerWait(aConfig.consumerWait)
+  , mBlockTimeout(aConfig.blockTimeout) {
+  initShared(mOwnShared);
+}
+
+nowtech::LogFutexQueue::LogFutexQueue(void * const aMemory, size_t const aBlockCount, size_t const aBlockSize, LogConfig const &aConfig) noexcept
+  : mRing(aMemory, aBlockCount, aBlockSize, true)
+  , mShared(mOwnShared)
+  , mWaitOperation(FUTEX_WAIT_PRIVATE)
+  , mWakeOperation(FUTEX_WAKE_PRIVATE)
+  , mProducerWait(aConfig.producerWait)
+  , mConsumerWait(aConfig.consumerWait)
+  , mBlockTimeout(aConfig.blockTimeout) {
+  initShared(mOwnShared);
+}
+
+nowtech::LogFutexQueue::LogFutexQueue(void * const aMemory, Shared &aShared, bool const aInitialize, size_t const aBlockCount, size_t const aBlockSize, LogConfig const &aConfig) noexcept
+  : mRing(aMemory, aBlockCount, aBlockSize, aInitialize)
+  , mShared(aShared)
+  , mWaitOperation(FUTEX_WAIT)
+  , mWakeOperation(FUTEX_WAKE)
+  , mProducerWait(aConfig.producerWait)
+  , mConsumerWait(aConfig.consumerWait)
+  , mBlockTimeout(aConfig.blockTimeout) {
+  if(aInitialize) {
+    initShared(aShared);
+  }
+  else { // nothing to do
+  }
+}
+
+bool nowtech::LogFutexQueue::send(char const * const aChunkStart, bool const aBlocks) noexcept {
+  bool success = mRing.tryPush(aChunkStart);
+  if(!success && aBlocks) {
+    for(uint32_t i = 0u; !success && i < mProducerWait.spinCount; ++i) {
+      LogMpscRing::relax();
+      success = mRing.tryPush(aChunkStart);
+    }
+    for(uint32_t i = 0u; !success && i < mProducerWait.yieldCount; ++i) {
+      sched_yield();
+      success = mRing.tryPush(aChunkStart);
+    }
+    if(!success) {
+      uint64_t const deadline = mBlockTimeout == 0u ? UINT64_MAX : now() + mBlockTimeout * cNsPerMs;
+      mShared.sleepingProducers.fetch_add(1u);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      while(!success) {
+        // Read before the retry, so a chunk freed after the failed retry
+        // changes it and the wait returns immediately.
+        uint32_t const expected = mShared.producerFutex.load();
+        success = mRing.tryPush(aChunkStart);
+        if(!success) {
+          uint64_t const current = deadline == UINT64_MAX ? 0u : now();
+          if(current >= deadline) {
+            break;
+          }
+          else {
+            wait(mShared.producerFutex, expected, deadline == UINT64_MAX ? UINT64_MAX : deadline - current);
+          }
+        }
+        else { // nothing to do
+        }
+      }
+      mShared.sleepingProducers.fetch_sub(1u);
+    }
+    else { // nothing to do
+    }
+  }
+  else { // nothing to do
+  }
+  if(success) {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if(mShared.consumerSleeping.load(std::memory_order_relaxed) != 0u) {
+      mShared.consumerFutex.fetch_add(1u);
+      wake(mShared.consumerFutex, 1);
+    }
+    else { // nothing to do
+    }
+  }
+  else { // nothing to do
+  }
+  return success;
+}
+
+bool nowtech::LogFutexQueue::receive(char * const aChunkStart, uint64_t const aTimeout) noexcept {
+  bool result = mRing.tryPop(aChunkStart);
+  for(uint32_t i = 0u; !result && i < mConsumerWait.spinCount; ++i) {
+    LogMpscRing::relax();
+    result = mRing.tryPop(aChunkStart);
+  }
+  for(uint32_t i = 0u; !result && i < mConsumerWait.yieldCount; ++i) {
+    sched_yield();
+    result = mRing.tryPop(aChunkStart);
+  }
+  if(!result) {
+    uint32_t const expected = mShared.consumerFutex.load();
+    mShared.consumerSleeping.store(1u);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    result = mRing.tryPop(aChunkStart);
+    if(!result) {
+      wait(mShared.consumerFutex, expected, aTimeout);
+      result = mRing.tryPop(aChunkStart);
+    }
+    else { // nothing to do
+    }
+    mShared.consumerSleeping.store(0u);
+  }
+  else { // nothing to do
+  }
+  if(result) {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if(mShared.sleepingProducers.load(std::memory_order_relaxed) > 0u) {
+      mShared.producerFutex.fetch_add(1u);
+      wake(mShared.producerFutex, INT_MAX);
+    }
+    else { // nothing to do
+    }
+  }
+  else { // nothing to do
+  }
+  return result;
+}
+
+void nowtech::LogFutexQueue::initShared(Shared &aShared) noexcept {
+  new(&aShared.producerFutex) std::atomic<uint32_t>(0u);
+  new(&aShared.consumerFutex) std::atomic<uint32_t>(0u);
+  new(&aShared.sleepingProducers) std::atomic<uint32_t>(0u);
+  new(&aShared.consumerSleeping) std::atomic<uint32_t>(0u);
+}
+
+void nowtech::LogFutexQueue::wait(std::atomic<uint32_t> &aFutex, uint32_t const aExpected, uint64_t const aTimeout) noexcept {
+  timespec timeout;
+  timeout.tv_sec = static_cast<time_t>(aTimeout / cNsPerSec);
+  timeout.tv_nsec = static_cast<long>(aTimeout % cNsPerSec);
+  syscall(SYS_futex, reinterpret_cast<uint32_t*>(&aFutex), mWaitOperation, aExpected, aTimeout == UINT64_MAX ? nullptr : &timeout, nullptr, 0);
+}
+
+void nowtech::LogFutexQueue::wake(std::atomic<uint32_t> &aFutex, int const aCount) noexcept {
+  syscall(SYS_futex, reinterpret_cast<uint32_t*>(&aFutex), mWakeOperation, aCount, nullptr, nullptr, 0);
+}
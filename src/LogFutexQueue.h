@@ -0,0 +1,97 @@
+/*
+ * Copyright 2018 Now Technologies Zrt.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+ * THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef NOWTECH_LOG_FUTEX_QUEUE_INCLUDED
+#define NOWTECH_LOG_FUTEX_QUEUE_INCLUDED
+
+#include "Log.h"
+#include "LogMpscRing.h"
+#include <atomic>
+#include <cstdint>
+
+namespace nowtech {
+
+  /// Linux queue of chunks built on LogMpscRing. The sides wait like in
+  /// LogStdThreadOstream, but the last stage sleeps on a futex. The sleeping
+  /// side is woken only if it announced it sleeps.
+  /// The queue is either private to the process, or the ring and the words
+  /// the sides wait on are in memory shared among processes.
+  class LogFutexQueue final : public BanCopyMove {
+  public:
+    /// The words the sides wait on and announce sleeping in.
+    struct Shared {
+      std::atomic<uint32_t> producerFutex;
+      std::atomic<uint32_t> consumerFutex;
+      std::atomic<uint32_t> sleepingProducers;
+      std::atomic<uint32_t> consumerSleeping;
+    };
+
+  private:
+    LogMpscRing           mRing;
+    Shared                mOwnShared;
+    Shared               &mShared;
+    int const             mWaitOperation;
+    int const             mWakeOperation;
+    LogWaitStrategy const mProducerWait;
+    LogWaitStrategy const mConsumerWait;
+    uint32_t const        mBlockTimeout;
+
+  public:
+    /// Creates a queue private to the process.
+    LogFutexQueue(size_t const aBlockCount, size_t const aBlockSize, LogConfig const &aConfig) noexcept;
+
+    /// Creates a queue private to the process in the given memory.
+    /// @param aMemory memory for the ring, see LogMpscRing::getMemorySize().
+    LogFutexQueue(void * const aMemory, size_t const aBlockCount, size_t const aBlockSize, LogConfig const &aConfig) noexcept;
+
+    /// Creates a queue in memory shared among processes.
+    /// @param aMemory memory for the ring, see LogMpscRing::getMemorySize().
+    /// @param aShared the words to wait on, in the shared memory.
+    /// @param aInitialize true if this is the first user of the memory.
+    LogFutexQueue(void * const aMemory, Shared &aShared, bool const aInitialize, size_t const aBlockCount, size_t const aBlockSize, LogConfig const &aConfig) noexcept;
+
+    /// Enqueues the chunk, possibly blocking if the queue is full, at most
+    /// for LogConfig::blockTimeout if given.
+    bool send(char const * const aChunkStart, bool const aBlocks) noexcept;
+
+    /// Waits at most aTimeout ns for a chunk.
+    bool receive(char * const aChunkStart, uint64_t const aTimeout) noexcept;
+
+    /// Takes a chunk if there is one, without waking the producers.
+    bool tryPop(char * const aChunkStart) noexcept {
+      return mRing.tryPop(aChunkStart);
+    }
+
+  private:
+    static void initShared(Shared &aShared) noexcept;
+
+    /// Sleeps while the futex word equals the expected value, at most aTimeout ns.
+    /// UINT64_MAX means no timeout.
+    void wait(std::atomic<uint32_t> &aFutex, uint32_t const aExpected, uint64_t const aTimeout) noexcept;
+
+    void wake(std::atomic<uint32_t> &aFutex, int const aCount) noexcept;
+  };
+
+} //namespace nowtech
+
+#endif // NOWTECH_LOG_FUTEX_QUEUE_INCLUDED
@@ -0,0 +1,195 @@
+//
+// Copyright 2018 Now Technologies Zrt.
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge,
+// publish, distribute, sublicense, and/or sell copies of the Software,
+// and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#include "LogLz.h"
+#include <cstring>
+
+constexpr size_t  nowtech::LogLz::cBlockHeaderLength;
+constexpr uint8_t nowtech::LogLz::cTypeCompressed;
+constexpr uint8_t nowtech::LogLz::cTypeStored;
+constexpr uint32_t nowtech::LogLz::cHashTableLength;
+
+size_t nowtech::LogLz::compress(char const * const aInput, size_t const aLength, char * const aOutput, uint32_t * const aHashTable) noexcept {
+  uint8_t const * const input = reinterpret_cast<uint8_t const*>(aInput);
+  uint8_t * const start = reinterpret_cast<uint8_t*>(aOutput) + cBlockHeaderLength;
+  uint8_t *output = start;
+  std::memset(aHashTable, 0xff, cHashTableLength * sizeof(uint32_t));
+  size_t anchor = 0u;
+  size_t position = 0u;
+  while(aLength >= cMinMatch && position <= aLength - cMinMatch) {
+    uint32_t const sequence = read32(input + position);
+    uint32_t const hash = (sequence * 2654435761u) >> (32u - cHashBits);
+    uint32_t const candidate = aHashTable[hash];
+    aHashTable[hash] = static_cast<uint32_t>(position);
+    if(candidate != UINT32_MAX && position - candidate <= cMaxOffset && read32(input + candidate) == sequence) {
+      size_t matchLength = cMinMatch;
+      while(position + matchLength < aLength && input[candidate + matchLength] == input[position + matchLength]) {
+        ++matchLength;
+      }
+      size_t const literalLength = position - anchor;
+      size_t const matchCode = matchLength - cMinMatch;
+      uint8_t * const token = output;
+      ++output;
+      *token = static_cast<uint8_t>(((literalLength < cNibbleMax ? literalLength : cNibbleMax) << 4u) | (matchCode < cNibbleMax ? matchCode : cNibbleMax));
+      if(literalLength >= cNibbleMax) {
+        output = writeLength(output, literalLength - cNibbleMax);
+      }
+      else { // nothing to do
+      }
+      std::memcpy(output, input + anchor, literalLength);
+      output += literalLength;
+      size_t const offset = position - candidate;
+      output[0] = static_cast<uint8_t>(offset);
+      output[1] = static_cast<uint8_t>(offset >> 8u);
+      output += 2u;
+      if(matchCode >= cNibbleMax) {
+        output = writeLength(output, matchCode - cNibbleMax);
+      }
+      else { // nothing to do
+      }
+      position += matchLength;
+      anchor = position;
+    }
+    else {
+      ++position;
+    }
+  }
+  size_t const literalLength = aLength - anchor;
+  *output = static_cast<uint8_t>((literalLength < cNibbleMax ? literalLength : cNibbleMax) << 4u);
+  ++output;
+  if(literalLength >= cNibbleMax) {
+    output = writeLength(output, literalLength - cNibbleMax);
+  }
+  else { // nothing to do
+  }
+  std::memcpy(output, input + anchor, literalLength);
+  output += literalLength;
+  size_t payloadLength = static_cast<size_t>(output - start);
+  uint8_t type = cTypeCompressed;
+  if(payloadLength >= aLength) {
+    std::memcpy(start, aInput, aLength);
+    payloadLength = aLength;
+    type = cTypeStored;
+  }
+  else { // nothing to do
+  }
+  uint8_t * const header = reinterpret_cast<uint8_t*>(aOutput);
+  header[0] = 'N';
+  header[1] = 'Z';
+  header[2] = type;
+  header[3] = 0u;
+  write32(header + 4u, static_cast<uint32_t>(aLength));
+  write32(header + 8u, static_cast<uint32_t>(payloadLength));
+  return cBlockHeaderLength + payloadLength;
+}
+
+size_t nowtech::LogLz::decompress(char const * const aInput, size_t const aLength, char * const aOutput, size_t const aCapacity) noexcept {
+  uint8_t const *input = reinterpret_cast<uint8_t const*>(aInput);
+  uint8_t const * const end = input + aLength;
+  uint8_t * const start = reinterpret_cast<uint8_t*>(aOutput);
+  uint8_t *output = start;
+  uint8_t * const limit = start + aCapacity;
+  size_t result = SIZE_MAX;
+  while(input < end) {
+    uint8_t const token = *input;
+    ++input;
+    size_t literalLength = token >> 4u;
+    if(literalLength == cNibbleMax) {
+      uint8_t byte;
+      do {
+        byte = input < end ? *input : 0u;
+        ++input;
+        literalLength += byte;
+      } while(byte == 255u);
+    }
+    else { // nothing to do
+    }
+    if(input > end || literalLength > static_cast<size_t>(end - input) || literalLength > static_cast<size_t>(limit - output)) {
+      break;
+    }
+    else { // nothing to do
+    }
+    std::memcpy(output, input, literalLength);
+    output += literalLength;
+    input += literalLength;
+    if(input == end) {
+      result = static_cast<size_t>(output - start);
+      break;
+    }
+    else { // nothing to do
+    }
+    if(end - input < 2) {
+      break;
+    }
+    else { // nothing to do
+    }
+    size_t const offset = static_cast<size_t>(input[0]) | (static_cast<size_t>(input[1]) << 8u);
+    input += 2u;
+    size_t matchLength = token & cNibbleMax;
+    if(matchLength == cNibbleMax) {
+      uint8_t byte;
+      do {
+        byte = input < end ? *input : 0u;
+        ++input;
+        matchLength += byte;
+      } while(byte == 255u);
+    }
+    else { // nothing to do
+    }
+    matchLength += cMinMatch;
+    if(input > end || offset == 0u || offset > static_cast<size_t>(output - start) || matchLength > static_cast<size_t>(limit - output)) {
+      break;
+    }
+    else { // nothing to do
+    }
+    uint8_t const *match = output - offset;
+    for(size_t i = 0u; i < matchLength; ++i) {
+      output[i] = match[i];
+    }
+    output += matchLength;
+  }
+  return result;
+}
+
+uint32_t nowtech::LogLz::read32(uint8_t const * const aWhere) noexcept {
+  uint32_t result;
+  std::memcpy(&result, aWhere, sizeof(result));
+  return result;
+}
+
+void nowtech::LogLz::write32(uint8_t * const aWhere, uint32_t const aValue) noexcept {
+  aWhere[0] = static_cast<uint8_t>(aValue);
+  aWhere[1] = static_cast<uint8_t>(aValue >> 8u);
+  aWhere[2] = static_cast<uint8_t>(aValue >> 16u);
+  aWhere[3] = static_cast<uint8_t>(aValue >> 24u);
+}
+
+uint8_t *nowtech::LogLz::writeLength(uint8_t *aWhere, size_t aLength) noexcept {
+  while(aLength >= 255u) {
+    *aWhere = 255u;
+    ++aWhere;
+    aLength -= 255u;
+  }
+  *aWhere = static_cast<uint8_t>(aLength);
+  return aWhere + 1u;
+}
@@ -0,0 +1,83 @@
+/*
+ * Copyright 2018 Now Technologies Zrt.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+ * THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef NOWTECH_LOG_LZ_INCLUDED
+#define NOWTECH_LOG_LZ_INCLUDED
+
+#include <cstdint>
+#include <cstddef>
+
+namespace nowtech {
+
+  /// Small, fast LZ77 compressor in the spirit of LZ4, for independent blocks.
+  /// A block consists of sequences. Each starts with a token byte, whose high
+  /// nibble is the literal length and the low one is the match length - 4.
+  /// A nibble of 15 means the length continues in the following bytes, each
+  /// added to it, until a byte less than 255. The literals come next, then
+  /// the 2-byte little endian offset of the match and the match length
+  /// continuation, if any. The last sequence has only literals and ends the
+  /// block.
+  ///
+  /// Blocks are framed in a stream like this, all little endian:
+  /// 'N' 'Z' type(0 = compressed, 1 = stored) 0 rawLength(4) payloadLength(4) payload
+  class LogLz final {
+  public:
+    static constexpr size_t  cBlockHeaderLength = 12u;
+    static constexpr uint8_t cTypeCompressed    = 0u;
+    static constexpr uint8_t cTypeStored        = 1u;
+
+  private:
+    static constexpr uint32_t cMinMatch      = 4u;
+    static constexpr uint32_t cMaxOffset     = 65535u;
+    static constexpr uint32_t cHashBits      = 12u;
+    static constexpr uint32_t cNibbleMax     = 15u;
+
+  public:
+    /// Number of entries of the hash table the caller provides to compress.
+    static constexpr uint32_t cHashTableLength = 1u << cHashBits;
+
+    /// @return the maximum length of a framed block for aLength input bytes.
+    static constexpr size_t getBound(size_t const aLength) noexcept {
+      return cBlockHeaderLength + aLength + aLength / 255u + 16u;
+    }
+
+    /// Compresses the input into a framed block. Stores it if compression
+    /// would not help.
+    /// @param aHashTable cHashTableLength entries of scratch space.
+    /// @return the length of the framed block, at most getBound(aLength).
+    static size_t compress(char const * const aInput, size_t const aLength, char * const aOutput, uint32_t * const aHashTable) noexcept;
+
+    /// Decompresses a block payload, without the frame header.
+    /// @return the number of bytes produced, or SIZE_MAX if the payload is
+    /// corrupt or does not fit in aCapacity.
+    static size_t decompress(char const * const aInput, size_t const aLength, char * const aOutput, size_t const aCapacity) noexcept;
+
+  private:
+    static uint32_t read32(uint8_t const * const aWhere) noexcept;
+    static void write32(uint8_t * const aWhere, uint32_t const aValue) noexcept;
+    static uint8_t *writeLength(uint8_t *aWhere, size_t aLength) noexcept;
+  };
+
+} //namespace nowtech
+
+#endif // NOWTECH_LOG_LZ_INCLUDED
@@ -0,0 +1,116 @@
+//
+// Copyright 2018 Now Technologies Zrt.
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge,
+// publish, distribute, sublicense, and/or sell copies of the Software,
+// and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#include "LogMmapSink.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+
+constexpr char nowtech::LogMmapHeader::cMagic[8];
+constexpr uint32_t nowtech::LogMmapHeader::cVersion;
+
+nowtech::LogMmapSink::LogMmapSink(char const * const aPath, uint64_t const aCapacity) noexcept
+  : mHeader(nullptr)
+  , mData(nullptr)
+  , mCapacity(aCapacity)
+  , mMappedLength(sizeof(LogMmapHeader) + aCapacity) {
+  int const fd = aCapacity > 0u ? open(aPath, O_RDWR | O_CREAT | O_CLOEXEC, 0644) : -1;
+  if(aCapacity == 0u) {
+    reportError(EINVAL);
+  }
+  else if(fd >= 0) {
+    struct stat status;
+    bool const existing = fstat(fd, &status) == 0 && static_cast<uint64_t>(status.st_size) == mMappedLength;
+    if(existing || ftruncate(fd, static_cast<off_t>(mMappedLength)) == 0) {
+      void * const memory = mmap(nullptr, mMappedLength, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+      if(memory != MAP_FAILED) {
+        mHeader = static_cast<LogMmapHeader*>(memory);
+        mData = static_cast<char*>(memory) + sizeof(LogMmapHeader);
+        if(!existing || std::memcmp(mHeader->magic, LogMmapHeader::cMagic, sizeof(LogMmapHeader::cMagic)) != 0
+          || mHeader->version != LogMmapHeader::cVersion || mHeader->capacity != aCapacity) {
+          std::memset(mHeader, 0, sizeof(LogMmapHeader));
+          std::memcpy(mHeader->magic, LogMmapHeader::cMagic, sizeof(LogMmapHeader::cMagic));
+          mHeader->version = LogMmapHeader::cVersion;
+          mHeader->headerSize = sizeof(LogMmapHeader);
+          mHeader->capacity = aCapacity;
+        }
+        else { // continue the previous contents
+        }
+      }
+      else {
+        reportError(static_cast<uint32_t>(errno));
+      }
+    }
+    else {
+      reportError(static_cast<uint32_t>(errno));
+    }
+    close(fd);
+  }
+  else {
+    reportError(static_cast<uint32_t>(errno));
+  }
+}
+
+nowtech::LogMmapSink::~LogMmapSink() noexcept {
+  if(mHeader != nullptr) {
+    munmap(mHeader, mMappedLength);
+  }
+  else { // nothing to do
+  }
+}
+
+void nowtech::LogMmapSink::write(LogBufferSlice const * const aSlices, LogSizeType const aCount, std::atomic<bool> *aProgressFlag) noexcept {
+  if(mHeader != nullptr) {
+    uint64_t position = mHeader->writePosition;
+    uint64_t end = position;
+    for(LogSizeType i = 0u; i < aCount; ++i) {
+      end += aSlices[i].length;
+    }
+    // The region about to be overwritten is excluded from the valid data
+    // before the copy, so a crash in the middle leaves no mixed lines there.
+    uint64_t const sequence = mHeader->sequence | 1u;
+    __atomic_store_n(&mHeader->writeEnd, end > mHeader->writeEnd ? end : mHeader->writeEnd, __ATOMIC_RELAXED);
+    __atomic_store_n(&mHeader->sequence, sequence, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    for(LogSizeType i = 0u; i < aCount; ++i) {
+      char const *source = aSlices[i].buffer;
+      uint64_t remaining = aSlices[i].length;
+      while(remaining > 0u) {
+        uint64_t const offset = position % mCapacity;
+        uint64_t const length = remaining < mCapacity - offset ? remaining : mCapacity - offset;
+        std::memcpy(mData + offset, source, length);
+        source += length;
+        remaining -= length;
+        position += length;
+      }
+    }
+    __atomic_store_n(&mHeader->writePosition, position, __ATOMIC_RELEASE);
+    __atomic_store_n(&mHeader->sequence, sequence + 1u, __ATOMIC_RELEASE);
+  }
+  else { // nothing to do
+  }
+  aProgressFlag->store(false);
+}
@@ -0,0 +1,101 @@
+/*
+ * Copyright 2018 Now Technologies Zrt.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+ * THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef NOWTECH_LOG_MMAP_SINK_INCLUDED
+#define NOWTECH_LOG_MMAP_SINK_INCLUDED
+
+#include "LogSink.h"
+#include <cstdint>
+
+namespace nowtech {
+
+  /// Header of the ring file written by LogMmapSink. The data area follows
+  /// it and is written cyclically. All the fields are little endian on the
+  /// usual targets, as they are simply stored from memory.
+  struct LogMmapHeader {
+    static constexpr char     cMagic[8]   = { 'N', 'T', 'L', 'O', 'G', 'R', 'N', 'G' };
+    static constexpr uint32_t cVersion    = 2u;
+
+    char     magic[8];
+    uint32_t version;
+
+    /// sizeof(LogMmapHeader), the offset of the data area.
+    uint32_t headerSize;
+
+    /// Length of the data area in bytes.
+    uint64_t capacity;
+
+    /// Total number of bytes ever written. The next byte goes to
+    /// writePosition % capacity. Updated after the data is in place.
+    uint64_t writePosition;
+
+    /// Odd while a write is in progress, even after it. Lets a reader detect
+    /// concurrent change.
+    uint64_t sequence;
+
+    /// End of the write in progress, stored before the data is copied. The
+    /// bytes from writeEnd - capacity to writePosition are valid, the ones
+    /// between writePosition and writeEnd may be partially overwritten.
+    /// After a crash it stays until the continuing writes pass it.
+    uint64_t writeEnd;
+
+    uint8_t  reserved[16];
+  };
+
+  /// Sink writing a fixed size memory-mapped file used as a ring. Writes are
+  /// plain memory copies without system calls. The kernel keeps the contents
+  /// even if the process crashes, so the newest lines can be recovered with
+  /// tools/logringdump. An existing file of the same capacity is continued.
+  /// Data still waiting in the queue or the buffers of Log is lost in a
+  /// crash, so a short LogConfig::refreshPeriod is recommended.
+  /// Nothing is synchronized to the disk explicitly, so a machine crash may
+  /// lose data not yet written back by the kernel.
+  class LogMmapSink final : public LogSink {
+  private:
+    LogMmapHeader *mHeader;
+    char          *mData;
+    uint64_t       mCapacity;
+    uint64_t       mMappedLength;
+
+  public:
+    /// @param aPath file to create or continue.
+    /// @param aCapacity length of the data area in bytes.
+    LogMmapSink(char const * const aPath, uint64_t const aCapacity) noexcept;
+
+    virtual ~LogMmapSink() noexcept;
+
+    /// @return true if the file could be mapped.
+    bool isValid() const noexcept {
+      return mHeader != nullptr;
+    }
+
+    virtual LogSizeType getGatherLimit() const noexcept override {
+      return std::numeric_limits<LogSizeType>::max();
+    }
+
+    virtual void write(LogBufferSlice const * const aSlices, LogSizeType const aCount, std::atomic<bool> *aProgressFlag) noexcept override;
+  };
+
+} //namespace nowtech
+
+#endif // NOWTECH_LOG_MMAP_SINK_INCLUDED
@@ -0,0 +1,195 @@
+/*
+ * Copyright 2018 Now Technologies Zrt.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+ * THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef NOWTECH_LOGMPSCRING_INCLUDED
+#define NOWTECH_LOGMPSCRING_INCLUDED
+
+#include "BanCopyMove.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+
+namespace nowtech {
+
+  /// Bounded multi-producer single-consumer queue of fixed size chunks, after
+  /// Dmitry Vyukov's bounded queue. The chunks are stored inline in slots
+  /// aligned to cache lines, each slot starting with its sequence number,
+  /// which tells whose turn it is. A push costs a CAS on the enqueue position
+  /// and a release store on the slot, a pop has no read-modify-write at all.
+  /// The slot count is rounded up to a power of 2.
+  /// The ring either allocates its memory, or uses memory given by the user,
+  /// which may be shared among processes. In the latter case the positions
+  /// and slots are all in that memory, and each process has its own
+  /// LogMpscRing object referring to it.
+  class LogMpscRing final : public BanCopyMove {
+  public:
+    static constexpr size_t cCacheLineSize = 64u;
+
+  private:
+    /// Keeps the positions written by the producers and the consumer in
+    /// separate cache lines.
+    struct Position {
+      std::atomic<size_t> value;
+      char padding[cCacheLineSize - sizeof(std::atomic<size_t>)];
+    };
+
+    size_t const mChunkSize;
+    size_t const mSlotCount;
+    size_t const mMask;
+    size_t const mSlotSize;
+    /// The allocated memory, nullptr if given by the user.
+    char * const mMemory;
+    Position &mEnqueuePosition;
+    Position &mDequeuePosition;
+    char * const mSlots;
+
+  public:
+    LogMpscRing(size_t const aSlotCount, size_t const aChunkSize) noexcept
+      : LogMpscRing(new char[getMemorySize(aSlotCount, aChunkSize) + cCacheLineSize], true, aSlotCount, aChunkSize, true) {
+    }
+
+    /// Places the ring in the given memory.
+    /// @param aMemory aligned to cCacheLineSize, at least getMemorySize() bytes.
+    /// @param aInitialize true for the first user of the memory, false if the
+    /// ring there was already initialized, maybe by an other process.
+    LogMpscRing(void * const aMemory, size_t const aSlotCount, size_t const aChunkSize, bool const aInitialize) noexcept
+      : LogMpscRing(static_cast<char*>(aMemory), false, aSlotCount, aChunkSize, aInitialize) {
+    }
+
+    ~LogMpscRing() noexcept {
+      delete[] mMemory;
+    }
+
+    /// @return the memory needed for a ring placed in user memory.
+    static constexpr size_t getMemorySize(size_t const aSlotCount, size_t const aChunkSize) noexcept {
+      return 2u * sizeof(Position) + roundUpToPowerOf2(aSlotCount) * getSlotSize(aChunkSize);
+    }
+
+    /// Tells the processor we are in a busy wait loop.
+    static void relax() noexcept {
+#if defined(__x86_64__) || defined(__i386__)
+      __builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+      asm volatile("yield");
+#endif
+    }
+
+    size_t getSlotCount() const noexcept {
+      return mSlotCount;
+    }
+
+    /// Copies the chunk into the next free slot. Can be called from any thread.
+    /// @return false if the ring is full.
+    bool tryPush(char const * const aChunkStart) noexcept {
+      bool result;
+      size_t position = mEnqueuePosition.value.load(std::memory_order_relaxed);
+      while(true) {
+        std::atomic<size_t> * const sequence = getSequence(position & mMask);
+        intptr_t const difference = static_cast<intptr_t>(sequence->load(std::memory_order_acquire)) - static_cast<intptr_t>(position);
+        if(difference == 0) {
+          if(mEnqueuePosition.value.compare_exchange_weak(position, position + 1u, std::memory_order_relaxed)) {
+            std::memcpy(getPayload(sequence), aChunkStart, mChunkSize);
+            sequence->store(position + 1u, std::memory_order_release);
+            result = true;
+            break;
+          }
+          else { // position was updated by the CAS, retry with it
+          }
+        }
+        else if(difference < 0) {
+          result = false;
+          break;
+        }
+        else {
+          position = mEnqueuePosition.value.load(std::memory_order_relaxed);
+        }
+      }
+      return result;
+    }
+
+    /// Copies the oldest chunk out of the ring. Must be called only from the
+    /// single consumer thread.
+    /// @return false if the ring is empty.
+    bool tryPop(char * const aChunkStart) noexcept {
+      bool result;
+      size_t const position = mDequeuePosition.value.load(std::memory_order_relaxed);
+      std::atomic<size_t> * const sequence = getSequence(position & mMask);
+      if(sequence->load(std::memory_order_acquire) == position + 1u) {
+        std::memcpy(aChunkStart, getPayload(sequence), mChunkSize);
+        sequence->store(position + mSlotCount, std::memory_order_release);
+        mDequeuePosition.value.store(position + 1u, std::memory_order_relaxed);
+        result = true;
+      }
+      else {
+        result = false;
+      }
+      return result;
+    }
+
+  private:
+    LogMpscRing(char * const aMemory, bool const aOwned, size_t const aSlotCount, size_t const aChunkSize, bool const aInitialize) noexcept
+      : mChunkSize(aChunkSize)
+      , mSlotCount(roundUpToPowerOf2(aSlotCount))
+      , mMask(mSlotCount - 1u)
+      , mSlotSize(getSlotSize(aChunkSize))
+      , mMemory(aOwned ? aMemory : nullptr)
+      , mEnqueuePosition(*reinterpret_cast<Position*>(aMemory + (cCacheLineSize - reinterpret_cast<uintptr_t>(aMemory) % cCacheLineSize) % cCacheLineSize))
+      , mDequeuePosition((&mEnqueuePosition)[1])
+      , mSlots(reinterpret_cast<char*>(&mDequeuePosition + 1)) {
+      if(aInitialize) {
+        for(size_t i = 0u; i < mSlotCount; ++i) {
+          new(getSequence(i)) std::atomic<size_t>(i);
+        }
+        new(&mEnqueuePosition.value) std::atomic<size_t>(0u);
+        new(&mDequeuePosition.value) std::atomic<size_t>(0u);
+      }
+      else { // nothing to do
+      }
+    }
+
+    static constexpr size_t getSlotSize(size_t const aChunkSize) noexcept {
+      return (sizeof(std::atomic<size_t>) + aChunkSize + cCacheLineSize - 1u) / cCacheLineSize * cCacheLineSize;
+    }
+
+    static constexpr size_t roundUpToPowerOf2(size_t const aValue) noexcept {
+      size_t result = 2u;
+      while(result < aValue) {
+        result <<= 1u;
+      }
+      return result;
+    }
+
+    std::atomic<size_t> *getSequence(size_t const aIndex) const noexcept {
+      return reinterpret_cast<std::atomic<size_t>*>(mSlots + aIndex * mSlotSize);
+    }
+
+    static char *getPayload(std::atomic<size_t> * const aSequence) noexcept {
+      return reinterpret_cast<char*>(aSequence + 1u);
+    }
+  };
+
+} // namespace nowtech
+
+#endif // NOWTECH_LOGMPSCRING_INCLUDED
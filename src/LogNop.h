@@ -65,7 +65,8 @@ public:
   }
 
   /// Does nothing.
-  virtual void push(char const * const aChunkStart, bool const) noexcept {
+  virtual bool push(char const * const aChunkStart, bool const) noexcept {
+    return true;
   }
 
   /// Does nothing.
@@ -0,0 +1,357 @@
+//
+// Copyright 2018 Now Technologies Zrt.
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge,
+// publish, distribute, sublicense, and/or sell copies of the Software,
+// and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#include "LogOrderingSink.h"
+
+constexpr nowtech::LogSizeType nowtech::LogOrderingSink::cReportLength;
+
+nowtech::LogOrderingSink::LogOrderingSink(LogSink &aNext, LogSizeType const aWindow, LogSizeType const aSlotLength, uint32_t const aMaxDelay, bool const aKeepTags) noexcept
+  : LogDecoratorSink(aNext)
+  , mWindow(aWindow > 0u ? aWindow : 1u)
+  , mSlotLength(aSlotLength)
+  , mMaxDelay(aMaxDelay)
+  , mKeepTags(aKeepTags)
+  , mSlots(new Slot[mWindow])
+  , mStorage(new char[mWindow * aSlotLength])
+  , mHeap(new LogSizeType[mWindow])
+  , mFree(new LogSizeType[mWindow])
+  , mFreeCount(mWindow) {
+  for(LogSizeType i = 0u; i < mWindow; ++i) {
+    mFree[i] = i;
+  }
+  mMissingMessages.store(0u);
+  mLateMessages.store(0u);
+}
+
+nowtech::LogOrderingSink::~LogOrderingSink() noexcept {
+  if(mOutputLength > 0u && mHeapSize > 0u) {
+    // The flag of the last write is gone with the transmitter.
+    mNext.waitForCompletion();
+    mNext.poll();
+    resetOutput();
+    while(mHeapSize > 0u) {
+      writeLowest();
+      writeContiguous();
+    }
+    forwardOutput(getOutputCount());
+  }
+  else { // nothing to do
+  }
+  delete[] mFree;
+  delete[] mHeap;
+  delete[] mStorage;
+  delete[] mSlots;
+}
+
+void nowtech::LogOrderingSink::write(LogBufferSlice const * const aSlices, LogSizeType const aCount, std::atomic<bool> *aProgressFlag) noexcept {
+  if(checkOutputs(aProgressFlag)) {
+    resetOutput();
+    for(LogSizeType i = 0u; i < aCount; ++i) {
+      char const *data = aSlices[i].buffer;
+      char const * const end = data + aSlices[i].length;
+      while(data < end) {
+        if(mAtMessageStart) {
+          mAtMessageStart = false;
+          mLineBreakTagged = false;
+          mBodyStart = true;
+          mTagged = *data == Log::cSequenceTag;
+          mDirect = true;
+          if(mTagged) {
+            mTagDigitsLeft = Log::cSequenceTagLength - 1u;
+            mSequence = 0u;
+            ++data;
+          }
+          else { // nothing to do
+          }
+        }
+        else { // nothing to do
+        }
+        while(data < end && mTagDigitsLeft > 0u) {
+          char const digit = *data;
+          mSequence = mSequence * NumericSystem::cHexadecimal + static_cast<uint32_t>(digit <= '9' ? digit - '0' : digit - 'a' + 10);
+          ++data;
+          --mTagDigitsLeft;
+          if(mTagDigitsLeft == 0u) {
+            startMessage();
+          }
+          else { // nothing to do
+          }
+        }
+        if(data < end && mBodyStart) {
+          // No sink after this one parses a message left without tags.
+          mBodyStart = false;
+          mStripLineBreaks = !mKeepTags && *data != Log::cTopicTag;
+        }
+        else { // nothing to do
+        }
+        if(data < end) {
+          char const * const lineEnd = LogMessageParser::findMessageEnd(data, end, mLineBreakTagged);
+          char const * const next = lineEnd == nullptr ? end : lineEnd + 1;
+          if(mStripLineBreaks) {
+            LogMessageParser::forEachPiece(data, static_cast<LogSizeType>(next - data), [this](char const * const aPiece, LogSizeType const aLength) {
+              take(aPiece, aLength, false);
+            });
+            if(lineEnd != nullptr) {
+              take(next, 0u, true);
+            }
+            else { // nothing to do
+            }
+          }
+          else {
+            take(data, static_cast<LogSizeType>(next - data), lineEnd != nullptr);
+          }
+          mAtMessageStart = lineEnd != nullptr;
+          data = next;
+        }
+        else { // nothing to do
+        }
+      }
+    }
+    passOn(mSlices, getOutputCount(), aProgressFlag);
+  }
+  else { // nothing to do
+  }
+}
+
+void nowtech::LogOrderingSink::poll() noexcept {
+  LogDecoratorSink::poll();
+  // Nothing may come between the parts of a message being written, and our
+  // buffers must not be written while the next sink may still use them.
+  if(mMaxDelay.count() > 0 && mHeapSize > 0u && (mAtMessageStart || !mDirect) && !isNextBusy()) {
+    std::chrono::steady_clock::time_point const now = std::chrono::steady_clock::now();
+    resetOutput();
+    bool expired = true;
+    while(mHeapSize > 0u && expired) {
+      expired = false;
+      for(LogSizeType i = 0u; i < mHeapSize && !expired; ++i) {
+        expired = now - mSlots[mHeap[i]].arrival >= mMaxDelay;
+      }
+      if(expired) {
+        writeLowest();
+        writeContiguous();
+      }
+      else { // nothing to do
+      }
+    }
+    forwardOutput(getOutputCount());
+  }
+  else { // nothing to do
+  }
+}
+
+void nowtech::LogOrderingSink::take(char const * const aData, LogSizeType const aLength, bool const aMessageEnd) noexcept {
+  Slot &slot = mSlots[mCurrent];
+  if(mDirect) {
+    emit(aData, aLength);
+    if(aMessageEnd && mTagged && mSequence == mNextExpected) {
+      ++mNextExpected;
+      writeContiguous();
+    }
+    else { // nothing to do
+    }
+  }
+  else if(slot.length + aLength <= mSlotLength) {
+    std::memcpy(mStorage + mCurrent * mSlotLength + slot.length, aData, aLength);
+    slot.length += aLength;
+    if(aMessageEnd) {
+      enqueue();
+    }
+    else { // nothing to do
+    }
+  }
+  else {
+    // Too long to wait, so the ones before it are not waited for either.
+    while(mHeapSize > 0u && isBefore(mSlots[mHeap[0]].sequence, mSequence)) {
+      writeLowest();
+    }
+    if(isBefore(mSequence, mNextExpected)) {
+      mLateMessages.fetch_add(1u);
+    }
+    else {
+      skipTo(mSequence);
+    }
+    emitTag(mSequence);
+    emit(mStorage + mCurrent * mSlotLength, slot.length);
+    mFree[mFreeCount] = mCurrent;
+    ++mFreeCount;
+    mDirect = true;
+    take(aData, aLength, aMessageEnd);
+  }
+}
+
+void nowtech::LogOrderingSink::startMessage() noexcept {
+  if(isBefore(mSequence, mNextExpected)) {
+    mLateMessages.fetch_add(1u);
+    emitTag(mSequence);
+  }
+  else if(mSequence == mNextExpected) {
+    emitTag(mSequence);
+  }
+  else {
+    mDirect = false;
+    --mFreeCount;
+    mCurrent = mFree[mFreeCount];
+    mSlots[mCurrent].sequence = mSequence;
+    mSlots[mCurrent].length = 0u;
+  }
+}
+
+void nowtech::LogOrderingSink::enqueue() noexcept {
+  mDirect = true;
+  if(isBefore(mSequence, mNextExpected)) {
+    // Given up by poll() while it was arriving.
+    mLateMessages.fetch_add(1u);
+    emitTag(mSequence);
+    emit(mStorage + mCurrent * mSlotLength, mSlots[mCurrent].length);
+    mFree[mFreeCount] = mCurrent;
+    ++mFreeCount;
+  }
+  else {
+    mSlots[mCurrent].arrival = std::chrono::steady_clock::now();
+    pushHeap(mCurrent);
+    if(mHeapSize == mWindow) {
+      writeLowest();
+    }
+    else { // nothing to do
+    }
+    writeContiguous();
+  }
+}
+
+void nowtech::LogOrderingSink::writeLowest() noexcept {
+  LogSizeType const index = popHeap();
+  Slot const &slot = mSlots[index];
+  skipTo(slot.sequence);
+  emitTag(slot.sequence);
+  emit(mStorage + index * mSlotLength, slot.length);
+  mNextExpected = slot.sequence + 1u;
+  mFree[mFreeCount] = index;
+  ++mFreeCount;
+}
+
+void nowtech::LogOrderingSink::writeContiguous() noexcept {
+  while(mHeapSize > 0u && mSlots[mHeap[0]].sequence == mNextExpected) {
+    writeLowest();
+  }
+}
+
+void nowtech::LogOrderingSink::skipTo(uint32_t const aSequence) noexcept {
+  if(isBefore(mNextExpected, aSequence)) {
+    uint32_t const missing = aSequence - mNextExpected;
+    mMissingMessages.fetch_add(missing);
+    // -=- 4294967295 messages missing -=-
+    char *end = mReport;
+    end = Log::render(end, "-=- ");
+    end = Log::render(end, missing);
+    end = Log::render(end, " messages missing -=-\n");
+    emit(mReport, static_cast<LogSizeType>(end - mReport));
+    mNextExpected = aSequence;
+  }
+  else { // nothing to do
+  }
+}
+
+void nowtech::LogOrderingSink::emitTag(uint32_t const aSequence) noexcept {
+  if(mKeepTags) {
+    char tag[Log::cSequenceTagLength];
+    tag[0] = Log::cSequenceTag;
+    for(LogSizeType digit = Log::cSequenceTagLength - 1u; digit > 0u; --digit) {
+      uint32_t const value = (aSequence >> ((Log::cSequenceTagLength - 1u - digit) * 4u)) & 0xfu;
+      tag[digit] = static_cast<char>(value < 10u ? '0' + value : 'a' + value - 10u);
+    }
+    emit(tag, Log::cSequenceTagLength);
+  }
+  else { // nothing to do
+  }
+}
+
+void nowtech::LogOrderingSink::emit(char const *aData, LogSizeType aLength) noexcept {
+  while(aLength > 0u) {
+    if(mSlices[mOutputCount].length < mOutputLength) {
+      LogSizeType const space = mOutputLength - mSlices[mOutputCount].length;
+      LogSizeType const length = space < aLength ? space : aLength;
+      std::memcpy(mOutputs[mOutputCount] + mSlices[mOutputCount].length, aData, length);
+      mSlices[mOutputCount].length += length;
+      aData += length;
+      aLength -= length;
+    }
+    else if(mOutputCount + 1u == mGatherLimit) {
+      forwardOutput(mGatherLimit);
+    }
+    else {
+      ++mOutputCount;
+      mSlices[mOutputCount].buffer = mOutputs[mOutputCount];
+      mSlices[mOutputCount].length = 0u;
+    }
+  }
+}
+
+void nowtech::LogOrderingSink::resetOutput() noexcept {
+  mOutputCount = 0u;
+  mSlices[0].buffer = mOutputs[0];
+  mSlices[0].length = 0u;
+}
+
+void nowtech::LogOrderingSink::forwardOutput(LogSizeType const aCount) noexcept {
+  if(aCount > 0u) {
+    forward(mSlices, aCount);
+  }
+  else { // nothing to do
+  }
+  resetOutput();
+}
+
+void nowtech::LogOrderingSink::pushHeap(LogSizeType const aSlot) noexcept {
+  LogSizeType child = mHeapSize;
+  ++mHeapSize;
+  while(child > 0u && isBefore(mSlots[aSlot].sequence, mSlots[mHeap[(child - 1u) / 2u]].sequence)) {
+    mHeap[child] = mHeap[(child - 1u) / 2u];
+    child = (child - 1u) / 2u;
+  }
+  mHeap[child] = aSlot;
+}
+
+nowtech::LogSizeType nowtech::LogOrderingSink::popHeap() noexcept {
+  LogSizeType const result = mHeap[0];
+  --mHeapSize;
+  LogSizeType const last = mHeap[mHeapSize];
+  LogSizeType parent = 0u;
+  LogSizeType child = 1u;
+  while(child < mHeapSize) {
+    if(child + 1u < mHeapSize && isBefore(mSlots[mHeap[child + 1u]].sequence, mSlots[mHeap[child]].sequence)) {
+      ++child;
+    }
+    else { // nothing to do
+    }
+    if(isBefore(mSlots[mHeap[child]].sequence, mSlots[last].sequence)) {
+      mHeap[parent] = mHeap[child];
+      parent = child;
+      child = 2u * parent + 1u;
+    }
+    else {
+      child = mHeapSize;
+    }
+  }
+  mHeap[parent] = last;
+  return result;
+}
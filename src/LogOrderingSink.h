@@ -0,0 +1,178 @@
+/*
+ * Copyright 2018 Now Technologies Zrt.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+ * THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef NOWTECH_LOG_ORDERING_SINK_INCLUDED
+#define NOWTECH_LOG_ORDERING_SINK_INCLUDED
+
+#include "LogSink.h"
+#include <chrono>
+
+namespace nowtech {
+
+  /// Decorator writing the messages in the order of the sequence tags of
+  /// LogConfig::emitSequenceTags instead of the order the transmitter
+  /// reassembled them. Each thread sends its messages in order, so this is a
+  /// merge of the threads' streams: a message is passed on as soon as all the
+  /// numbers before it were, otherwise it waits in a window of aWindow slots.
+  /// If the window is full, or a message waited aMaxDelay ms, the missing
+  /// numbers before the lowest one are given up and reported in a
+  /// -=- N messages missing -=- line. A missing message arriving later is
+  /// written as it comes, and counted as late.
+  /// Messages longer than aSlotLength can not wait, and end the window.
+  /// Messages without tag, like the reports of the transmitter, pass through.
+  /// The tags are removed unless aKeepTags is set, the topic tags are left
+  /// for the next sink, and so are the Log::cLineBreakTag bytes of the
+  /// messages having one. Must be the first sink, and the deltas of
+  /// LogConfig::compactHeader refer to the original order.
+  class LogOrderingSink final : public LogDecoratorSink {
+  private:
+    /// The longest report of the missing messages.
+    static constexpr LogSizeType cReportLength = 48u;
+
+    struct Slot final {
+      uint32_t sequence;
+      LogSizeType length;
+      std::chrono::steady_clock::time_point arrival;
+    };
+
+    LogSizeType const  mWindow;
+    LogSizeType const  mSlotLength;
+    std::chrono::milliseconds const mMaxDelay;
+    bool const         mKeepTags;
+    Slot * const       mSlots;
+    char * const       mStorage;
+
+    /// Indices of the waiting slots, a min-heap by sequence number.
+    LogSizeType * const mHeap;
+    LogSizeType        mHeapSize = 0u;
+
+    /// Indices of the free slots, a stack.
+    LogSizeType * const mFree;
+    LogSizeType        mFreeCount;
+
+    /// The sequence number the output continues with.
+    uint32_t           mNextExpected = 0u;
+
+    bool               mAtMessageStart = true;
+    LogSizeType        mTagDigitsLeft = 0u;
+    uint32_t           mSequence = 0u;
+
+    /// True if the current message has a tag.
+    bool               mTagged = false;
+
+    /// True until the first byte after the sequence tag is seen.
+    bool               mBodyStart = false;
+
+    /// True if the Log::cLineBreakTag bytes of the current message are removed.
+    bool               mStripLineBreaks = false;
+    bool               mLineBreakTagged = false;
+
+    /// True if the current message goes to the output as it comes, false if
+    /// it goes into mCurrent.
+    bool               mDirect = true;
+    LogSizeType        mCurrent = 0u;
+
+    LogSizeType        mOutputCount = 0u;
+    char               mReport[cReportLength];
+    std::atomic<uint32_t> mMissingMessages;
+    std::atomic<uint32_t> mLateMessages;
+
+  public:
+    /// @param aNext the sink receiving the output, not owned.
+    /// @param aWindow number of messages that can wait for the missing ones.
+    /// @param aSlotLength the longest message that can wait, in bytes.
+    /// @param aMaxDelay maximum time in ms a message waits, 0 means only the
+    /// window is limited.
+    /// @param aKeepTags if true, the sequence tags are passed on.
+    LogOrderingSink(LogSink &aNext, LogSizeType const aWindow, LogSizeType const aSlotLength, uint32_t const aMaxDelay, bool const aKeepTags = false) noexcept;
+
+    /// Writes the messages still waiting. Must run after the transmitter
+    /// thread stopped, as it is done in the caller thread.
+    virtual ~LogOrderingSink() noexcept;
+
+    /// @return the number of sequence numbers given up.
+    uint32_t getMissingMessages() const noexcept {
+      return mMissingMessages.load();
+    }
+
+    /// @return the number of messages arriving after they were given up.
+    uint32_t getLateMessages() const noexcept {
+      return mLateMessages.load();
+    }
+
+    /// The next sink clears the progress flag, or this one if nothing passed.
+    virtual void write(LogBufferSlice const * const aSlices, LogSizeType const aCount, std::atomic<bool> *aProgressFlag) noexcept override;
+
+    /// Writes the messages waiting longer than aMaxDelay.
+    virtual void poll() noexcept override;
+
+  private:
+    /// Tells if aFirst comes before aSecond, even after wrapping around.
+    static bool isBefore(uint32_t const aFirst, uint32_t const aSecond) noexcept {
+      return static_cast<int32_t>(aFirst - aSecond) < 0;
+    }
+
+    /// Processes the part of a message after the tag.
+    void take(char const * const aData, LogSizeType const aLength, bool const aMessageEnd) noexcept;
+
+    /// Decides where the message goes when its tag is complete.
+    void startMessage() noexcept;
+
+    /// Puts the complete message in mCurrent into the heap.
+    void enqueue() noexcept;
+
+    /// Writes the lowest waiting message, reporting the numbers missing before it.
+    void writeLowest() noexcept;
+
+    /// Writes the waiting messages which are next in sequence.
+    void writeContiguous() noexcept;
+
+    /// Reports the numbers missing before aSequence, and continues from it.
+    void skipTo(uint32_t const aSequence) noexcept;
+
+    /// Writes the sequence tag if needed.
+    void emitTag(uint32_t const aSequence) noexcept;
+
+    /// Appends to the output buffers, writing them to the next sink if full.
+    void emit(char const *aData, LogSizeType aLength) noexcept;
+
+    /// Starts filling the output buffers from the first one.
+    void resetOutput() noexcept;
+
+    /// @return the number of output buffers holding something.
+    LogSizeType getOutputCount() const noexcept {
+      return mOutputCount + (mSlices[mOutputCount].length > 0u ? 1u : 0u);
+    }
+
+    /// Writes the first aCount output buffers to the next sink, waits for
+    /// it, and starts filling them again.
+    void forwardOutput(LogSizeType const aCount) noexcept;
+
+    void pushHeap(LogSizeType const aSlot) noexcept;
+
+    LogSizeType popHeap() noexcept;
+  };
+
+} //namespace nowtech
+
+#endif // NOWTECH_LOG_ORDERING_SINK_INCLUDED
@@ -0,0 +1,268 @@
+//
+// Copyright 2018 Now Technologies Zrt.
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge,
+// publish, distribute, sublicense, and/or sell copies of the Software,
+// and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#include "LogPosix.h"
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+
+namespace {
+  constexpr uint64_t cNsPerMs  = 1000000u;
+  constexpr uint64_t cNsPerSec = 1000000000u;
+
+  /// Cached per thread to spare the system call in each message header.
+  thread_local uint32_t tThreadId = 0u;
+  thread_local char tThreadName[nowtech::LogPosix::cThreadNameLength] = "";
+
+  uint64_t now(clockid_t const aClockId) noexcept {
+    timespec time;
+    clock_gettime(aClockId, &time);
+    return static_cast<uint64_t>(time.tv_sec) * cNsPerSec + static_cast<uint64_t>(time.tv_nsec);
+  }
+}
+
+nowtech::LogPosix::LogPosix(int const aFd, LogConfig const & aConfig, Clock const aClock) noexcept
+  : LogOsInterface(aConfig)
+  , mQueue(aConfig.queueLength, mChunkSize, aConfig)
+  , mShmRing(nullptr)
+  , mFdSink(aFd)
+  , mSink(mFdSink)
+  , mClockId(aClock == Clock::cCoarse ? CLOCK_MONOTONIC_COARSE : CLOCK_MONOTONIC)
+  , mWallClockId(aClock == Clock::cCoarse ? CLOCK_REALTIME_COARSE : CLOCK_REALTIME) {
+  initClock(aClock);
+  initMutex();
+}
+
+nowtech::LogPosix::LogPosix(LogSink &aSink, LogConfig const & aConfig, Clock const aClock) noexcept
+  : LogOsInterface(aConfig)
+  , mQueue(aConfig.queueLength, mChunkSize, aConfig)
+  , mShmRing(nullptr)
+  , mFdSink(-1)
+  , mSink(aSink)
+  , mClockId(aClock == Clock::cCoarse ? CLOCK_MONOTONIC_COARSE : CLOCK_MONOTONIC)
+  , mWallClockId(aClock == Clock::cCoarse ? CLOCK_REALTIME_COARSE : CLOCK_REALTIME) {
+  initClock(aClock);
+  initMutex();
+}
+
+nowtech::LogPosix::LogPosix(LogSink &aSink, LogConfig const & aConfig, LogStorage const &aStorage, Clock const aClock) noexcept
+  : LogOsInterface(aConfig)
+  , mQueue(aStorage.queue, aConfig.queueLength, mChunkSize, aConfig)
+  , mShmRing(nullptr)
+  , mFdSink(-1)
+  , mSink(aSink)
+  , mClockId(aClock == Clock::cCoarse ? CLOCK_MONOTONIC_COARSE : CLOCK_MONOTONIC)
+  , mWallClockId(aClock == Clock::cCoarse ? CLOCK_REALTIME_COARSE : CLOCK_REALTIME) {
+  initClock(aClock);
+  initMutex();
+}
+
+// mQueue is not used with a ring, so it gets the minimal size.
+nowtech::LogPosix::LogPosix(LogShmRing &aRing, LogConfig const & aConfig, Clock const aClock) noexcept
+  : LogOsInterface(aConfig)
+  , mQueue(1u, mChunkSize, aConfig)
+  , mShmRing(&aRing)
+  , mFdSink(-1)
+  , mSink(mFdSink)
+  , mClockId(aClock == Clock::cCoarse ? CLOCK_MONOTONIC_COARSE : CLOCK_MONOTONIC)
+  , mWallClockId(aClock == Clock::cCoarse ? CLOCK_REALTIME_COARSE : CLOCK_REALTIME) {
+  initClock(aClock);
+  initMutex();
+}
+
+nowtech::LogPosix::LogPosix(LogShmRing &aRing, LogSink &aSink, LogConfig const & aConfig, Clock const aClock) noexcept
+  : LogOsInterface(aConfig)
+  , mQueue(1u, mChunkSize, aConfig)
+  , mShmRing(&aRing)
+  , mFdSink(-1)
+  , mSink(aSink)
+  , mClockId(aClock == Clock::cCoarse ? CLOCK_MONOTONIC_COARSE : CLOCK_MONOTONIC)
+  , mWallClockId(aClock == Clock::cCoarse ? CLOCK_REALTIME_COARSE : CLOCK_REALTIME) {
+  initClock(aClock);
+  initMutex();
+}
+
+nowtech::LogPosix::~LogPosix() noexcept {
+  pthread_mutex_destroy(&mApiMutex);
+}
+
+void nowtech::LogPosix::registerThreadName(char const * const aTaskName) noexcept {
+  std::strncpy(tThreadName, aTaskName, cThreadNameLength - 1u);
+  tThreadName[cThreadNameLength - 1u] = 0;
+  pthread_setname_np(pthread_self(), tThreadName);
+}
+
+char const * nowtech::LogPosix::getThreadName(uint32_t const aHandle) noexcept {
+  if(aHandle == getCurrentThreadId()) {
+    std::strcpy(mNameBuffer, getCurrentThreadName());
+  }
+  else {
+    mNameBuffer[0] = 0;
+    char path[48];
+    std::snprintf(path, sizeof(path), "/proc/self/task/%u/comm", static_cast<unsigned>(aHandle));
+    int const fd = open(path, O_RDONLY | O_CLOEXEC);
+    if(fd >= 0) {
+      ssize_t length = read(fd, mNameBuffer, cThreadNameLength);
+      length = length > 0 ? length : 0;
+      if(length > 0 && mNameBuffer[length - 1] == '\n') {
+        --length;
+      }
+      else { // nothing to do
+      }
+      mNameBuffer[length] = 0;
+      close(fd);
+    }
+    else { // nothing to do
+    }
+  }
+  return mNameBuffer;
+}
+
+char const * nowtech::LogPosix::getCurrentThreadName() noexcept {
+  if(tThreadName[0] == 0) {
+    pthread_getname_np(pthread_self(), tThreadName, cThreadNameLength);
+  }
+  else { // nothing to do
+  }
+  return tThreadName;
+}
+
+uint32_t nowtech::LogPosix::getCurrentThreadId() noexcept {
+  if(tThreadId == 0u) {
+    tThreadId = static_cast<uint32_t>(syscall(SYS_gettid));
+  }
+  else { // nothing to do
+  }
+  return tThreadId;
+}
+
+uint64_t nowtech::LogPosix::getLogTimeNs() const noexcept {
+  return mTscClock.isCalibrated() ? mTscClock.getNs() : now(mClockId);
+}
+
+uint64_t nowtech::LogPosix::getWallTimeNs() const noexcept {
+  return now(mWallClockId);
+}
+
+int32_t nowtech::LogPosix::getUtcOffset(uint64_t const aUnixSeconds) const noexcept {
+  time_t const time = static_cast<time_t>(aUnixSeconds);
+  tm local;
+  return localtime_r(&time, &local) != nullptr ? static_cast<int32_t>(local.tm_gmtoff) : 0;
+}
+
+void nowtech::LogPosix::createTransmitterThread(Log *aLog, void(* aThreadFunc)(void *)) noexcept {
+  mLog = aLog;
+  mThreadFunc = aThreadFunc;
+  if(hasTransmitterThread()) {
+    pthread_create(&mTransmitterThread, nullptr, threadFunction, this);
+  }
+  else { // nothing to do
+  }
+}
+
+void nowtech::LogPosix::joinTransmitterThread() noexcept {
+  if(hasTransmitterThread()) {
+    pthread_join(mTransmitterThread, nullptr);
+  }
+  else { // nothing to do
+  }
+}
+
+void nowtech::LogPosix::initClock(Clock const aClock) noexcept {
+  if(aClock == Clock::cTsc) {
+    mTscClock.calibrate(cTscCalibrationTime);
+  }
+  else { // nothing to do
+  }
+}
+
+void nowtech::LogPosix::initMutex() noexcept {
+  pthread_mutexattr_t attributes;
+  pthread_mutexattr_init(&attributes);
+  pthread_mutexattr_settype(&attributes, PTHREAD_MUTEX_RECURSIVE);
+  pthread_mutex_init(&mApiMutex, &attributes);
+  pthread_mutexattr_destroy(&attributes);
+}
+
+void *nowtech::LogPosix::threadFunction(void *aThis) noexcept {
+  LogPosix * const self = static_cast<LogPosix*>(aThis);
+  pthread_setname_np(pthread_self(), "logtransmitter");
+  self->mThreadFunc(self->mLog);
+  return nullptr;
+}
+
+bool nowtech::LogPosix::pop(char * const aChunkStart) noexcept {
+  uint64_t timeout = mPauseLength * cNsPerMs;
+  if(mRefreshNeeded != nullptr) {
+    uint64_t const current = getLogTimeNs();
+    if(current >= mRefreshDeadline) {
+      mRefreshDeadline = UINT64_MAX;
+      mRefreshNeeded->store(true);
+      timeout = 0u;
+    }
+    else if(mRefreshDeadline - current < timeout) {
+      timeout = mRefreshDeadline - current;
+    }
+    else { // nothing to do
+    }
+  }
+  else { // nothing to do
+  }
+  mSink.poll();
+  return mShmRing == nullptr ? mQueue.receive(aChunkStart, timeout) : mShmRing->pop(aChunkStart, timeout);
+}
+
+void nowtech::LogPosix::sleep(uint32_t const aMs) noexcept {
+  timespec duration;
+  duration.tv_sec = static_cast<time_t>(aMs / 1000u);
+  duration.tv_nsec = static_cast<long>((aMs % 1000u) * cNsPerMs);
+  nanosleep(&duration, nullptr);
+}
+
+bool nowtech::LogPosix::tryPop(char * const aChunkStart) noexcept {
+  bool result;
+  if(!hasTransmitterThread()) {
+    result = false;
+  }
+  else if(mShmRing == nullptr) {
+    result = mQueue.tryPop(aChunkStart);
+  }
+  else {
+    result = mShmRing->pop(aChunkStart, 0u);
+  }
+  return result;
+}
+
+void nowtech::LogPosix::pause() noexcept {
+  if(!mSink.waitForCompletion()) {
+    timespec duration;
+    duration.tv_sec = static_cast<time_t>(mPauseLength / 1000u);
+    duration.tv_nsec = static_cast<long>((mPauseLength % 1000u) * cNsPerMs);
+    nanosleep(&duration, nullptr);
+  }
+  else { // nothing to do
+  }
+}
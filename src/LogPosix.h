@@ -0,0 +1,251 @@
+/*
+ * Copyright 2018 Now Technologies Zrt.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+ * THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef NOWTECH_LOG_POSIX_INCLUDED
+#define NOWTECH_LOG_POSIX_INCLUDED
+
+#include "Log.h"
+#include "LogFutexQueue.h"
+#include "LogShmRing.h"
+#include "LogTscClock.h"
+#include "LogFdSink.h"
+#include <pthread.h>
+#include <atomic>
+#include <cstdint>
+
+namespace nowtech {
+
+  /// Class implementing log interface for Linux using the native API: kernel
+  /// thread IDs and names, CLOCK_MONOTONIC(_COARSE) and futex based waiting.
+  /// The output goes to a LogSink, by default a LogFdSink.
+  /// With a LogShmRing the chunks go to a collector process. A producer
+  /// process has no transmitter thread, the collector has the only one.
+  /// There is no timer thread, the partially filled buffer refresh deadline
+  /// is checked by the transmitter thread when it waits for chunks.
+  class LogPosix final : public LogOsInterface {
+  public:
+    /// Maximum length of a Linux thread name including the terminating 0.
+    static constexpr uint32_t cThreadNameLength = 16u;
+
+    /// Source of the log time.
+    /// cMonotonic is CLOCK_MONOTONIC.
+    /// cCoarse is CLOCK_MONOTONIC_COARSE, much cheaper, but has only jiffy resolution.
+    /// cTsc is LogTscClock, cheaper still with ns resolution, but calibrating
+    /// it delays the construction by cTscCalibrationTime. Falls back to
+    /// CLOCK_MONOTONIC if the CPU has no usable counter.
+    enum class Clock : uint8_t {cMonotonic, cCoarse, cTsc};
+
+    /// ms
+    static constexpr uint32_t cTscCalibrationTime = 20u;
+
+  private:
+    LogFutexQueue mQueue;
+
+    /// Used instead of mQueue when constructed with one.
+    LogShmRing * const mShmRing;
+
+    /// Used when constructed with a file descriptor.
+    LogFdSink mFdSink;
+
+    /// Where the output goes.
+    LogSink &mSink;
+
+    /// Clock used for the log time.
+    int const mClockId;
+
+    /// Clock used for the wall clock, coarse if mClockId is.
+    int const mWallClockId;
+
+    /// Used instead of mClockId when calibrated.
+    LogTscClock mTscClock;
+
+    /// The transmitter thread.
+    pthread_t mTransmitterThread;
+    Log *mLog = nullptr;
+    void (*mThreadFunc)(void *) = nullptr;
+
+    /// Flag to set when mRefreshDeadline passes.
+    std::atomic<bool> *mRefreshNeeded = nullptr;
+
+    /// Monotonic time in ns when the partially filled buffer should be sent.
+    uint64_t mRefreshDeadline = UINT64_MAX;
+
+    /// Recursive for the same reason as in LogStdThreadOstream.
+    pthread_mutex_t mApiMutex;
+
+    /// Receives thread names for the registration log. The extra byte keeps
+    /// the terminator when comm fills all cThreadNameLength bytes.
+    char mNameBuffer[cThreadNameLength + 1u];
+
+  public:
+    /// The class does not own the file descriptor and only writes to it.
+    /// Opening and closing it is user responsibility.
+    /// @param aFd file descriptor to write, like STDOUT_FILENO.
+    /// @param aConfig config.
+    /// @param aClock source of the log time.
+    LogPosix(int const aFd, LogConfig const & aConfig, Clock const aClock = Clock::cMonotonic) noexcept;
+
+    /// The class does not own the sink, which must outlive it.
+    /// @param aSink where the output goes.
+    /// @param aConfig config.
+    /// @param aClock see above.
+    LogPosix(LogSink &aSink, LogConfig const & aConfig, Clock const aClock = Clock::cMonotonic) noexcept;
+
+    /// Like the one above, with the queue placed in LogStorage::queue, so no
+    /// heap memory is allocated.
+    /// @param aStorage its queue memory sized by LogMpscRing::getMemorySize()
+    /// for queueLength and chunkSize.
+    LogPosix(LogSink &aSink, LogConfig const & aConfig, LogStorage const &aStorage, Clock const aClock = Clock::cMonotonic) noexcept;
+
+    /// Producer process sending its chunks to the collector through the
+    /// ring. Nothing is written in this process.
+    /// @param aRing opened as LogShmRing::Role::cProducer.
+    /// @param aConfig config.
+    /// @param aClock see above.
+    LogPosix(LogShmRing &aRing, LogConfig const & aConfig, Clock const aClock = Clock::cMonotonic) noexcept;
+
+    /// Collector process writing the chunks of all the producers, and its
+    /// own ones, to the sink.
+    /// @param aRing opened as LogShmRing::Role::cCollector.
+    /// @param aSink where the output goes.
+    /// @param aConfig config.
+    /// @param aClock see above.
+    LogPosix(LogShmRing &aRing, LogSink &aSink, LogConfig const & aConfig, Clock const aClock = Clock::cMonotonic) noexcept;
+
+    virtual ~LogPosix() noexcept;
+
+    /// Sets the kernel name of the current thread, truncated to 15 characters.
+    /// This function MUST NOT be called from user code.
+    /// void Log::registerCurrentTask(char const * const aTaskName) may call it only.
+    virtual void registerThreadName(char const * const aTaskName) noexcept override;
+
+    /// Returns the kernel name of the thread with the given kernel thread ID.
+    /// The returned pointer is valid until the next call.
+    virtual char const * getThreadName(uint32_t const aHandle) noexcept override;
+
+    /// Returns the kernel name of the current thread, cached per thread.
+    virtual char const * getCurrentThreadName() noexcept override;
+
+    /// Returns the kernel thread ID, cached per thread.
+    virtual uint32_t getCurrentThreadId() noexcept override;
+
+    /// Returns the monotonic time in ms truncated to 32 bits.
+    virtual uint32_t getLogTime() const noexcept override {
+      return static_cast<uint32_t>(getLogTimeNs() / 1000000u);
+    }
+
+    /// Returns the monotonic time in ns from the clock given in the constructor.
+    virtual uint64_t getLogTimeNs() const noexcept override;
+
+    /// Returns CLOCK_REALTIME in ns.
+    virtual uint64_t getWallTimeNs() const noexcept override;
+
+    /// Returns the offset of the local time zone using localtime_r.
+    virtual int32_t getUtcOffset(uint64_t const aUnixSeconds) const noexcept override;
+
+    /// Creates the transmitter thread using the name logtransmitter, except
+    /// in a producer process.
+    virtual void createTransmitterThread(Log *aLog, void(* aThreadFunc)(void *)) noexcept override;
+
+    /// Joins the thread, if any.
+    virtual void joinTransmitterThread() noexcept override;
+
+    /// Enqueues the chunks, possibly blocking if the queue is full, at most
+    /// for LogConfig::blockTimeout if given.
+    virtual bool push(char const * const aChunkStart, bool const aBlocks) noexcept override {
+      return mShmRing == nullptr ? mQueue.send(aChunkStart, aBlocks) : mShmRing->push(aChunkStart, aBlocks);
+    }
+
+    /// Removes the oldest chunk from the queue, waiting at most until the
+    /// pause length or the refresh deadline elapses. Sets the refresh flag if
+    /// the deadline has passed.
+    virtual bool pop(char * const aChunkStart) noexcept override;
+
+    /// Does not take from a shared memory ring without transmitter thread,
+    /// as its chunks belong to the collector.
+    virtual bool tryPop(char * const aChunkStart) noexcept override;
+
+    /// Waits for the sink, or pauses execution for the period given in the
+    /// constructor if the sink can't wait.
+    virtual void pause() noexcept override;
+
+    virtual void registerTransmitBuffers(LogBufferSlice const * const aBuffers, LogSizeType const aCount) noexcept override {
+      mSink.registerBuffers(aBuffers, aCount);
+    }
+
+    /// Hands the data over to the sink.
+    virtual void transmit(const char * const aBuffer, LogSizeType const aLength, std::atomic<bool> *aProgressFlag) noexcept override {
+      LogBufferSlice slice { aBuffer, aLength };
+      mSink.write(&slice, 1u, aProgressFlag);
+    }
+
+    virtual LogSizeType getGatherLimit() const noexcept override {
+      return mSink.getGatherLimit();
+    }
+
+    /// Hands all the buffers over to the sink at once.
+    virtual void transmitGathered(LogBufferSlice const * const aSlices, LogSizeType const aCount, std::atomic<bool> *aProgressFlag) noexcept override {
+      mSink.write(aSlices, aCount, aProgressFlag);
+    }
+
+    /// Sets the deadline after which a partially filled buffer should be sent.
+    virtual void startRefreshTimer(std::atomic<bool> *aRefreshFlag) noexcept override {
+      mRefreshNeeded = aRefreshFlag;
+      mRefreshDeadline = getLogTimeNs() + static_cast<uint64_t>(mRefreshPeriod) * 1000000u;
+    }
+
+    virtual void lock() noexcept override {
+      pthread_mutex_lock(&mApiMutex);
+    }
+
+    virtual void unlock() noexcept override {
+      pthread_mutex_unlock(&mApiMutex);
+    }
+
+    virtual uint32_t getTransmitErrorCount() const noexcept override {
+      return mSink.getErrorCount();
+    }
+
+    virtual uint32_t getLastTransmitError() const noexcept override {
+      return mSink.getLastError();
+    }
+
+    /// A producer of a LogShmRing has none, its collector transmits.
+    virtual bool hasTransmitterThread() const noexcept override {
+      return mShmRing == nullptr || mShmRing->isCollector();
+    }
+
+    virtual void sleep(uint32_t const aMs) noexcept override;
+
+  private:
+
+    void initClock(Clock const aClock) noexcept;
+
+    void initMutex() noexcept;
+
+    static void *threadFunction(void *aThis) noexcept;
+  };
+
+} //namespace nowtech
+
+#endif // NOWTECH_LOG_POSIX_INCLUDED
@@ -0,0 +1,171 @@
+//
+// Copyright 2018 Now Technologies Zrt.
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge,
+// publish, distribute, sublicense, and/or sell copies of the Software,
+// and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#include "LogRotatingFileSink.h"
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+nowtech::LogRotatingFileSink::LogRotatingFileSink(char const * const aPath, uint64_t const aMaxBytes, uint32_t const aPeriod
+  , uint32_t const aRetention, uint32_t const aSyncBytes, uint32_t const aSyncPeriod) noexcept
+  : LogFdSink(-1, aSyncBytes, aSyncPeriod)
+  , mMaxBytes(aMaxBytes)
+  , mPeriod(static_cast<uint64_t>(aPeriod) * 1000u)
+  , mRetention(aRetention)
+  , mFileBytes(0u)
+  , mOpened(0u) {
+  std::strncpy(mPath, aPath, cMaxPathLength - 1u);
+  mPath[cMaxPathLength - 1u] = 0;
+  open();
+}
+
+nowtech::LogRotatingFileSink::~LogRotatingFileSink() noexcept {
+  sync();
+  if(mFd >= 0) {
+    close(mFd);
+  }
+  else { // nothing to do
+  }
+}
+
+void nowtech::LogRotatingFileSink::write(LogBufferSlice const * const aSlices, LogSizeType const aCount, std::atomic<bool> *aProgressFlag) noexcept {
+  LogSizeType splitSlice = aCount;
+  LogSizeType splitOffset = 0u;
+  if(isRotationDue()) {
+    for(LogSizeType i = 0u; splitSlice == aCount && i < aCount; ++i) {
+      void const * const end = std::memchr(aSlices[i].buffer, '\n', aSlices[i].length);
+      if(end != nullptr) {
+        splitSlice = i;
+        splitOffset = static_cast<LogSizeType>(static_cast<char const*>(end) - aSlices[i].buffer) + 1u;
+      }
+      else { // nothing to do
+      }
+    }
+  }
+  else { // nothing to do
+  }
+  std::atomic<bool> dummy;
+  LogBufferSlice slices[cMaxGather];
+  LogSizeType count = 0u;
+  uint64_t bytes = 0u;
+  for(LogSizeType i = 0u; i < aCount; ++i) {
+    if(i == splitSlice) {
+      slices[count] = LogBufferSlice { aSlices[i].buffer, splitOffset };
+      ++count;
+      LogFdSink::write(slices, count, &dummy);
+      mFileBytes += bytes + splitOffset;
+      rotate();
+      count = 0u;
+      bytes = 0u;
+      if(splitOffset < aSlices[i].length) {
+        slices[count] = LogBufferSlice { aSlices[i].buffer + splitOffset, aSlices[i].length - splitOffset };
+        bytes += slices[count].length;
+        ++count;
+      }
+      else { // nothing to do
+      }
+    }
+    else {
+      slices[count] = aSlices[i];
+      bytes += aSlices[i].length;
+      ++count;
+    }
+  }
+  if(count > 0u) {
+    LogFdSink::write(slices, count, &dummy);
+    mFileBytes += bytes;
+  }
+  else { // nothing to do
+  }
+  aProgressFlag->store(false);
+}
+
+bool nowtech::LogRotatingFileSink::isRotationDue() const noexcept {
+  return (mMaxBytes > 0u && mFileBytes >= mMaxBytes) || (mPeriod > 0u && now() - mOpened >= mPeriod);
+}
+
+void nowtech::LogRotatingFileSink::rotate() noexcept {
+  char from[cMaxPathLength + cMaxSuffixLength];
+  char to[cMaxPathLength + cMaxSuffixLength];
+  // The next file is created first under a temporary name, so nothing is
+  // renamed if it fails.
+  char next[cMaxPathLength + cMaxSuffixLength];
+  std::snprintf(next, sizeof(next), "%s.new", mPath);
+  int const nextFd = ::open(next, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0644);
+  if(nextFd >= 0) {
+    uint32_t last = 1u;
+    if(mRetention > 0u) {
+      makePath(from, mRetention);
+      unlink(from);
+      last = mRetention;
+    }
+    else {
+      struct stat status;
+      makePath(from, last);
+      while(stat(from, &status) == 0) {
+        ++last;
+        makePath(from, last);
+      }
+    }
+    for(uint32_t i = last; i > 1u; --i) {
+      makePath(from, i - 1u);
+      makePath(to, i);
+      rename(from, to);
+    }
+    makePath(to, 1u);
+    rename(mPath, to);
+    rename(next, mPath);
+    sync();
+    if(mFd >= 0) {
+      close(mFd);
+    }
+    else { // nothing to do
+    }
+    mFd = nextFd;
+  }
+  else {
+    // Retried only after another period or size limit.
+    reportError(static_cast<uint32_t>(errno));
+  }
+  mFileBytes = 0u;
+  mOpened = now();
+}
+
+void nowtech::LogRotatingFileSink::open() noexcept {
+  mFd = ::open(mPath, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+  if(mFd >= 0) {
+    struct stat status;
+    mFileBytes = fstat(mFd, &status) == 0 ? static_cast<uint64_t>(status.st_size) : 0u;
+  }
+  else {
+    reportError(static_cast<uint32_t>(errno));
+  }
+  mOpened = now();
+}
+
+void nowtech::LogRotatingFileSink::makePath(char * const aDestination, uint32_t const aIndex) const noexcept {
+  std::snprintf(aDestination, cMaxPathLength + cMaxSuffixLength, "%s.%u", mPath, static_cast<unsigned>(aIndex));
+}
@@ -0,0 +1,82 @@
+/*
+ * Copyright 2018 Now Technologies Zrt.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+ * THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef NOWTECH_LOG_ROTATING_FILE_SINK_INCLUDED
+#define NOWTECH_LOG_ROTATING_FILE_SINK_INCLUDED
+
+#include "LogFdSink.h"
+#include <cstdint>
+
+namespace nowtech {
+
+  /// File sink rotating its file by size and/or time. The current file is
+  /// aPath, the previous ones are aPath.1, aPath.2 and so on, the greater the
+  /// older. Rotation happens in the transmitter thread, so the logging tasks
+  /// never wait for it, at most the queue fills up meanwhile. The file is
+  /// switched right after a line end, so lines are never split between files.
+  /// If the next file can not be created, writing continues in the old one,
+  /// and rotation is retried after another period or size limit.
+  class LogRotatingFileSink final : public LogFdSink {
+  public:
+    /// Maximum length of the file path.
+    static constexpr uint32_t cMaxPathLength = 256u;
+
+    /// Maximum length of the .new or .number suffix.
+    static constexpr uint32_t cMaxSuffixLength = 12u;
+
+  private:
+    char            mPath[cMaxPathLength];
+    uint64_t const  mMaxBytes;
+    uint64_t const  mPeriod;
+    uint32_t const  mRetention;
+    uint64_t        mFileBytes;
+    uint64_t        mOpened;
+
+  public:
+    /// @param aPath path of the current file, which is appended if exists.
+    /// @param aMaxBytes rotate when the file reaches this size, 0 to disable.
+    /// @param aPeriod rotate after this many seconds, 0 to disable.
+    /// @param aRetention number of previous files to keep, 0 to keep all.
+    /// @param aSyncBytes see LogFdSink.
+    /// @param aSyncPeriod see LogFdSink.
+    LogRotatingFileSink(char const * const aPath, uint64_t const aMaxBytes, uint32_t const aPeriod = 0u
+      , uint32_t const aRetention = 0u, uint32_t const aSyncBytes = 0u, uint32_t const aSyncPeriod = 0u) noexcept;
+
+    virtual ~LogRotatingFileSink() noexcept;
+
+    virtual void write(LogBufferSlice const * const aSlices, LogSizeType const aCount, std::atomic<bool> *aProgressFlag) noexcept override;
+
+  private:
+    bool isRotationDue() const noexcept;
+
+    /// Creates the next file, shifts the previous ones and renames the current.
+    void rotate() noexcept;
+
+    void open() noexcept;
+
+    void makePath(char * const aDestination, uint32_t const aIndex) const noexcept;
+  };
+
+} //namespace nowtech
+
+#endif // NOWTECH_LOG_ROTATING_FILE_SINK_INCLUDED
@@ -0,0 +1,280 @@
+//
+// Copyright 2018 Now Technologies Zrt.
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge,
+// publish, distribute, sublicense, and/or sell copies of the Software,
+// and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#include "LogShmRing.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <signal.h>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <new>
+
+constexpr uint32_t nowtech::LogShmRing::cMaxProducers;
+constexpr uint32_t nowtech::LogShmRing::cMagic;
+constexpr uint32_t nowtech::LogShmRing::cVersion;
+constexpr size_t nowtech::LogShmRing::cHeaderSize;
+constexpr uint32_t nowtech::LogShmRing::cTaskIdCount;
+constexpr nowtech::TaskIdType nowtech::LogShmRing::cDroppedTaskId;
+
+nowtech::LogShmRing::LogShmRing(char const * const aName, Role const aRole, LogConfig const &aConfig) noexcept
+  : mRole(aRole)
+  , mChunkSize(aConfig.chunkSize)
+  , mElementSize(aConfig.chunkSize + 1u) {
+  mDroppedMessages.store(0u);
+  bool created = false;
+  int fd = -1;
+  if(aRole == Role::cCollector) {
+    fd = shm_open(aName, O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0660);
+    created = fd >= 0;
+    mTaskIds = new TaskIdType[cMaxProducers * cTaskIdCount]();
+  }
+  else { // nothing to do
+  }
+  if(fd < 0) {
+    fd = shm_open(aName, O_RDWR | O_CLOEXEC, 0);
+  }
+  else { // nothing to do
+  }
+  struct stat status;
+  if(fd < 0 || fstat(fd, &status) != 0) {
+    mError = errno;
+  }
+  else if(created || (aRole == Role::cCollector && status.st_size == 0)) {
+    // A collector died before completing the header, or we create it now.
+    size_t const size = cHeaderSize + LogMpscRing::getMemorySize(aConfig.queueLength, mElementSize);
+    if(ftruncate(fd, static_cast<off_t>(size)) != 0) {
+      mError = errno;
+    }
+    else if(map(fd, size, true, aConfig)) {
+      mHeader->magic.store(cMagic, std::memory_order_release);
+    }
+    else { // nothing to do
+    }
+  }
+  else if(static_cast<size_t>(status.st_size) < cHeaderSize) {
+    mError = EPROTO;
+  }
+  else {
+    map(fd, static_cast<size_t>(status.st_size), false, aConfig);
+  }
+  if(fd >= 0) {
+    close(fd);
+  }
+  else { // nothing to do
+  }
+  if(mQueue != nullptr) {
+    attach();
+  }
+  else { // nothing to do
+  }
+}
+
+nowtech::LogShmRing::~LogShmRing() noexcept {
+  if(mProducerIndex < cMaxProducers) {
+    mHeader->producers[mProducerIndex].store(0u);
+  }
+  else { // nothing to do
+  }
+  delete mQueue;
+  if(mMemory != nullptr) {
+    munmap(mMemory, mMemorySize);
+  }
+  else { // nothing to do
+  }
+  delete[] mTaskIds;
+}
+
+bool nowtech::LogShmRing::push(char const * const aChunkStart, bool const aBlocks) noexcept {
+  bool result;
+  if(isAttached()) {
+    char element[mElementSize];
+    element[0] = static_cast<char>(mProducerIndex);
+    std::memcpy(element + 1u, aChunkStart, mChunkSize);
+    result = mQueue->send(element, aBlocks);
+  }
+  else {
+    result = false;
+  }
+  return result;
+}
+
+bool nowtech::LogShmRing::pop(char * const aChunkStart, uint64_t const aTimeout) noexcept {
+  bool result;
+  if(mQueue != nullptr) {
+    char element[mElementSize];
+    result = mQueue->receive(element, aTimeout);
+    if(result) {
+      std::memcpy(aChunkStart, element + 1u, mChunkSize);
+      *reinterpret_cast<TaskIdType*>(aChunkStart) = mapTaskId(static_cast<uint8_t>(element[0]) % cMaxProducers, aChunkStart);
+    }
+    else { // nothing to do
+    }
+  }
+  else {
+    timespec duration;
+    duration.tv_sec = static_cast<time_t>(aTimeout / 1000000000u);
+    duration.tv_nsec = static_cast<long>(aTimeout % 1000000000u);
+    nanosleep(&duration, nullptr);
+    result = false;
+  }
+  return result;
+}
+
+bool nowtech::LogShmRing::remove(char const * const aName) noexcept {
+  return shm_unlink(aName) == 0;
+}
+
+bool nowtech::LogShmRing::map(int const aFd, size_t const aSize, bool const aInitialize, LogConfig const &aConfig) noexcept {
+  void * const memory = mmap(nullptr, aSize, PROT_READ | PROT_WRITE, MAP_SHARED, aFd, 0);
+  if(memory != MAP_FAILED) {
+    mMemory = memory;
+    mMemorySize = aSize;
+    mHeader = static_cast<Header*>(memory);
+    if(aInitialize) {
+      new(&mHeader->magic) std::atomic<uint32_t>(0u);
+      mHeader->version = cVersion;
+      mHeader->elementSize = mElementSize;
+      mHeader->slotCount = static_cast<uint32_t>(aConfig.queueLength);
+      for(uint32_t i = 0u; i < cMaxProducers; ++i) {
+        new(&mHeader->producers[i]) std::atomic<uint32_t>(0u);
+      }
+    }
+    else { // nothing to do
+    }
+    if(!aInitialize && mHeader->magic.load(std::memory_order_acquire) != cMagic) {
+      // Not yet or never completed by a collector.
+      mError = EPROTO;
+    }
+    else if(mHeader->version != cVersion || mHeader->elementSize != mElementSize
+      || aSize != cHeaderSize + LogMpscRing::getMemorySize(mHeader->slotCount, mElementSize)) {
+      mError = EPROTO;
+    }
+    else {
+      mQueue = new LogFutexQueue(static_cast<char*>(memory) + cHeaderSize, mHeader->queue, aInitialize, mHeader->slotCount, mElementSize, aConfig);
+    }
+  }
+  else {
+    mError = errno;
+  }
+  return mQueue != nullptr;
+}
+
+void nowtech::LogShmRing::attach() noexcept {
+  uint32_t const pid = static_cast<uint32_t>(getpid());
+  for(uint32_t i = 0u; i < cMaxProducers && mProducerIndex == cMaxProducers; ++i) {
+    uint32_t owner = mHeader->producers[i].load();
+    // An entry of a dead process is taken over.
+    if((owner == 0u || (kill(static_cast<pid_t>(owner), 0) != 0 && errno == ESRCH))
+      && mHeader->producers[i].compare_exchange_strong(owner, pid)) {
+      mProducerIndex = i;
+    }
+    else { // nothing to do
+    }
+  }
+  if(mProducerIndex == cMaxProducers) {
+    mError = EUSERS;
+  }
+  else { // nothing to do
+  }
+}
+
+nowtech::TaskIdType nowtech::LogShmRing::mapTaskId(uint8_t const aProducer, char const * const aChunkStart) noexcept {
+  TaskIdType const taskId = *reinterpret_cast<TaskIdType const*>(aChunkStart);
+  TaskIdType result = Chunk::cInvalidTaskId;
+  if(taskId != Chunk::cInvalidTaskId) {
+    uint32_t const pid = mHeader->producers[aProducer].load(std::memory_order_relaxed);
+    if(pid != 0u && pid != mProducerPids[aProducer]) {
+      // A new process uses this index, its task IDs mean other tasks, and
+      // the unfinished messages of the old one will never finish.
+      mProducerPids[aProducer] = pid;
+      std::memset(mTaskIds + aProducer * cTaskIdCount, Chunk::cInvalidTaskId, cTaskIdCount);
+      for(uint32_t i = 1u; i < cDroppedTaskId; ++i) {
+        if(mMappings[i].producer == aProducer) {
+          mMappings[i].open = false;
+        }
+        else { // nothing to do
+        }
+      }
+    }
+    else { // nothing to do
+    }
+    TaskIdType &entry = mTaskIds[aProducer * cTaskIdCount + taskId];
+    bool terminal = aChunkStart[1] == Chunk::cAbortMessage || aChunkStart[1] == Chunk::cFlushMarker || aChunkStart[1] == Chunk::cSingleChunk;
+    for(LogSizeType i = 1u; !terminal && i < mChunkSize; ++i) {
+      terminal = aChunkStart[i] == Chunk::cEndOfMessage;
+    }
+    if(entry == cDroppedTaskId) {
+      entry = terminal ? Chunk::cInvalidTaskId : cDroppedTaskId;
+    }
+    else {
+      if(entry == Chunk::cInvalidTaskId || mMappings[entry].producer != aProducer || mMappings[entry].taskId != taskId) {
+        // Here starts a message, since open mappings are never reused.
+        entry = allocateTaskId();
+        if(entry != Chunk::cInvalidTaskId) {
+          mMappings[entry].producer = aProducer;
+          mMappings[entry].taskId = taskId;
+        }
+        else {
+          mDroppedMessages.fetch_add(1u);
+          entry = terminal ? Chunk::cInvalidTaskId : cDroppedTaskId;
+        }
+      }
+      else { // nothing to do
+      }
+      if(entry != Chunk::cInvalidTaskId && entry != cDroppedTaskId) {
+        mMappings[entry].open = !terminal;
+        mMappings[entry].lastUse = ++mUseCounter;
+        result = entry;
+      }
+      else { // nothing to do
+      }
+    }
+  }
+  else { // nothing to do
+  }
+  return result;
+}
+
+nowtech::TaskIdType nowtech::LogShmRing::allocateTaskId() noexcept {
+  TaskIdType result = Chunk::cInvalidTaskId;
+  if(mNextFreeTaskId != cDroppedTaskId) {
+    result = mNextFreeTaskId;
+    ++mNextFreeTaskId;
+  }
+  else {
+    // The least recently used one without open message, if any.
+    uint64_t oldest = UINT64_MAX;
+    for(TaskIdType i = 1u; i < cDroppedTaskId; ++i) {
+      if(!mMappings[i].open && mMappings[i].lastUse < oldest) {
+        oldest = mMappings[i].lastUse;
+        result = i;
+      }
+      else { // nothing to do
+      }
+    }
+  }
+  return result;
+}
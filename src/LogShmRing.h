@@ -0,0 +1,168 @@
+/*
+ * Copyright 2018 Now Technologies Zrt.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+ * THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef NOWTECH_LOG_SHM_RING_INCLUDED
+#define NOWTECH_LOG_SHM_RING_INCLUDED
+
+#include "LogFutexQueue.h"
+#include <atomic>
+#include <cstdint>
+
+namespace nowtech {
+
+  /// Named POSIX shared memory segment holding a LogFutexQueue, through which
+  /// several processes send their chunks to a single collector process. The
+  /// collector runs the only transmitter thread and does all the sink writes,
+  /// the producer processes only format and enqueue. Pass the object to the
+  /// LogPosix constructors.
+  /// The collector creates the segment, so it must be started first. A
+  /// restarted collector continues the existing segment, so the producers
+  /// need not be restarted. Remove it by remove() when no longer needed.
+  /// Each attached process gets a producer index, which travels with its
+  /// chunks. The collector maps each (producer index, task ID) pair to its own
+  /// task ID, so the usual de-interleaving works across processes. There are
+  /// at most 254 such IDs at a time, beyond that the least recently used
+  /// one without unfinished message is reused. If all have one, the new
+  /// message is dropped. Use the task name representation to tell the tasks
+  /// apart in the output.
+  /// The processes must agree on LogConfig::chunkSize and the ABI.
+  /// A process killed right in the middle of a push stalls the ring.
+  class LogShmRing final : public BanCopyMove {
+  public:
+    enum class Role : uint8_t {
+      cProducer,
+      cCollector
+    };
+
+    /// Maximum number of processes attached at the same time.
+    static constexpr uint32_t cMaxProducers = 64u;
+
+    static constexpr uint32_t cMagic = 0x52474f4cu; // LOGR
+    static constexpr uint32_t cVersion = 1u;
+
+  private:
+    /// At the start of the segment, followed by the ring.
+    struct Header {
+      /// Stored last by the collector, so producers see a complete header.
+      std::atomic<uint32_t> magic;
+      uint32_t version;
+      uint32_t elementSize;
+      uint32_t slotCount;
+      LogFutexQueue::Shared queue;
+      /// PIDs of the attached processes, 0 for free entries.
+      std::atomic<uint32_t> producers[cMaxProducers];
+    };
+
+    static constexpr size_t cHeaderSize = (sizeof(Header) + LogMpscRing::cCacheLineSize - 1u) / LogMpscRing::cCacheLineSize * LogMpscRing::cCacheLineSize;
+    static constexpr uint32_t cTaskIdCount = std::numeric_limits<TaskIdType>::max() + 1u;
+    /// Never a collector task ID, marks a message being dropped in mTaskIds.
+    static constexpr TaskIdType cDroppedTaskId = Chunk::cIsrTaskId;
+
+    /// Collector side of a collector task ID.
+    struct Mapping {
+      uint8_t    producer;
+      TaskIdType taskId;
+      /// True while the last chunk seen did not end the message.
+      bool       open;
+      uint64_t   lastUse;
+    };
+
+    Role const        mRole;
+    LogSizeType const mChunkSize;
+    /// Producer index and chunk.
+    LogSizeType const mElementSize;
+    void             *mMemory = nullptr;
+    size_t            mMemorySize = 0u;
+    Header           *mHeader = nullptr;
+    LogFutexQueue    *mQueue = nullptr;
+    uint32_t          mProducerIndex = cMaxProducers;
+    int               mError = 0;
+
+    /// Collector task IDs indexed by producer index and task ID, valid only
+    /// if the mapping still refers back.
+    TaskIdType       *mTaskIds = nullptr;
+    /// Last seen PIDs, to forget the mappings of a reused producer index.
+    uint32_t          mProducerPids[cMaxProducers] = {};
+    Mapping           mMappings[cTaskIdCount] = {};
+    TaskIdType        mNextFreeTaskId = 1u;
+    uint64_t          mUseCounter = 0u;
+    std::atomic<uint32_t> mDroppedMessages;
+
+  public:
+    /// Creates or opens the segment as collector, or opens it as producer.
+    /// Failures can be queried by getError(), in which case the chunks pushed
+    /// are counted as dropped.
+    /// @param aName segment name like /myapplog, see shm_open.
+    /// @param aConfig chunkSize gives the element size, and for a new segment
+    /// queueLength gives the slot count.
+    LogShmRing(char const * const aName, Role const aRole, LogConfig const &aConfig) noexcept;
+
+    /// Frees the producer index, but leaves the segment in place.
+    ~LogShmRing() noexcept;
+
+    bool isCollector() const noexcept {
+      return mRole == Role::cCollector;
+    }
+
+    bool isAttached() const noexcept {
+      return mQueue != nullptr && mProducerIndex < cMaxProducers;
+    }
+
+    /// @return the errno of the failed setup step, or EPROTO for an
+    /// incompatible segment, 0 if all went well.
+    int getError() const noexcept {
+      return mError;
+    }
+
+    /// Enqueues the chunk tagged with the producer index.
+    bool push(char const * const aChunkStart, bool const aBlocks) noexcept;
+
+    /// Dequeues a chunk from any producer and replaces its task ID with the
+    /// collector one. Must be called only from the collector.
+    bool pop(char * const aChunkStart, uint64_t const aTimeout) noexcept;
+
+    /// @return the number of messages the collector dropped for lack of task IDs.
+    uint32_t getDroppedMessages() const noexcept {
+      return mDroppedMessages.load();
+    }
+
+    /// Removes the segment name, the processes using it keep it until exit.
+    static bool remove(char const * const aName) noexcept;
+
+  private:
+    /// Maps the segment and places the queue in it.
+    bool map(int const aFd, size_t const aSize, bool const aInitialize, LogConfig const &aConfig) noexcept;
+
+    void attach() noexcept;
+
+    /// @return the collector task ID for the chunk, or Chunk::cInvalidTaskId
+    /// to drop it.
+    TaskIdType mapTaskId(uint8_t const aProducer, char const * const aChunkStart) noexcept;
+
+    /// @return a free or reusable collector task ID, or Chunk::cInvalidTaskId.
+    TaskIdType allocateTaskId() noexcept;
+  };
+
+} //namespace nowtech
+
+#endif // NOWTECH_LOG_SHM_RING_INCLUDED
@@ -0,0 +1,392 @@
+/*
+ * Copyright 2018 Now Technologies Zrt.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+ * THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef NOWTECH_LOG_SINK_INCLUDED
+#define NOWTECH_LOG_SINK_INCLUDED
+
+#include "Log.h"
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <thread>
+
+namespace nowtech {
+
+  /// Abstract base class for destinations the transmission buffers can be
+  /// written to, independent of the OsInterface which drives them. All the
+  /// functions are called from the transmitter thread only.
+  class LogSink : public BanCopyMove {
+  private:
+    std::atomic<uint32_t> mErrorCount;
+    std::atomic<uint32_t> mLastError;
+
+  public:
+    LogSink() noexcept {
+      mErrorCount.store(0u);
+      mLastError.store(0u);
+    }
+
+    virtual ~LogSink() = default;
+
+    /// @return the maximum number of buffers write() accepts in one call.
+    virtual LogSizeType getGatherLimit() const noexcept {
+      return 1u;
+    }
+
+    /// Writes the buffers, and clears the progress flag when they can be
+    /// reused. An asynchronous sink may clear it later, in poll().
+    virtual void write(LogBufferSlice const * const aSlices, LogSizeType const aCount, std::atomic<bool> *aProgressFlag) noexcept = 0;
+
+    /// Called by the transmitter thread each time it waits for chunks, at
+    /// least once in every LogConfig::pauseLength, to let the sink finish
+    /// pending work like synchronization or completions.
+    virtual void poll() noexcept {
+    }
+
+    /// Called once with the whole transmission buffers before any write.
+    virtual void registerBuffers(LogBufferSlice const * const, LogSizeType const) noexcept {
+    }
+
+    /// Called when the transmitter has to wait for the progress flag to clear.
+    /// @return true if the sink waited for its pending work itself, false if
+    /// the caller should sleep instead.
+    virtual bool waitForCompletion() noexcept {
+      return false;
+    }
+
+    /// @return the number of failed writes so far. Sinks forwarding to
+    /// others include their errors.
+    virtual uint32_t getErrorCount() const noexcept {
+      return mErrorCount.load();
+    }
+
+    /// @return the OS-specific code, like errno, of the last failed write.
+    virtual uint32_t getLastError() const noexcept {
+      return mLastError.load();
+    }
+
+    /// Writes the slices to aSink and waits until it clears aProgressFlag,
+    /// for the code writing a sink on its own instead of the transmitter.
+    static void writeAndWait(LogSink &aSink, LogBufferSlice const * const aSlices, LogSizeType const aCount, std::atomic<bool> &aProgressFlag) noexcept {
+      aProgressFlag.store(true);
+      aSink.write(aSlices, aCount, &aProgressFlag);
+      while(aProgressFlag.load()) {
+        if(!aSink.waitForCompletion()) {
+          std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        else { // nothing to do
+        }
+        aSink.poll();
+      }
+    }
+
+  protected:
+    void reportError(uint32_t const aError) noexcept {
+      mLastError.store(aError);
+      mErrorCount.fetch_add(1u);
+    }
+  };
+
+  /// Base of the sinks transforming the stream into their own output buffers
+  /// and passing these to the next sink. The polling, the waiting and the
+  /// errors of the next sink are forwarded.
+  class LogDecoratorSink : public LogSink {
+  public:
+    /// Maximum number of output buffers, and so of buffers in a write call.
+    static constexpr LogSizeType cMaxGather = 64u;
+
+  protected:
+    LogSink          &mNext;
+    LogSizeType const mGatherLimit;
+    char             *mOutputs[cMaxGather] = {};
+
+    /// Length of each output buffer, 0 until registerBuffers() is called.
+    LogSizeType       mOutputLength = 0u;
+    LogBufferSlice    mSlices[cMaxGather];
+
+  private:
+    /// Progress flag of the last write passed to the next sink.
+    std::atomic<bool> *mPendingFlag = nullptr;
+    std::atomic<bool>  mProgress;
+
+  public:
+    /// @param aNext the sink receiving the output, not owned.
+    LogDecoratorSink(LogSink &aNext) noexcept
+      : mNext(aNext)
+      , mGatherLimit(aNext.getGatherLimit() < cMaxGather ? aNext.getGatherLimit() : cMaxGather) {
+      mProgress.store(false);
+    }
+
+    virtual ~LogDecoratorSink() noexcept {
+      for(LogSizeType i = 0u; i < mGatherLimit; ++i) {
+        delete[] mOutputs[i];
+      }
+    }
+
+    virtual LogSizeType getGatherLimit() const noexcept override {
+      return mGatherLimit;
+    }
+
+    /// Allocates the output buffers, and registers them in the next sink.
+    virtual void registerBuffers(LogBufferSlice const * const aBuffers, LogSizeType const aCount) noexcept override {
+      LogSizeType inputLength = 0u;
+      for(LogSizeType i = 0u; i < aCount; ++i) {
+        inputLength = aBuffers[i].length > inputLength ? aBuffers[i].length : inputLength;
+      }
+      mOutputLength = getOutputLength(inputLength);
+      for(LogSizeType i = 0u; i < mGatherLimit; ++i) {
+        mOutputs[i] = new char[mOutputLength];
+        mSlices[i].buffer = mOutputs[i];
+        mSlices[i].length = mOutputLength;
+      }
+      mNext.registerBuffers(mSlices, mGatherLimit);
+    }
+
+    virtual void poll() noexcept override {
+      mNext.poll();
+    }
+
+    virtual bool waitForCompletion() noexcept override {
+      return mNext.waitForCompletion();
+    }
+
+    virtual uint32_t getErrorCount() const noexcept override {
+      return LogSink::getErrorCount() + mNext.getErrorCount();
+    }
+
+    /// @return the own last error if there is one, otherwise the one of the next sink.
+    virtual uint32_t getLastError() const noexcept override {
+      uint32_t const own = LogSink::getLastError();
+      return own != 0u ? own : mNext.getLastError();
+    }
+
+  protected:
+    /// @return the length of an output buffer for input buffers of at most aInputLength.
+    virtual LogSizeType getOutputLength(LogSizeType const aInputLength) const noexcept {
+      return aInputLength;
+    }
+
+    /// @return true if registerBuffers() was called. Otherwise there is
+    /// nowhere to write, so reports EINVAL and clears aProgressFlag.
+    bool checkOutputs(std::atomic<bool> *aProgressFlag) noexcept {
+      bool const result = mOutputLength > 0u;
+      if(!result) {
+        reportError(EINVAL);
+        aProgressFlag->store(false);
+      }
+      else { // nothing to do
+      }
+      return result;
+    }
+
+    /// Passes the slices of a write call to the next sink, which clears
+    /// aProgressFlag, or clears it if aCount is 0.
+    void passOn(LogBufferSlice const * const aSlices, LogSizeType const aCount, std::atomic<bool> *aProgressFlag) noexcept {
+      if(aCount > 0u) {
+        mPendingFlag = aProgressFlag;
+        mNext.write(aSlices, aCount, aProgressFlag);
+      }
+      else {
+        mPendingFlag = nullptr;
+        aProgressFlag->store(false);
+      }
+    }
+
+    /// Writes the slices to the next sink outside of a write call, and waits for it.
+    void forward(LogBufferSlice const * const aSlices, LogSizeType const aCount) noexcept {
+      writeAndWait(mNext, aSlices, aCount, mProgress);
+      mPendingFlag = nullptr;
+    }
+
+    /// @return true if the next sink may still use the output buffers.
+    bool isNextBusy() const noexcept {
+      return mPendingFlag != nullptr && mPendingFlag->load();
+    }
+  };
+
+  /// Set of topics for sinks filtering by the tags of
+  /// LogConfig::emitTopicTags. LogTopicInstance::cInvalidTopic stands for the
+  /// messages without topic, including the ones of the transmitter.
+  class LogTopicMask final {
+  private:
+    static constexpr uint32_t cBitsPerWord = 32u;
+
+    uint32_t mBits[(std::numeric_limits<LogTopicType>::max() + 1u) / cBitsPerWord] = {};
+
+  public:
+    static LogTopicMask all() noexcept {
+      LogTopicMask result;
+      for(auto &word : result.mBits) {
+        word = std::numeric_limits<uint32_t>::max();
+      }
+      return result;
+    }
+
+    LogTopicMask &add(LogTopicType const aTopic) noexcept {
+      mBits[aTopic / cBitsPerWord] |= 1u << (aTopic % cBitsPerWord);
+      return *this;
+    }
+
+    LogTopicMask &remove(LogTopicType const aTopic) noexcept {
+      mBits[aTopic / cBitsPerWord] &= ~(1u << (aTopic % cBitsPerWord));
+      return *this;
+    }
+
+    bool contains(LogTopicType const aTopic) const noexcept {
+      return (mBits[aTopic / cBitsPerWord] & (1u << (aTopic % cBitsPerWord))) != 0u;
+    }
+  };
+
+  /// Splits the transmitted stream into message parts, and removes the topic
+  /// tags of LogConfig::emitTopicTags, and the sequence tags of
+  /// LogConfig::emitSequenceTags if no LogOrderingSink did. The parts keep
+  /// the Log::cLineBreakTag bytes, see forEachPiece(). Keeps its state
+  /// between the buffers, as a message may continue in the next one.
+  class LogMessageParser final {
+  private:
+    bool         mAtMessageStart = true;
+    /// True if the last byte seen was Log::cLineBreakTag.
+    bool         mLineBreakTagged = false;
+    /// True if a part of the message body was already found.
+    bool         mInBody = false;
+    /// True if the topic tag may still come.
+    bool         mTopicTagPossible = false;
+    LogSizeType  mSequenceDigitsLeft = 0u;
+    LogSizeType  mTagDigitsLeft = 0u;
+    LogTopicType mTopic = LogTopicInstance::cInvalidTopic;
+
+  public:
+    /// Finds the line end closing the message in [aData, aEnd), skipping the
+    /// ones inside the message, which follow Log::cLineBreakTag.
+    /// @param aTagged true if the byte before aData was Log::cLineBreakTag,
+    /// updated for aEnd.
+    /// @return the line end, or nullptr if the message goes on.
+    static char const *findMessageEnd(char const *aData, char const * const aEnd, bool &aTagged) noexcept {
+      char const *result = nullptr;
+      while(result == nullptr && aData < aEnd) {
+        char const * const lineEnd = static_cast<char const*>(std::memchr(aData, Chunk::cEndOfLine, static_cast<size_t>(aEnd - aData)));
+        if(lineEnd == nullptr) {
+          aTagged = *(aEnd - 1) == Log::cLineBreakTag;
+          aData = aEnd;
+        }
+        else if(lineEnd == aData ? aTagged : *(lineEnd - 1) == Log::cLineBreakTag) {
+          aTagged = false;
+          aData = lineEnd + 1;
+        }
+        else {
+          aTagged = false;
+          result = lineEnd;
+        }
+      }
+      return result;
+    }
+
+    /// Calls aConsumer(char const*, LogSizeType) with the pieces of a part
+    /// between its Log::cLineBreakTag bytes, for the sinks removing the tags.
+    template<typename tConsumer>
+    static void forEachPiece(char const *aPart, LogSizeType aLength, tConsumer &&aConsumer) noexcept {
+      while(aLength > 0u) {
+        char const * const tag = static_cast<char const*>(std::memchr(aPart, Log::cLineBreakTag, aLength));
+        LogSizeType const length = tag == nullptr ? aLength : static_cast<LogSizeType>(tag - aPart);
+        if(length > 0u) {
+          aConsumer(aPart, length);
+        }
+        else { // nothing to do
+        }
+        LogSizeType const skipped = tag == nullptr ? length : length + 1u;
+        aPart += skipped;
+        aLength -= skipped;
+      }
+    }
+
+    /// @return the topic of the current message.
+    LogTopicType getTopic() const noexcept {
+      return mTopic;
+    }
+
+    /// Consumes the next message part from aData, skipping the tags if
+    /// there are any.
+    /// @param aPart receives the start of the part.
+    /// @param aMessageStart set if the part starts a message.
+    /// @param aMessageEnd set if the part ends with the line end closing the message.
+    /// @return the length of the part, 0 if only a tag was consumed.
+    LogSizeType parse(char const * &aData, char const * const aEnd, char const * &aPart, bool &aMessageStart, bool &aMessageEnd) noexcept {
+      LogSizeType result = 0u;
+      if(mAtMessageStart) {
+        mAtMessageStart = false;
+        mInBody = false;
+        mLineBreakTagged = false;
+        mTopic = LogTopicInstance::cInvalidTopic;
+        mTopicTagPossible = true;
+        if(*aData == Log::cSequenceTag) {
+          mSequenceDigitsLeft = Log::cSequenceTagLength - 1u;
+          ++aData;
+        }
+        else { // nothing to do
+        }
+      }
+      else { // nothing to do
+      }
+      while(aData < aEnd && mSequenceDigitsLeft > 0u) {
+        ++aData;
+        --mSequenceDigitsLeft;
+      }
+      if(aData < aEnd && mTopicTagPossible) {
+        mTopicTagPossible = false;
+        if(*aData == Log::cTopicTag) {
+          mTagDigitsLeft = Log::cTopicTagLength - 1u;
+          ++aData;
+        }
+        else { // nothing to do
+        }
+      }
+      else { // nothing to do
+      }
+      while(aData < aEnd && mTagDigitsLeft > 0u) {
+        char const digit = *aData;
+        mTopic = static_cast<LogTopicType>(mTopic * NumericSystem::cHexadecimal + (digit <= '9' ? digit - '0' : digit - 'a' + 10));
+        ++aData;
+        --mTagDigitsLeft;
+      }
+      if(aData < aEnd) {
+        aPart = aData;
+        char const * const lineEnd = findMessageEnd(aData, aEnd, mLineBreakTagged);
+        aData = lineEnd == nullptr ? aEnd : lineEnd + 1;
+        result = static_cast<LogSizeType>(aData - aPart);
+        aMessageStart = !mInBody;
+        aMessageEnd = lineEnd != nullptr;
+        mInBody = true;
+        mAtMessageStart = aMessageEnd;
+      }
+      else { // nothing to do
+      }
+      return result;
+    }
+  };
+
+} //namespace nowtech
+
+#endif // NOWTECH_LOG_SINK_INCLUDED
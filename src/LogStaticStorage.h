@@ -0,0 +1,82 @@
+/*
+ * Copyright 2018 Now Technologies Zrt.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+ * THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef NOWTECH_LOG_STATIC_STORAGE_INCLUDED
+#define NOWTECH_LOG_STATIC_STORAGE_INCLUDED
+
+#include "Log.h"
+#include "LogMpscRing.h"
+
+namespace nowtech {
+
+  /// LogStorage with arrays sized at compile time. Defined as a static or
+  /// global object, it lets Log, its transmitter thread and the queue work
+  /// without any heap allocation, for builds where the heap is forbidden.
+  /// The queue memory suits the LogMpscRing based queues, like the one of
+  /// LogPosix. Sinks allocating memory in their constructors are not covered.
+  /// The template arguments are the LogConfig fields of the same name, and
+  /// applyTo() copies them into the config to use.
+  template<LogSizeType tChunkSize, LogSizeType tQueueLength, LogSizeType tCircularBufferLength
+    , LogSizeType tTransmitBufferLength, LogSizeType tTransmitBufferCount, bool tAllowShiftChainingCalls = true>
+  class LogStaticStorage final : public LogStorage, public BanCopyMove {
+    static_assert(tChunkSize > 1u, "A chunk needs room for the task ID and some payload.");
+    static_assert(tTransmitBufferCount >= 2u, "TransmitBuffers uses at least 2 buffers.");
+
+    static constexpr LogSizeType cShiftChainingCallBufferSize = tAllowShiftChainingCalls ? getShiftChainingCallBufferSize(tChunkSize) : 1u;
+    static constexpr LogSizeType cTransmitBufferSize          = getTransmitBufferSize(tTransmitBufferLength, tChunkSize);
+
+    char           mShiftChainingCallBuffers[cShiftChainingCallBufferSize];
+    char           mCircularBuffer[tCircularBufferLength * tChunkSize];
+    char           mTransmitBuffers[tTransmitBufferCount * cTransmitBufferSize];
+    char          *mTransmitBufferStarts[tTransmitBufferCount];
+    LogSizeType    mTransmitChunkCounts[tTransmitBufferCount];
+    LogSizeType    mTransmitIndices[tTransmitBufferCount];
+    LogBufferSlice mTransmitSlices[tTransmitBufferCount];
+    alignas(LogMpscRing::cCacheLineSize) char mQueue[LogMpscRing::getMemorySize(tQueueLength, tChunkSize)];
+
+  public:
+    LogStaticStorage() noexcept {
+      shiftChainingCallBuffers = tAllowShiftChainingCalls ? mShiftChainingCallBuffers : nullptr;
+      circularBuffer = mCircularBuffer;
+      transmitBuffers = mTransmitBuffers;
+      transmitBufferStarts = mTransmitBufferStarts;
+      transmitChunkCounts = mTransmitChunkCounts;
+      transmitIndices = mTransmitIndices;
+      transmitSlices = mTransmitSlices;
+      queue = mQueue;
+    }
+
+    /// Sets the buffer sizes of aConfig to the ones of this storage.
+    static void applyTo(LogConfig &aConfig) noexcept {
+      aConfig.chunkSize = tChunkSize;
+      aConfig.queueLength = tQueueLength;
+      aConfig.circularBufferLength = tCircularBufferLength;
+      aConfig.transmitBufferLength = tTransmitBufferLength;
+      aConfig.transmitBufferCount = tTransmitBufferCount;
+      aConfig.allowShiftChainingCalls = tAllowShiftChainingCalls;
+    }
+  };
+
+} // namespace nowtech
+
+#endif // NOWTECH_LOG_STATIC_STORAGE_INCLUDED
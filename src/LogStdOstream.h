@@ -78,17 +78,20 @@ namespace nowtech {
     }
 
     /// Sends the chunk contents immediately.
-    virtual void push(char const * const aChunkStart, bool const) noexcept {
+    virtual bool push(char const * const aChunkStart, bool const) noexcept {
+      LogSizeType const first = aChunkStart[1] == Chunk::cSingleChunk ? 2u : 1u;
       LogSizeType length;
       char buffer[mChunkSize];
-      for(length = 0u; length < mChunkSize - 1u; ++length) {
-        buffer[length] = aChunkStart[length + 1u];
-        if(aChunkStart[length + 1] == '\n') {
+      for(length = 0u; length < mChunkSize - first; ++length) {
+        buffer[length] = aChunkStart[length + first];
+        if(aChunkStart[length + first] == Chunk::cEndOfMessage) {
+          buffer[length] = Chunk::cEndOfLine;
           ++length;
           break;
         }
       }
       mOutput.write(buffer, length);
+      return true;
     }
 
     /// Does nothing.
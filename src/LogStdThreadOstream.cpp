@@ -23,43 +23,92 @@
 
 #include "LogStdThreadOstream.h"
 
-constexpr uint32_t nowtech::LogStdThreadOstream::cEnqueuePollDelay;
-
-void nowtech::LogStdThreadOstream::FreeRtosQueue::send(char const * const aChunkStart, bool const aBlocks) noexcept {
-  bool success;
-  do {
-    char *payload;
-    success = mFreeList.pop(payload);
-    if(success) {
-      std::copy(aChunkStart, aChunkStart + mBlockSize, payload);
-      mQueue.bounded_push(payload); // this should always succeed here
-      mConditionVariable.notify_one();
+bool nowtech::LogStdThreadOstream::FreeRtosQueue::send(char const * const aChunkStart, bool const aBlocks) noexcept {
+  bool success = trySend(aChunkStart);
+  if(!success && aBlocks) {
+    for(uint32_t i = 0u; !success && i < mProducerWait.spinCount; ++i) {
+      LogMpscRing::relax();
+      success = trySend(aChunkStart);
     }
-    else {
-      std::this_thread::sleep_for(std::chrono::milliseconds(cEnqueuePollDelay));
+    for(uint32_t i = 0u; !success && i < mProducerWait.yieldCount; ++i) {
+      std::this_thread::yield();
+      success = trySend(aChunkStart);
+    }
+    if(!success) {
+      auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(mBlockTimeout);
+      std::unique_lock<std::mutex> lock(mProducerMutex);
+      // Incremented before the retry, so the consumer freeing a chunk after
+      // the failed retry will surely see us and notify.
+      mSleepingProducers.fetch_add(1u);
+      success = trySend(aChunkStart);
+      while(!success) {
+        if(mBlockTimeout == 0u) {
+          mProducerCondition.wait(lock);
+        }
+        else if(mProducerCondition.wait_until(lock, deadline) == std::cv_status::timeout) {
+          success = trySend(aChunkStart);
+          break;
+        }
+        else { // nothing to do
+        }
+        success = trySend(aChunkStart);
+      }
+      mSleepingProducers.fetch_sub(1u);
+    }
+    else { // nothing to do
     }
-  } while(aBlocks && !success);
+  }
+  else { // nothing to do
+  }
+  if(success && mConsumerSleeping.load()) {
+    std::lock_guard<std::mutex> lock(mConsumerMutex);
+    mConsumerCondition.notify_one();
+  }
+  else { // nothing to do
+  }
+  return success;
 }
 
-bool nowtech::LogStdThreadOstream::FreeRtosQueue::receive(char * const aChunkStart, uint32_t const mPauseLength) noexcept {
-  bool result;
-  // Safe to call empty because there will be only one consumer.
-  if(mQueue.empty() && mConditionVariable.wait_for(mLock, std::chrono::milliseconds(mPauseLength)) == std::cv_status::timeout) {
-    result = false;
+bool nowtech::LogStdThreadOstream::FreeRtosQueue::receive(char * const aChunkStart, uint32_t const aPauseLength) noexcept {
+  bool result = tryReceive(aChunkStart);
+  for(uint32_t i = 0u; !result && i < mConsumerWait.spinCount; ++i) {
+    LogMpscRing::relax();
+    result = tryReceive(aChunkStart);
   }
-  else {
-    char *payload;
-    result = mQueue.pop(payload);
-    if(result) {
-      std::copy(payload, payload + mBlockSize, aChunkStart);
-      mFreeList.bounded_push(payload); // this should always succeed here
+  for(uint32_t i = 0u; !result && i < mConsumerWait.yieldCount; ++i) {
+    std::this_thread::yield();
+    result = tryReceive(aChunkStart);
+  }
+  if(!result) {
+    std::unique_lock<std::mutex> lock(mConsumerMutex);
+    mConsumerSleeping.store(true);
+    result = tryReceive(aChunkStart);
+    if(!result && mConsumerCondition.wait_for(lock, std::chrono::milliseconds(aPauseLength)) == std::cv_status::no_timeout) {
+      result = tryReceive(aChunkStart);
     }
     else { // nothing to do
     }
+    mConsumerSleeping.store(false);
+  }
+  else { // nothing to do
+  }
+  if(result && mSleepingProducers.load() > 0u) {
+    std::lock_guard<std::mutex> lock(mProducerMutex);
+    mProducerCondition.notify_all();
+  }
+  else { // nothing to do
   }
   return result;
 }
 
+bool nowtech::LogStdThreadOstream::FreeRtosQueue::trySend(char const * const aChunkStart) noexcept {
+  return mRing.tryPush(aChunkStart);
+}
+
+bool nowtech::LogStdThreadOstream::FreeRtosQueue::tryReceive(char * const aChunkStart) noexcept {
+  return mRing.tryPop(aChunkStart);
+}
+
 void nowtech::LogStdThreadOstream::FreeRtosTimer::run() noexcept {
   while(mKeepRunning.load()) {
     if(mConditionVariable.wait_for(mLock, std::chrono::milliseconds(mTimeout)) == std::cv_status::timeout && mAlarmed.load()) {
@@ -25,16 +25,17 @@
 #define NOWTECH_LOG_STD_THREAD_OSTREAM_INCLUDED
 
 #include "Log.h"
+#include "LogMpscRing.h"
 #include <mutex>
 #include <atomic>
 #include <thread>
 #include <chrono>
 #include <string>
 #include <string>
+#include <map>
 #include <ostream>
 #include <functional>
 #include <condition_variable>
-#include <boost/lockfree/queue.hpp>
 
 namespace nowtech {
 
@@ -43,7 +44,6 @@ namespace nowtech {
   class LogStdThreadOstream final : public LogOsInterface {
   private:
     static constexpr uint32_t cInvalidGivenTaskId = 0u;
-    static constexpr uint32_t cEnqueuePollDelay = 1u;
 
     struct NameId {
       std::string name;
@@ -56,38 +56,39 @@ namespace nowtech {
       }
     };
 
-    /// Uses moodycamel::ConcurrentQueue to simulate a FreeRTOS queue.
+    /// Uses LogMpscRing to simulate a FreeRTOS queue.
+    /// Waiting tasks first retry busily, then yielding, and finally sleep on a
+    /// condition variable until the other side signals a change. The condition
+    /// variables are notified only if someone sleeps on them.
     class FreeRtosQueue final : public BanCopyMove {
-      boost::lockfree::queue<char *> mQueue;
-      boost::lockfree::queue<char *> mFreeList;
-      std::mutex                     mMutex;
-      std::unique_lock<std::mutex>   mLock;
-      std::condition_variable        mConditionVariable;
-
-      size_t const mBlockSize;
-      char        *mBuffer;
+      LogMpscRing                    mRing;
+      std::mutex                     mProducerMutex;
+      std::mutex                     mConsumerMutex;
+      std::condition_variable        mProducerCondition;
+      std::condition_variable        mConsumerCondition;
+      std::atomic<uint32_t>          mSleepingProducers;
+      std::atomic<bool>              mConsumerSleeping;
+
+      LogWaitStrategy const mProducerWait;
+      LogWaitStrategy const mConsumerWait;
+      uint32_t const        mBlockTimeout;
     
     public:
-      /// First implementation, we assume we have plenty of memory.
-      FreeRtosQueue(size_t const aBlockCount, size_t const aBlockSize) noexcept
-        : mQueue(aBlockCount)
-        , mFreeList(aBlockCount)
-        , mLock(mMutex)
-        , mBlockSize(aBlockSize) 
-        , mBuffer(new char[aBlockCount * aBlockSize]) {
-        char *ptr = mBuffer;
-        for(size_t i = 0u; i < aBlockCount; ++i) {
-          mFreeList.bounded_push(ptr);
-          ptr += aBlockSize;
-        }
+      FreeRtosQueue(size_t const aBlockCount, size_t const aBlockSize, LogConfig const &aConfig) noexcept
+        : mRing(aBlockCount, aBlockSize)
+        , mProducerWait(aConfig.producerWait)
+        , mConsumerWait(aConfig.consumerWait)
+        , mBlockTimeout(aConfig.blockTimeout) {
+        mSleepingProducers.store(0u);
+        mConsumerSleeping.store(false);
       }
 
-      ~FreeRtosQueue() noexcept {
-        delete[] mBuffer;
-      }
-
-      void send(char const * const aChunkStart, bool const aBlocks) noexcept;
+      bool send(char const * const aChunkStart, bool const aBlocks) noexcept;
       bool receive(char * const aChunkStart, uint32_t const aPauseLength) noexcept;
+
+    private:
+      bool trySend(char const * const aChunkStart) noexcept;
+      bool tryReceive(char * const aChunkStart) noexcept;
     } mQueue;
 
     /// Used to force transmission of partially filled buffer in a defined
@@ -153,7 +154,7 @@ namespace nowtech {
     LogStdThreadOstream(std::ostream &aOutput
       , LogConfig const & aConfig)
       : LogOsInterface(aConfig)
-      , mQueue(aConfig.queueLength, mChunkSize)
+      , mQueue(aConfig.queueLength, mChunkSize, aConfig)
       , mRefreshTimer(mRefreshPeriod, [this]{this->refreshNeeded();})
       , mOutput(aOutput) {
     }
@@ -189,6 +190,17 @@ namespace nowtech {
       return static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
     }
 
+    /// Returns the std::chrono::steady_clock time in ns.
+    virtual uint64_t getLogTimeNs() const noexcept override {
+      return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+    /// Returns the std::chrono::system_clock time in ns. The UTC offset is
+    /// left 0, as the STL has no thread safe way to get it.
+    virtual uint64_t getWallTimeNs() const noexcept override {
+      return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count());
+    }
+
     /// Creates the transmitter thread using the name logtransmitter.
     /// @param log the Log object to operate on.
     /// @param threadFunc the C function which serves as the task body and
@@ -202,9 +214,10 @@ namespace nowtech {
       mTransmitterThread->join();
     };
 
-    /// Enqueues the chunks, possibly blocking if the queue is full.
-    virtual void push(char const * const aChunkStart, bool const aBlocks) noexcept override {
-      mQueue.send(aChunkStart, aBlocks);
+    /// Enqueues the chunks, possibly blocking if the queue is full, at most
+    /// for LogConfig::blockTimeout if given.
+    virtual bool push(char const * const aChunkStart, bool const aBlocks) noexcept override {
+      return mQueue.send(aChunkStart, aBlocks);
     }
 
     /// Removes the oldest chunk from the queue.
@@ -217,6 +230,14 @@ namespace nowtech {
       std::this_thread::sleep_for(std::chrono::milliseconds(mPauseLength));
     }
 
+    virtual bool hasTransmitterThread() const noexcept override {
+      return true;
+    }
+
+    virtual void sleep(uint32_t const aMs) noexcept override {
+      std::this_thread::sleep_for(std::chrono::milliseconds(aMs));
+    }
+
     /// Transmits the data using the serial descriptor given in the constructor.
     /// @param buffer start of data
     /// @param length length of data
@@ -227,6 +248,20 @@ namespace nowtech {
       aProgressFlag->store(false);
     }
 
+    /// The stream can take any number of buffers at once.
+    virtual LogSizeType getGatherLimit() const noexcept override {
+      return std::numeric_limits<LogSizeType>::max();
+    }
+
+    /// Writes all the buffers and flushes the stream only once.
+    virtual void transmitGathered(LogBufferSlice const * const aSlices, LogSizeType const aCount, std::atomic<bool> *aProgressFlag) noexcept override {
+      for(LogSizeType i = 0u; i < aCount; ++i) {
+        mOutput.write(aSlices[i].buffer, aSlices[i].length);
+      }
+      mOutput.flush();
+      aProgressFlag->store(false);
+    }
+
     /// Starts the timer after which a partially filled buffer should be sent.
     virtual void startRefreshTimer(std::atomic<bool> *aRefreshFlag) noexcept override {
       mRefreshNeeded = aRefreshFlag;
@@ -55,13 +55,13 @@ namespace nowtech {
     /// This object is not intended to be deleted, so control should never
     /// get here.
     virtual ~LogStmHal() {
-    }
-
+    }
+
     /// Returns a textual representation of the current thread ID.
     /// This will be OS dependent.
-    /// @return the thread ID text if called from a thread.
-    virtual char const * getCurrentThreadName() noexcept {
-      return "";
+    /// @return the thread ID text if called from a thread.
+    virtual char const * getCurrentThreadName() noexcept {
+      return "";
     }
 
     /// Returns a textual representation of the given thread ID.
@@ -90,17 +90,20 @@ namespace nowtech {
     }
 
     /// Sends the chunk contents immediately.
-    virtual void push(char const * const aChunkStart, bool const) noexcept {
+    virtual bool push(char const * const aChunkStart, bool const) noexcept {
+      LogSizeType const first = aChunkStart[1] == Chunk::cSingleChunk ? 2u : 1u;
       LogSizeType length;
       char buffer[mChunkSize];
-      for(length = 0u; length < mChunkSize - 1u; ++length) {
-        buffer[length] = aChunkStart[length + 1u];
-        if(aChunkStart[length + 1] == '\n') {
+      for(length = 0u; length < mChunkSize - first; ++length) {
+        buffer[length] = aChunkStart[length + first];
+        if(aChunkStart[length + first] == Chunk::cEndOfMessage) {
+          buffer[length] = Chunk::cEndOfLine;
           ++length;
           break;
         }
       }
       HAL_UART_Transmit(mSerialDescriptor, reinterpret_cast<uint8_t*>(const_cast<char*>(buffer)), length, mUartTimeout);
+      return true;
     }
 
     /// Does nothing.
@@ -0,0 +1,245 @@
+//
+// Copyright 2018 Now Technologies Zrt.
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge,
+// publish, distribute, sublicense, and/or sell copies of the Software,
+// and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#include "LogTeeSink.h"
+#include <cstring>
+
+constexpr uint32_t nowtech::LogTeeSink::cMaxBranches;
+constexpr nowtech::LogSizeType nowtech::LogTeeSink::cMaxGather;
+constexpr uint32_t nowtech::LogTeeSink::cPollPeriod;
+constexpr nowtech::LogSizeType nowtech::LogTeeSink::cFailureMarkLength;
+
+nowtech::LogTeeSink::Branch::Branch(LogSink &aSink, LogTopicMask const &aMask, FlushPolicy const &aPolicy, LogSizeType const aBufferLength, LogSizeType const aBufferCount) noexcept
+  : mSink(aSink)
+  , mMask(aMask)
+  , mPolicy(aPolicy)
+  , mBufferLength(aBufferLength)
+  , mBufferCount(aBufferCount < 2u ? 2u : aBufferCount)
+  , mBuffers(new char[mBufferLength * mBufferCount])
+  , mLengths(new LogSizeType[mBufferCount]())
+  , mSlices(new LogBufferSlice[mBufferCount])
+  , mGatherLimit(aSink.getGatherLimit() < mBufferCount ? aSink.getGatherLimit() : mBufferCount)
+  , mProgress(false)
+  , mDroppedMessages(0u)
+  , mThread(&Branch::run, this) {
+}
+
+nowtech::LogTeeSink::Branch::~Branch() noexcept {
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mKeepRunning = false;
+  }
+  mCondition.notify_one();
+  mThread.join();
+  delete[] mSlices;
+  delete[] mLengths;
+  delete[] mBuffers;
+}
+
+nowtech::LogMessageParser nowtech::LogTeeSink::Branch::take(LogMessageParser const &aStart, LogBufferSlice const * const aSlices, LogSizeType const aCount) noexcept {
+  LogMessageParser parser = aStart;
+  bool notify;
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    bool const wasEmpty = mPendingBytes == 0u;
+    for(LogSizeType i = 0u; i < aCount; ++i) {
+      char const *data = aSlices[i].buffer;
+      char const * const end = data + aSlices[i].length;
+      while(data < end) {
+        char const *part;
+        bool messageStart;
+        bool messageEnd;
+        LogSizeType const length = parser.parse(data, end, part, messageStart, messageEnd);
+        if(length > 0u && mMask.contains(parser.getTopic())) {
+          append(part, length, messageStart);
+        }
+        else { // nothing to do
+        }
+      }
+    }
+    notify = mPendingBytes > 0u && (wasEmpty || isFlushDue(std::chrono::steady_clock::now()));
+  }
+  if(notify) {
+    mCondition.notify_one();
+  }
+  else { // nothing to do
+  }
+  return parser;
+}
+
+void nowtech::LogTeeSink::Branch::append(char const * const aData, LogSizeType const aLength, bool const aMessageStart) noexcept {
+  if(aMessageStart) {
+    mDropping = false;
+  }
+  else { // nothing to do
+  }
+  if(!mDropping) {
+    LogSizeType const freeBuffers = (mHead + mBufferCount - mTail - 1u) % mBufferCount;
+    LogSizeType const room = mBufferLength - mLengths[mTail] + freeBuffers * mBufferLength;
+    if(aLength + cFailureMarkLength <= room) {
+      LogMessageParser::forEachPiece(aData, aLength, [this](char const * const aPiece, LogSizeType const aPieceLength) {
+        copy(aPiece, aPieceLength);
+      });
+    }
+    else {
+      mDropping = true;
+      mDroppedMessages.fetch_add(1u);
+      if(!aMessageStart) {
+        char const mark[cFailureMarkLength] = { Log::cSeparatorFailure, Chunk::cEndOfLine };
+        copy(mark, cFailureMarkLength);
+      }
+      else { // nothing to do
+      }
+    }
+  }
+  else { // nothing to do
+  }
+}
+
+void nowtech::LogTeeSink::Branch::copy(char const *aData, LogSizeType aLength) noexcept {
+  if(mPendingBytes == 0u) {
+    mPendingSince = std::chrono::steady_clock::now();
+  }
+  else { // nothing to do
+  }
+  mPendingBytes += aLength;
+  while(aLength > 0u) {
+    if(mLengths[mTail] == mBufferLength) {
+      mTail = next(mTail);
+    }
+    else { // nothing to do
+    }
+    LogSizeType const room = mBufferLength - mLengths[mTail];
+    LogSizeType const length = aLength < room ? aLength : room;
+    std::memcpy(mBuffers + mTail * mBufferLength + mLengths[mTail], aData, length);
+    mLengths[mTail] += length;
+    aData += length;
+    aLength -= length;
+  }
+}
+
+bool nowtech::LogTeeSink::Branch::isFlushDue(std::chrono::steady_clock::time_point const aNow) const noexcept {
+  return mPendingBytes > 0u && (!mKeepRunning || mPolicy.bytes == 0u || mPendingBytes >= mPolicy.bytes || next(mTail) == mHead
+    || (mPolicy.period > 0u && aNow - mPendingSince >= std::chrono::milliseconds(mPolicy.period)));
+}
+
+void nowtech::LogTeeSink::Branch::run() noexcept {
+  for(LogSizeType i = 0u; i < mBufferCount; ++i) {
+    mSlices[i].buffer = mBuffers + i * mBufferLength;
+    mSlices[i].length = mBufferLength;
+  }
+  mSink.registerBuffers(mSlices, mBufferCount);
+  std::unique_lock<std::mutex> lock(mMutex);
+  while(mKeepRunning || mPendingBytes > 0u) {
+    std::chrono::steady_clock::time_point const now = std::chrono::steady_clock::now();
+    if(isFlushDue(now)) {
+      if(mLengths[mTail] > 0u && next(mTail) != mHead) {
+        // The partially filled one goes too.
+        mTail = next(mTail);
+      }
+      else { // nothing to do
+      }
+      LogSizeType const end = mTail;
+      lock.unlock();
+      flush(end);
+      lock.lock();
+      for(LogSizeType i = mHead; i != end; i = next(i)) {
+        mPendingBytes -= mLengths[i];
+        mLengths[i] = 0u;
+      }
+      mHead = end;
+      mPendingSince = now;
+    }
+    else {
+      std::chrono::steady_clock::duration timeout = std::chrono::milliseconds(cPollPeriod);
+      if(mPendingBytes > 0u && mPolicy.period > 0u && mPendingSince + std::chrono::milliseconds(mPolicy.period) - now < timeout) {
+        timeout = mPendingSince + std::chrono::milliseconds(mPolicy.period) - now;
+      }
+      else { // nothing to do
+      }
+      mCondition.wait_for(lock, timeout);
+      lock.unlock();
+      mSink.poll();
+      lock.lock();
+    }
+  }
+}
+
+void nowtech::LogTeeSink::Branch::flush(LogSizeType const aEnd) noexcept {
+  LogSizeType index = mHead;
+  while(index != aEnd) {
+    LogSizeType count = 0u;
+    while(index != aEnd && count < mGatherLimit) {
+      mSlices[count].buffer = mBuffers + index * mBufferLength;
+      mSlices[count].length = mLengths[index];
+      ++count;
+      index = next(index);
+    }
+    LogSink::writeAndWait(mSink, mSlices, count, mProgress);
+  }
+}
+
+nowtech::LogTeeSink::~LogTeeSink() noexcept {
+  for(uint32_t i = 0u; i < mBranchCount; ++i) {
+    delete mBranches[i];
+  }
+}
+
+bool nowtech::LogTeeSink::addBranch(LogSink &aSink, LogTopicMask const &aMask, FlushPolicy const &aPolicy
+  , LogSizeType const aBufferLength, LogSizeType const aBufferCount) noexcept {
+  bool result;
+  if(mBranchCount < cMaxBranches) {
+    mBranches[mBranchCount] = new Branch(aSink, aMask, aPolicy, aBufferLength, aBufferCount);
+    ++mBranchCount;
+    result = true;
+  }
+  else {
+    result = false;
+  }
+  return result;
+}
+
+void nowtech::LogTeeSink::write(LogBufferSlice const * const aSlices, LogSizeType const aCount, std::atomic<bool> *aProgressFlag) noexcept {
+  LogMessageParser end = mParser;
+  for(uint32_t i = 0u; i < mBranchCount; ++i) {
+    end = mBranches[i]->take(mParser, aSlices, aCount);
+  }
+  mParser = end;
+  aProgressFlag->store(false);
+}
+
+uint32_t nowtech::LogTeeSink::getErrorCount() const noexcept {
+  uint32_t result = LogSink::getErrorCount();
+  for(uint32_t i = 0u; i < mBranchCount; ++i) {
+    result += mBranches[i]->getSink().getErrorCount();
+  }
+  return result;
+}
+
+uint32_t nowtech::LogTeeSink::getLastError() const noexcept {
+  uint32_t result = LogSink::getLastError();
+  for(uint32_t i = 0u; i < mBranchCount && result == 0u; ++i) {
+    result = mBranches[i]->getSink().getLastError();
+  }
+  return result;
+}
@@ -0,0 +1,181 @@
+/*
+ * Copyright 2018 Now Technologies Zrt.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+ * THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef NOWTECH_LOG_TEE_SINK_INCLUDED
+#define NOWTECH_LOG_TEE_SINK_INCLUDED
+
+#include "LogSink.h"
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <condition_variable>
+
+namespace nowtech {
+
+  /// Sink handing the once formatted messages to several sinks, each with
+  /// its own topic filter and flush policy. The messages are copied into the
+  /// buffers of each interested branch, and each branch writes its sink from
+  /// its own thread, so a slow sink does not stall the others or the
+  /// transmitter. If a branch can not keep up, it drops whole messages.
+  /// The topics are known from the tags of LogConfig::emitTopicTags, which
+  /// are removed. Without them all messages count as having no topic.
+  class LogTeeSink final : public LogSink {
+  public:
+    /// Maximum number of branches.
+    static constexpr uint32_t cMaxBranches = 8u;
+
+    /// Maximum number of buffers accepted in one write call.
+    static constexpr LogSizeType cMaxGather = 64u;
+
+    /// A branch waiting for data calls poll() of its sink this often, in ms.
+    static constexpr uint32_t cPollPeriod = 100u;
+
+    /// When a branch writes its collected data. It writes as soon as either
+    /// limit is reached, or when its buffers are full.
+    struct FlushPolicy {
+      /// Bytes to collect, 0 means writing whatever arrived.
+      LogSizeType bytes;
+
+      /// ms the oldest collected byte may wait, 0 means no limit.
+      uint32_t period;
+
+      constexpr FlushPolicy(LogSizeType const aBytes = 0u, uint32_t const aPeriod = 0u)
+      : bytes(aBytes)
+      , period(aPeriod) {
+      }
+    };
+
+    /// Room kept in each branch to end a partially stored message dropped
+    /// later with Log::cSeparatorFailure and line end.
+    static constexpr LogSizeType cFailureMarkLength = 2u;
+
+  private:
+    /// A ring of buffers filled by the transmitter thread and written to the
+    /// sink by the own thread of the branch. Buffers from mHead to mTail are
+    /// ready to write, mTail is being filled.
+    class Branch final : public BanCopyMove {
+    private:
+      LogSink                &mSink;
+      LogTopicMask const         mMask;
+      FlushPolicy const       mPolicy;
+      LogSizeType const       mBufferLength;
+      LogSizeType const       mBufferCount;
+      char * const            mBuffers;
+      LogSizeType * const     mLengths;
+      LogBufferSlice * const  mSlices;
+      LogSizeType const       mGatherLimit;
+      std::mutex              mMutex;
+      std::condition_variable mCondition;
+      LogSizeType             mHead = 0u;
+      LogSizeType             mTail = 0u;
+      LogSizeType             mPendingBytes = 0u;
+      std::chrono::steady_clock::time_point mPendingSince;
+      /// True while the rest of a message is dropped.
+      bool                    mDropping = false;
+      bool                    mKeepRunning = true;
+      std::atomic<bool>       mProgress;
+      std::atomic<uint32_t>   mDroppedMessages;
+      std::thread             mThread;
+
+    public:
+      Branch(LogSink &aSink, LogTopicMask const &aMask, FlushPolicy const &aPolicy, LogSizeType const aBufferLength, LogSizeType const aBufferCount) noexcept;
+
+      /// Writes what is left, and stops the thread.
+      ~Branch() noexcept;
+
+      LogSink &getSink() const noexcept {
+        return mSink;
+      }
+
+      uint32_t getDroppedMessages() const noexcept {
+        return mDroppedMessages.load();
+      }
+
+      /// Copies the messages of the accepted topics.
+      /// @return the parser state after the slices.
+      LogMessageParser take(LogMessageParser const &aStart, LogBufferSlice const * const aSlices, LogSizeType const aCount) noexcept;
+
+    private:
+      /// Appends a part of a message, or drops the whole message if it does
+      /// not fit. Must be called holding mMutex.
+      void append(char const * const aData, LogSizeType const aLength, bool const aMessageStart) noexcept;
+
+      /// Copies into the buffers, which must have enough room.
+      void copy(char const *aData, LogSizeType aLength) noexcept;
+
+      LogSizeType next(LogSizeType const aIndex) const noexcept {
+        return aIndex + 1u == mBufferCount ? 0u : aIndex + 1u;
+      }
+
+      bool isFlushDue(std::chrono::steady_clock::time_point const aNow) const noexcept;
+
+      void run() noexcept;
+
+      /// Writes the buffers from mHead to aEnd, and waits for the sink.
+      void flush(LogSizeType const aEnd) noexcept;
+    };
+
+    Branch  *mBranches[cMaxBranches] = {};
+    uint32_t mBranchCount = 0u;
+    LogMessageParser mParser;
+
+  public:
+    LogTeeSink() noexcept = default;
+
+    /// Stops the branches after they wrote what they have.
+    virtual ~LogTeeSink() noexcept;
+
+    /// Adds a branch and starts its thread. Must be called before the Log
+    /// is constructed.
+    /// @param aSink the sink of the branch, not owned.
+    /// @param aMask the topics the branch receives.
+    /// @param aPolicy when the branch writes.
+    /// @param aBufferLength length of the buffers of the branch.
+    /// @param aBufferCount number of buffers, at least 2.
+    /// @return false if there are already cMaxBranches.
+    bool addBranch(LogSink &aSink, LogTopicMask const &aMask, FlushPolicy const &aPolicy = FlushPolicy()
+      , LogSizeType const aBufferLength = 4096u, LogSizeType const aBufferCount = 8u) noexcept;
+
+    /// @return the number of messages dropped by the branch, which was added as aIndex-th.
+    uint32_t getDroppedMessages(uint32_t const aIndex) const noexcept {
+      return aIndex < mBranchCount ? mBranches[aIndex]->getDroppedMessages() : 0u;
+    }
+
+    virtual LogSizeType getGatherLimit() const noexcept override {
+      return cMaxGather;
+    }
+
+    /// Copies the data to the branches, and clears the progress flag.
+    virtual void write(LogBufferSlice const * const aSlices, LogSizeType const aCount, std::atomic<bool> *aProgressFlag) noexcept override;
+
+    virtual uint32_t getErrorCount() const noexcept override;
+
+    /// @return the last error of the first branch having one.
+    virtual uint32_t getLastError() const noexcept override;
+
+  };
+
+} //namespace nowtech
+
+#endif // NOWTECH_LOG_TEE_SINK_INCLUDED
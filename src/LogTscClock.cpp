@@ -0,0 +1,130 @@
+//
+// Copyright 2018 Now Technologies Zrt.
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge,
+// publish, distribute, sublicense, and/or sell copies of the Software,
+// and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#include "LogTscClock.h"
+#include <chrono>
+#if defined(__x86_64__)
+#include <cpuid.h>
+#include <x86intrin.h>
+#endif
+
+namespace {
+  /// CPUID leaf and EDX bit of the invariant TSC.
+  constexpr uint32_t cCpuidPowerManagement = 0x80000007u;
+  constexpr uint32_t cInvariantTscBit      = 1u << 8u;
+
+  constexpr uint32_t cPairAttempts = 16u;
+
+  bool isCounterUsable() noexcept {
+#if defined(__x86_64__)
+    uint32_t eax, ebx, ecx, edx;
+    return __get_cpuid(cCpuidPowerManagement, &eax, &ebx, &ecx, &edx) != 0 && (edx & cInvariantTscBit) != 0u;
+#elif defined(__aarch64__)
+    return true;
+#else
+    return false;
+#endif
+  }
+
+  /// Computes aValue * aMultiplier >> aShift without overflow. Other
+  /// architectures have no usable counter, there it is never called.
+  uint64_t multiplyShift(uint64_t const aValue, uint64_t const aMultiplier, uint32_t const aShift) noexcept {
+#if defined(__x86_64__) || defined(__aarch64__)
+    return static_cast<uint64_t>((static_cast<unsigned __int128>(aValue) * aMultiplier) >> aShift);
+#else
+    return (aValue * aMultiplier) >> aShift;
+#endif
+  }
+
+  /// Reads the steady clock between two counter readings, and takes their
+  /// average as the counter value belonging to it. A preemption or an
+  /// interrupt in between would spoil the calibration, so the narrowest of
+  /// cPairAttempts readings is used.
+  void readPair(uint64_t &aCounter, uint64_t &aNs) noexcept {
+    uint64_t narrowest = UINT64_MAX;
+    for(uint32_t i = 0u; i < cPairAttempts; ++i) {
+      uint64_t const before = nowtech::LogTscClock::readCounter();
+      uint64_t const ns = nowtech::LogTscClock::readSteadyNs();
+      uint64_t const after = nowtech::LogTscClock::readCounter();
+      if(after - before < narrowest) {
+        narrowest = after - before;
+        aCounter = before + (after - before) / 2u;
+        aNs = ns;
+      }
+      else { // nothing to do
+      }
+    }
+  }
+}
+
+bool nowtech::LogTscClock::calibrate(uint32_t const aCalibrationTime) noexcept {
+  if(isCounterUsable()) {
+    uint64_t startCounter = 0u;
+    uint64_t startNs = 0u;
+    readPair(startCounter, startNs);
+    uint64_t const deadline = startNs + static_cast<uint64_t>(aCalibrationTime) * 1000000u;
+    while(readSteadyNs() < deadline) {
+    }
+    uint64_t endCounter = 0u;
+    uint64_t endNs = 0u;
+    readPair(endCounter, endNs);
+    if(endCounter > startCounter && endNs > startNs) {
+      // At most a few GHz, so the ns per tick fits into the 32 integer bits.
+      mMultiplier = ((endNs - startNs) << cShift) / (endCounter - startCounter);
+      mOriginCounter = endCounter;
+      mOriginNs = endNs;
+      mCalibrated = true;
+    }
+    else { // nothing to do
+    }
+  }
+  else { // nothing to do
+  }
+  return mCalibrated;
+}
+
+uint64_t nowtech::LogTscClock::getNs() const noexcept {
+  if(mCalibrated) {
+    uint64_t const elapsed = readCounter() - mOriginCounter;
+    return mOriginNs + multiplyShift(elapsed, mMultiplier, cShift);
+  }
+  else {
+    return readSteadyNs();
+  }
+}
+
+uint64_t nowtech::LogTscClock::readCounter() noexcept {
+#if defined(__x86_64__)
+  return __rdtsc();
+#elif defined(__aarch64__)
+  uint64_t result;
+  asm volatile("mrs %0, cntvct_el0" : "=r"(result));
+  return result;
+#else
+  return 0u;
+#endif
+}
+
+uint64_t nowtech::LogTscClock::readSteadyNs() noexcept {
+  return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
@@ -0,0 +1,79 @@
+/*
+ * Copyright 2018 Now Technologies Zrt.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+ * THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef NOWTECH_LOG_TSC_CLOCK_INCLUDED
+#define NOWTECH_LOG_TSC_CLOCK_INCLUDED
+
+#include "BanCopyMove.h"
+#include <cstdint>
+
+namespace nowtech {
+
+  /// Nanosecond clock reading the CPU time stamp counter, which costs a few
+  /// ns instead of a clock_gettime or std::chrono::steady_clock call. It is
+  /// calibrated once against std::chrono::steady_clock, and its values are on
+  /// the same scale, so they can be mixed with the ones of the steady clock.
+  /// Only x86-64 with invariant TSC and AArch64 are supported, elsewhere, or
+  /// before calibration, getNs() reads std::chrono::steady_clock.
+  /// The counters of the cores are assumed to be synchronized, as with any
+  /// recent CPU and kernel.
+  class LogTscClock final : public BanCopyMove {
+  private:
+    /// Fractional bits of mMultiplier.
+    static constexpr uint32_t cShift = 32u;
+
+    bool mCalibrated = false;
+    uint64_t mOriginCounter = 0u;
+    uint64_t mOriginNs = 0u;
+
+    /// ns per counter tick in cShift fractional bits.
+    uint64_t mMultiplier = 0u;
+
+  public:
+    /// Does not calibrate, because it takes time.
+    LogTscClock() noexcept = default;
+
+    /// Measures the counter frequency by busy waiting aCalibrationTime ms.
+    /// Longer times give better accuracy.
+    /// Must not be more than 4000 ms.
+    /// Must be called before using the clock from several threads.
+    /// @return false if the counter is not usable on this CPU.
+    bool calibrate(uint32_t const aCalibrationTime) noexcept;
+
+    bool isCalibrated() const noexcept {
+      return mCalibrated;
+    }
+
+    /// Returns the time in ns on the std::chrono::steady_clock scale.
+    uint64_t getNs() const noexcept;
+
+    /// Returns the raw counter value, or 0 if there is no usable counter.
+    static uint64_t readCounter() noexcept;
+
+    /// Returns the std::chrono::steady_clock time in ns.
+    static uint64_t readSteadyNs() noexcept;
+  };
+
+} //namespace nowtech
+
+#endif // NOWTECH_LOG_TSC_CLOCK_INCLUDED
@@ -0,0 +1,220 @@
+//
+// Copyright 2018 Now Technologies Zrt.
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge,
+// publish, distribute, sublicense, and/or sell copies of the Software,
+// and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#include "LogUnixSocketSink.h"
+#include <unistd.h>
+#include <poll.h>
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <ctime>
+
+nowtech::LogUnixSocketSink::LogUnixSocketSink(char const * const aPath, Type const aType, Unit const aUnit, Policy const aPolicy
+  , uint32_t const aReconnectPeriod, LogSizeType const aMaxMessageLength) noexcept
+  : mType(aType)
+  , mUnit(aUnit)
+  , mPolicy(aPolicy)
+  , mReconnectPeriod(aReconnectPeriod)
+  , mCarry(aUnit == Unit::cMessage ? new char[aMaxMessageLength] : nullptr)
+  , mCarryCapacity(aUnit == Unit::cMessage ? aMaxMessageLength : 0u) {
+  mDroppedDatagrams.store(0u);
+  mDroppedBytes.store(0u);
+  std::memset(&mAddress, 0, sizeof(mAddress));
+  mAddress.sun_family = AF_UNIX;
+  std::strncpy(mAddress.sun_path, aPath, sizeof(mAddress.sun_path) - 1u);
+  mAddressLength = static_cast<socklen_t>(offsetof(sockaddr_un, sun_path) + std::strlen(mAddress.sun_path) + 1u);
+  std::memset(mBatch, 0, sizeof(mBatch));
+  connect();
+}
+
+nowtech::LogUnixSocketSink::~LogUnixSocketSink() noexcept {
+  if(mSocket >= 0) {
+    close(mSocket);
+  }
+  else { // nothing to do
+  }
+  delete[] mCarry;
+}
+
+void nowtech::LogUnixSocketSink::write(LogBufferSlice const * const aSlices, LogSizeType const aCount, std::atomic<bool> *aProgressFlag) noexcept {
+  for(LogSizeType i = 0u; i < aCount; ++i) {
+    char const *pointer = aSlices[i].buffer;
+    char const * const end = pointer + aSlices[i].length;
+    if(mUnit == Unit::cBuffer) {
+      add(pointer, aSlices[i].length, nullptr, 0u);
+      continue;
+    }
+    else { // nothing to do
+    }
+    while(pointer < end) {
+      char const * const lineEnd = static_cast<char const*>(std::memchr(pointer, Chunk::cEndOfLine, static_cast<size_t>(end - pointer)));
+      if(lineEnd != nullptr && mCarryLength + static_cast<LogSizeType>(lineEnd + 1 - pointer) <= mCarryCapacity) {
+        add(mCarry, mCarryLength, pointer, static_cast<size_t>(lineEnd + 1 - pointer));
+        mCarryLength = 0u;
+        pointer = lineEnd + 1;
+      }
+      else {
+        // The carry is referenced by the batch until it is sent.
+        send();
+        LogSizeType const rest = static_cast<LogSizeType>((lineEnd != nullptr ? lineEnd + 1 : end) - pointer);
+        LogSizeType const length = rest < mCarryCapacity - mCarryLength ? rest : mCarryCapacity - mCarryLength;
+        std::memcpy(mCarry + mCarryLength, pointer, length);
+        mCarryLength += length;
+        pointer += length;
+        if(mCarryLength == mCarryCapacity) {
+          // Too long message, sent in parts.
+          add(mCarry, mCarryLength, nullptr, 0u);
+          send();
+          mCarryLength = 0u;
+        }
+        else { // nothing to do
+        }
+      }
+    }
+  }
+  send();
+  aProgressFlag->store(false);
+}
+
+void nowtech::LogUnixSocketSink::poll() noexcept {
+  if(mSocket < 0 && now() - mLastAttempt >= mReconnectPeriod) {
+    connect();
+  }
+  else { // nothing to do
+  }
+}
+
+void nowtech::LogUnixSocketSink::connect() noexcept {
+  mLastAttempt = now();
+  int const type = (mType == Type::cSeqPacket ? SOCK_SEQPACKET : SOCK_DGRAM) | SOCK_CLOEXEC | (mPolicy == Policy::cDrop ? SOCK_NONBLOCK : 0);
+  mSocket = socket(AF_UNIX, type, 0);
+  if(mSocket >= 0 && ::connect(mSocket, reinterpret_cast<sockaddr const*>(&mAddress), mAddressLength) == 0) {
+    mFailureReported = false;
+  }
+  else {
+    int const error = errno;
+    if(mSocket >= 0) {
+      close(mSocket);
+      mSocket = -1;
+    }
+    else { // nothing to do
+    }
+    if(!mFailureReported) {
+      reportError(static_cast<uint32_t>(error));
+      mFailureReported = true;
+    }
+    else { // nothing to do
+    }
+  }
+}
+
+void nowtech::LogUnixSocketSink::disconnect(int const aError) noexcept {
+  close(mSocket);
+  mSocket = -1;
+  mLastAttempt = now();
+  reportError(static_cast<uint32_t>(aError));
+  mFailureReported = true;
+}
+
+void nowtech::LogUnixSocketSink::add(char const * const aFirst, size_t const aFirstLength, char const * const aSecond, size_t const aSecondLength) noexcept {
+  if(mBatchCount == cMaxBatch) {
+    send();
+  }
+  else { // nothing to do
+  }
+  iovec * const vectors = mVectors + 2u * mBatchCount;
+  msghdr &header = mBatch[mBatchCount].msg_hdr;
+  header.msg_iov = vectors;
+  header.msg_iovlen = 0u;
+  if(aFirstLength > 0u) {
+    vectors[header.msg_iovlen].iov_base = const_cast<char*>(aFirst);
+    vectors[header.msg_iovlen].iov_len = aFirstLength;
+    ++header.msg_iovlen;
+  }
+  else { // nothing to do
+  }
+  if(aSecondLength > 0u) {
+    vectors[header.msg_iovlen].iov_base = const_cast<char*>(aSecond);
+    vectors[header.msg_iovlen].iov_len = aSecondLength;
+    ++header.msg_iovlen;
+  }
+  else { // nothing to do
+  }
+  if(header.msg_iovlen > 0u) {
+    ++mBatchCount;
+  }
+  else { // nothing to do
+  }
+}
+
+void nowtech::LogUnixSocketSink::send() noexcept {
+  if(mSocket < 0) {
+    poll();
+  }
+  else { // nothing to do
+  }
+  uint32_t sent = 0u;
+  while(mSocket >= 0 && sent < mBatchCount) {
+    int const result = sendmmsg(mSocket, mBatch + sent, mBatchCount - sent, MSG_NOSIGNAL);
+    if(result > 0) {
+      sent += static_cast<uint32_t>(result);
+    }
+    else if(errno == EINTR) { // nothing to do
+    }
+    else if(errno == EAGAIN || errno == EWOULDBLOCK) {
+      if(mPolicy == Policy::cDrop) {
+        break;
+      }
+      else {
+        // Only the datagram sockets may signal this even in blocking mode.
+        pollfd descriptor = { mSocket, POLLOUT, 0 };
+        static_cast<void>(::poll(&descriptor, 1u, -1));
+      }
+    }
+    else if(errno == EMSGSIZE || errno == ENOBUFS) {
+      reportError(static_cast<uint32_t>(errno));
+      drop(sent, sent + 1u);
+      ++sent;
+    }
+    else {
+      disconnect(errno);
+    }
+  }
+  drop(sent, mBatchCount);
+  mBatchCount = 0u;
+}
+
+void nowtech::LogUnixSocketSink::drop(uint32_t const aFrom, uint32_t const aTo) noexcept {
+  for(uint32_t i = aFrom; i < aTo; ++i) {
+    mDroppedDatagrams.fetch_add(1u);
+    for(size_t j = 0u; j < mBatch[i].msg_hdr.msg_iovlen; ++j) {
+      mDroppedBytes.fetch_add(mBatch[i].msg_hdr.msg_iov[j].iov_len);
+    }
+  }
+}
+
+uint64_t nowtech::LogUnixSocketSink::now() noexcept {
+  timespec time;
+  clock_gettime(CLOCK_MONOTONIC_COARSE, &time);
+  return static_cast<uint64_t>(time.tv_sec) * 1000u + static_cast<uint64_t>(time.tv_nsec) / 1000000u;
+}
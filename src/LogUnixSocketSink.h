@@ -0,0 +1,151 @@
+/*
+ * Copyright 2018 Now Technologies Zrt.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+ * THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef NOWTECH_LOG_UNIX_SOCKET_SINK_INCLUDED
+#define NOWTECH_LOG_UNIX_SOCKET_SINK_INCLUDED
+
+#include "LogSink.h"
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <cstdint>
+
+namespace nowtech {
+
+  /// Sink sending datagrams to a local collector over a Unix domain
+  /// SOCK_SEQPACKET or SOCK_DGRAM socket, many in one sendmmsg call. A
+  /// datagram is either a whole transmission buffer or a single message with
+  /// its line end, so the collector needs no line splitting.
+  /// If the collector is slow, cBlock makes the transmitter thread wait,
+  /// which lets the queue fill up and the logging tasks block or drop
+  /// according to LogConfig::blocks. cDrop drops the datagrams the socket
+  /// does not accept immediately.
+  /// If the collector is not running or goes away, the datagrams are dropped
+  /// and connecting is retried periodically from the transmitter thread, so
+  /// the logging tasks are never blocked by it.
+  /// tools/logsocketlisten.cpp is a simple collector for testing.
+  class LogUnixSocketSink final : public LogSink {
+  public:
+    enum class Type : uint8_t {
+      cSeqPacket,
+      cDatagram
+    };
+
+    enum class Unit : uint8_t {
+      /// One datagram per transmission buffer.
+      cBuffer,
+      /// One datagram per message. A message longer than aMaxMessageLength
+      /// is split, and only its last part has line end.
+      cMessage
+    };
+
+    enum class Policy : uint8_t {
+      cBlock,
+      cDrop
+    };
+
+    /// Maximum number of buffers accepted in one write call.
+    static constexpr LogSizeType cMaxGather = 64u;
+
+    /// Maximum number of datagrams sent in one sendmmsg call.
+    static constexpr uint32_t cMaxBatch = 64u;
+
+  private:
+    sockaddr_un       mAddress;
+    socklen_t         mAddressLength;
+    Type const        mType;
+    Unit const        mUnit;
+    Policy const      mPolicy;
+    uint32_t const    mReconnectPeriod;
+    int               mSocket = -1;
+
+    /// CLOCK_MONOTONIC_COARSE time of the last connection attempt in ms.
+    uint64_t          mLastAttempt = 0u;
+
+    /// True if the failure of the last attempt was already reported.
+    bool              mFailureReported = false;
+
+    /// Beginning of a message continuing in the next buffer, in cMessage mode.
+    char * const      mCarry;
+    LogSizeType const mCarryCapacity;
+    LogSizeType       mCarryLength = 0u;
+
+    mmsghdr           mBatch[cMaxBatch];
+    iovec             mVectors[cMaxBatch * 2u];
+    uint32_t          mBatchCount = 0u;
+
+    std::atomic<uint32_t> mDroppedDatagrams;
+    std::atomic<uint64_t> mDroppedBytes;
+
+  public:
+    /// Connects the socket right away, if possible.
+    /// @param aPath path of the socket the collector listens on.
+    /// @param aReconnectPeriod ms between connection attempts while disconnected.
+    /// @param aMaxMessageLength longest message sent in one datagram in cMessage mode.
+    LogUnixSocketSink(char const * const aPath, Type const aType, Unit const aUnit, Policy const aPolicy
+      , uint32_t const aReconnectPeriod = 1000u, LogSizeType const aMaxMessageLength = 4096u) noexcept;
+
+    virtual ~LogUnixSocketSink() noexcept;
+
+    virtual LogSizeType getGatherLimit() const noexcept override {
+      return cMaxGather;
+    }
+
+    virtual void write(LogBufferSlice const * const aSlices, LogSizeType const aCount, std::atomic<bool> *aProgressFlag) noexcept override;
+
+    /// Reconnects if disconnected and the period has elapsed.
+    virtual void poll() noexcept override;
+
+    bool isConnected() const noexcept {
+      return mSocket >= 0;
+    }
+
+    /// @return the number of datagrams dropped due to cDrop or disconnection.
+    uint32_t getDroppedDatagrams() const noexcept {
+      return mDroppedDatagrams.load();
+    }
+
+    uint64_t getDroppedBytes() const noexcept {
+      return mDroppedBytes.load();
+    }
+
+  private:
+    void connect() noexcept;
+
+    void disconnect(int const aError) noexcept;
+
+    /// Adds a datagram consisting of one or two parts to the batch, sending
+    /// the batch first if it is full.
+    void add(char const * const aFirst, size_t const aFirstLength, char const * const aSecond, size_t const aSecondLength) noexcept;
+
+    /// Sends the batch according to the policy, dropping what can not be sent.
+    void send() noexcept;
+
+    /// Counts the datagrams [aFrom, aTo) of the batch as dropped.
+    void drop(uint32_t const aFrom, uint32_t const aTo) noexcept;
+
+    static uint64_t now() noexcept;
+  };
+
+} //namespace nowtech
+
+#endif // NOWTECH_LOG_UNIX_SOCKET_SINK_INCLUDED
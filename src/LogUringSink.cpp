@@ -0,0 +1,315 @@
+//
+// Copyright 2018 Now Technologies Zrt.
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge,
+// publish, distribute, sublicense, and/or sell copies of the Software,
+// and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+// THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#include "LogUringSink.h"
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cerrno>
+
+namespace {
+  uint32_t loadAcquire(uint32_t const * const aWhere) noexcept {
+    return __atomic_load_n(aWhere, __ATOMIC_ACQUIRE);
+  }
+
+  void storeRelease(uint32_t * const aWhere, uint32_t const aValue) noexcept {
+    __atomic_store_n(aWhere, aValue, __ATOMIC_RELEASE);
+  }
+
+  template<typename tType>
+  tType *at(void * const aBase, uint32_t const aOffset) noexcept {
+    return reinterpret_cast<tType*>(static_cast<char*>(aBase) + aOffset);
+  }
+}
+
+nowtech::LogUringSink::LogUringSink(int const aFd, bool const aUseFixedBuffers) noexcept
+  : LogFdSink(aFd)
+  , mUseFixedBuffers(aUseFixedBuffers)
+  , mRingFd(-1)
+  , mSqRing(MAP_FAILED)
+  , mCqRing(MAP_FAILED)
+  , mSqes(static_cast<io_uring_sqe*>(MAP_FAILED)) {
+  off_t const position = lseek(aFd, 0, SEEK_CUR);
+  mSeekable = position >= 0;
+  mOffset = mSeekable ? static_cast<uint64_t>(position) : cCurrentPosition;
+  io_uring_params parameters = {};
+  int const ringFd = static_cast<int>(syscall(__NR_io_uring_setup, static_cast<uint32_t>(cMaxGather), &parameters));
+  if(ringFd >= 0) {
+    mSqRingSize = parameters.sq_off.array + parameters.sq_entries * sizeof(uint32_t);
+    mCqRingSize = parameters.cq_off.cqes + parameters.cq_entries * sizeof(io_uring_cqe);
+    bool const singleMmap = (parameters.features & IORING_FEAT_SINGLE_MMAP) != 0u;
+    if(singleMmap) {
+      mSqRingSize = mSqRingSize > mCqRingSize ? mSqRingSize : mCqRingSize;
+      mCqRingSize = mSqRingSize;
+    }
+    else { // nothing to do
+    }
+    mSqesSize = parameters.sq_entries * sizeof(io_uring_sqe);
+    mSqRing = mmap(nullptr, mSqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQ_RING);
+    mCqRing = singleMmap ? mSqRing : mmap(nullptr, mCqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_CQ_RING);
+    mSqes = static_cast<io_uring_sqe*>(mmap(nullptr, mSqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQES));
+    if(mSqRing != MAP_FAILED && mCqRing != MAP_FAILED && mSqes != MAP_FAILED) {
+      mSqTail = at<uint32_t>(mSqRing, parameters.sq_off.tail);
+      mSqMask = *at<uint32_t>(mSqRing, parameters.sq_off.ring_mask);
+      mSqArray = at<uint32_t>(mSqRing, parameters.sq_off.array);
+      mCqHead = at<uint32_t>(mCqRing, parameters.cq_off.head);
+      mCqTail = at<uint32_t>(mCqRing, parameters.cq_off.tail);
+      mCqMask = *at<uint32_t>(mCqRing, parameters.cq_off.ring_mask);
+      mCqes = at<io_uring_cqe>(mCqRing, parameters.cq_off.cqes);
+      mRingFd = ringFd;
+    }
+    else {
+      close(ringFd);
+    }
+  }
+  else { // fall back to synchronous writes
+  }
+}
+
+nowtech::LogUringSink::~LogUringSink() noexcept {
+  while(mPendingCount > 0u) {
+    waitForCompletion();
+  }
+  if(mSqes != MAP_FAILED) {
+    munmap(mSqes, mSqesSize);
+  }
+  else { // nothing to do
+  }
+  if(mCqRing != MAP_FAILED && mCqRing != mSqRing) {
+    munmap(mCqRing, mCqRingSize);
+  }
+  else { // nothing to do
+  }
+  if(mSqRing != MAP_FAILED) {
+    munmap(mSqRing, mSqRingSize);
+  }
+  else { // nothing to do
+  }
+  if(mRingFd >= 0) {
+    close(mRingFd);
+  }
+  else { // nothing to do
+  }
+  delete[] mRegistered;
+}
+
+void nowtech::LogUringSink::registerBuffers(LogBufferSlice const * const aBuffers, LogSizeType const aCount) noexcept {
+  if(mUseFixedBuffers && mSeekable && mRingFd >= 0) {
+    mRegistered = new iovec[aCount];
+    for(LogSizeType i = 0u; i < aCount; ++i) {
+      mRegistered[i].iov_base = const_cast<char*>(aBuffers[i].buffer);
+      mRegistered[i].iov_len = aBuffers[i].length;
+    }
+    if(syscall(__NR_io_uring_register, mRingFd, IORING_REGISTER_BUFFERS, mRegistered, static_cast<uint32_t>(aCount)) == 0) {
+      mRegisteredCount = aCount;
+    }
+    else { // probably RLIMIT_MEMLOCK, stay with IORING_OP_WRITEV
+    }
+  }
+  else { // nothing to do
+  }
+}
+
+void nowtech::LogUringSink::write(LogBufferSlice const * const aSlices, LogSizeType const aCount, std::atomic<bool> *aProgressFlag) noexcept {
+  if(mRingFd >= 0) {
+    mProgressFlag = aProgressFlag;
+    bool fixed = mRegisteredCount > 0u;
+    uint64_t offset = mOffset;
+    for(LogSizeType i = 0u; fixed && i < aCount; ++i) {
+      int32_t const index = findRegistered(aSlices[i].buffer);
+      if(index >= 0) {
+        mRequests[i] = Request { aSlices[i].buffer, static_cast<uint32_t>(aSlices[i].length), static_cast<uint16_t>(index), offset };
+        offset += aSlices[i].length;
+      }
+      else {
+        fixed = false;
+      }
+    }
+    if(fixed) {
+      mOffset = offset;
+      for(LogSizeType i = 0u; i < aCount; ++i) {
+        queueFixed(static_cast<uint16_t>(i));
+      }
+    }
+    else {
+      mVectorOffset = mOffset;
+      for(LogSizeType i = 0u; i < aCount; ++i) {
+        mVectors[i].iov_base = const_cast<char*>(aSlices[i].buffer);
+        mVectors[i].iov_len = aSlices[i].length;
+        mOffset += mSeekable ? aSlices[i].length : 0u;
+      }
+      mVectorStart = mVectors;
+      mVectorCount = static_cast<int>(aCount);
+      queueVectors();
+    }
+    submit(0u);
+  }
+  else {
+    LogFdSink::write(aSlices, aCount, aProgressFlag);
+  }
+}
+
+void nowtech::LogUringSink::poll() noexcept {
+  if(mPendingCount > 0u) {
+    uint32_t head = *mCqHead;
+    uint32_t const tail = loadAcquire(mCqTail);
+    while(head != tail) {
+      io_uring_cqe const &completion = mCqes[head & mCqMask];
+      complete(completion.user_data, completion.res);
+      ++head;
+    }
+    storeRelease(mCqHead, head);
+    if(mToSubmit > 0u) {
+      submit(0u);
+    }
+    else { // nothing to do
+    }
+    if(mPendingCount == 0u && mProgressFlag != nullptr) {
+      mProgressFlag->store(false);
+      mProgressFlag = nullptr;
+    }
+    else { // nothing to do
+    }
+  }
+  else { // nothing to do
+  }
+}
+
+bool nowtech::LogUringSink::waitForCompletion() noexcept {
+  if(mPendingCount > 0u) {
+    submit(1u);
+    poll();
+  }
+  else { // nothing to do
+  }
+  return mRingFd >= 0;
+}
+
+void nowtech::LogUringSink::queueVectors() noexcept {
+  uint32_t const tail = *mSqTail;
+  uint32_t const index = tail & mSqMask;
+  io_uring_sqe &entry = mSqes[index];
+  entry = io_uring_sqe {};
+  entry.opcode = IORING_OP_WRITEV;
+  entry.fd = mFd;
+  entry.off = mVectorOffset;
+  entry.addr = reinterpret_cast<uint64_t>(mVectorStart);
+  entry.len = static_cast<uint32_t>(mVectorCount);
+  entry.user_data = cVectorRequest;
+  mSqArray[index] = index;
+  storeRelease(mSqTail, tail + 1u);
+  ++mToSubmit;
+  ++mPendingCount;
+}
+
+void nowtech::LogUringSink::queueFixed(uint16_t const aIndex) noexcept {
+  Request const &request = mRequests[aIndex];
+  uint32_t const tail = *mSqTail;
+  uint32_t const index = tail & mSqMask;
+  io_uring_sqe &entry = mSqes[index];
+  entry = io_uring_sqe {};
+  entry.opcode = IORING_OP_WRITE_FIXED;
+  entry.fd = mFd;
+  entry.off = request.offset;
+  entry.addr = reinterpret_cast<uint64_t>(request.buffer);
+  entry.len = request.length;
+  entry.buf_index = request.bufferIndex;
+  entry.user_data = aIndex;
+  mSqArray[index] = index;
+  storeRelease(mSqTail, tail + 1u);
+  ++mToSubmit;
+  ++mPendingCount;
+}
+
+void nowtech::LogUringSink::submit(uint32_t const aMinComplete) noexcept {
+  long result;
+  do {
+    result = syscall(__NR_io_uring_enter, mRingFd, mToSubmit, aMinComplete, aMinComplete > 0u ? IORING_ENTER_GETEVENTS : 0u, nullptr, 0u);
+  } while(result < 0 && errno == EINTR);
+  if(result < 0) {
+    // The entries stay published in the ring and mToSubmit keeps counting
+    // them, so poll() or the next submit() passes them to the kernel again.
+    reportError(static_cast<uint32_t>(errno));
+  }
+  else {
+    // The kernel may consume fewer entries than asked, the rest are resubmitted.
+    mToSubmit -= static_cast<uint32_t>(result);
+  }
+}
+
+void nowtech::LogUringSink::complete(uint64_t const aUserData, int32_t const aResult) noexcept {
+  --mPendingCount;
+  uint32_t written = 0u;
+  bool resubmit = true;
+  if(aResult == -EINTR || aResult == -EAGAIN) { // retry the whole remainder
+  }
+  else if(aResult <= 0) {
+    // A failed or zero-length write is given up to avoid looping forever.
+    reportError(aResult < 0 ? static_cast<uint32_t>(-aResult) : EIO);
+    resubmit = false;
+  }
+  else {
+    written = static_cast<uint32_t>(aResult);
+  }
+  if(!resubmit) { // nothing to do
+  }
+  else if(aUserData == cVectorRequest) {
+    mVectorOffset += mSeekable ? written : 0u;
+    while(mVectorCount > 0 && written >= mVectorStart->iov_len) {
+      written -= static_cast<uint32_t>(mVectorStart->iov_len);
+      ++mVectorStart;
+      --mVectorCount;
+    }
+    if(mVectorCount > 0) {
+      mVectorStart->iov_base = static_cast<char*>(mVectorStart->iov_base) + written;
+      mVectorStart->iov_len -= written;
+      queueVectors();
+    }
+    else { // nothing to do
+    }
+  }
+  else {
+    Request &request = mRequests[aUserData];
+    request.buffer += written;
+    request.length -= written;
+    request.offset += written;
+    if(request.length > 0u) {
+      queueFixed(static_cast<uint16_t>(aUserData));
+    }
+    else { // nothing to do
+    }
+  }
+}
+
+int32_t nowtech::LogUringSink::findRegistered(char const * const aBuffer) const noexcept {
+  int32_t result = -1;
+  for(LogSizeType i = 0u; result < 0 && i < mRegisteredCount; ++i) {
+    char const * const start = static_cast<char const*>(mRegistered[i].iov_base);
+    if(aBuffer >= start && aBuffer < start + mRegistered[i].iov_len) {
+      result = static_cast<int32_t>(i);
+    }
+    else { // nothing to do
+    }
+  }
+  return result;
+}
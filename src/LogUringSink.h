@@ -0,0 +1,128 @@
+/*
+ * Copyright 2018 Now Technologies Zrt.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+ * THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef NOWTECH_LOG_URING_SINK_INCLUDED
+#define NOWTECH_LOG_URING_SINK_INCLUDED
+
+#include "LogFdSink.h"
+#include <linux/io_uring.h>
+#include <cstdint>
+
+namespace nowtech {
+
+  /// Sink submitting the transmission buffers to an io_uring, so the
+  /// transmitter thread can continue reassembling messages into the free
+  /// buffers while the writes are in flight. Completions are reaped in poll(),
+  /// and the progress flag is cleared when all the writes of a call are done.
+  /// The ring is used through raw system calls, no liburing is needed.
+  /// If io_uring is not available, it falls back to synchronous LogFdSink
+  /// behaviour, see isAsynchronous().
+  /// With aUseFixedBuffers, the transmission buffers are registered in the
+  /// ring, and written with IORING_OP_WRITE_FIXED, one request per buffer.
+  /// This needs a seekable file and enough RLIMIT_MEMLOCK, otherwise the
+  /// buffers are written with IORING_OP_WRITEV.
+  /// O_DIRECT is not supported, because buffer lengths follow the message
+  /// boundaries and not the block size.
+  class LogUringSink final : public LogFdSink {
+  private:
+    static constexpr uint64_t cVectorRequest = UINT64_MAX;
+    static constexpr uint64_t cCurrentPosition = UINT64_MAX;
+
+    /// A write of a registered buffer.
+    struct Request {
+      char const * buffer;
+      uint32_t     length;
+      uint16_t     bufferIndex;
+      uint64_t     offset;
+    };
+
+    bool const     mUseFixedBuffers;
+    bool           mSeekable;
+    uint64_t       mOffset;
+    int            mRingFd;
+
+    void          *mSqRing;
+    size_t         mSqRingSize;
+    void          *mCqRing;
+    size_t         mCqRingSize;
+    io_uring_sqe  *mSqes;
+    size_t         mSqesSize;
+    uint32_t      *mSqTail;
+    uint32_t       mSqMask;
+    uint32_t      *mSqArray;
+    uint32_t      *mCqHead;
+    uint32_t      *mCqTail;
+    uint32_t       mCqMask;
+    io_uring_cqe  *mCqes;
+    /// Entries published at the SQ tail but not yet taken by io_uring_enter.
+    uint32_t       mToSubmit = 0u;
+
+    /// The IORING_OP_WRITEV request, if any.
+    iovec          mVectors[cMaxGather];
+    iovec         *mVectorStart;
+    int            mVectorCount;
+    uint64_t       mVectorOffset;
+
+    /// The IORING_OP_WRITE_FIXED requests, if any.
+    Request        mRequests[cMaxGather];
+
+    iovec         *mRegistered = nullptr;
+    LogSizeType    mRegisteredCount = 0u;
+
+    uint32_t           mPendingCount = 0u;
+    std::atomic<bool> *mProgressFlag = nullptr;
+
+  public:
+    /// The class does not own the file descriptor and only writes to it.
+    /// @param aFd file descriptor to write.
+    /// @param aUseFixedBuffers true to register the transmission buffers.
+    LogUringSink(int const aFd, bool const aUseFixedBuffers = false) noexcept;
+
+    virtual ~LogUringSink() noexcept;
+
+    /// @return true if io_uring could be set up.
+    bool isAsynchronous() const noexcept {
+      return mRingFd >= 0;
+    }
+
+    virtual void registerBuffers(LogBufferSlice const * const aBuffers, LogSizeType const aCount) noexcept override;
+
+    virtual void write(LogBufferSlice const * const aSlices, LogSizeType const aCount, std::atomic<bool> *aProgressFlag) noexcept override;
+
+    /// Reaps the completions.
+    virtual void poll() noexcept override;
+
+    /// Sleeps in io_uring_enter until a write completes.
+    virtual bool waitForCompletion() noexcept override;
+
+  private:
+    void queueVectors() noexcept;
+    void queueFixed(uint16_t const aIndex) noexcept;
+    void submit(uint32_t const aMinComplete) noexcept;
+    void complete(uint64_t const aUserData, int32_t const aResult) noexcept;
+    int32_t findRegistered(char const * const aBuffer) const noexcept;
+  };
+
+} //namespace nowtech
+
+#endif // NOWTECH_LOG_URING_SINK_INCLUDED
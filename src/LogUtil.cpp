@@ -21,6 +21,7 @@
 // THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 //
 #include "LogUtil.h"
+#include <cstring>
 
 nowtech::Chunk const &nowtech::CircularBuffer::inspect(TaskIdType const aTaskId) noexcept {
   while(mInspectedCount < mCount && mFound.getTaskId() != aTaskId) {
@@ -66,9 +67,31 @@ nowtech::Chunk const &nowtech::CircularBuffer::inspect(TaskIdType const aTaskId)
 }
 
 nowtech::TransmitBuffers &nowtech::TransmitBuffers::operator<<(nowtech::Chunk const &aChunk) noexcept {
-  if(aChunk.getTaskId() != nowtech::Chunk::cInvalidTaskId) {
-    LogSizeType i = 1;
+  if(aChunk.getTaskId() == nowtech::Chunk::cInvalidTaskId) { // nothing to do
+  }
+  else if(aChunk.getData()[1] == Chunk::cFlushMarker) {
+    takeFlushMarker(aChunk.getData());
+    mWasTerminalChunk = false;
+  }
+  else if(aChunk.getData()[1] == Chunk::cAbortMessage) {
+    if(aChunk.getTaskId() == mActiveTaskId) {
+      abortActiveMessage();
+      mActiveTaskId = nowtech::Chunk::cInvalidTaskId;
+      mWasTerminalChunk = true;
+    }
+    else {
+      mWasTerminalChunk = false;
+    }
+  }
+  else {
     char const * const origin = aChunk.getData();
+    LogSizeType i = origin[1] == Chunk::cSingleChunk ? 2u : 1u;
+    if(aChunk.getTaskId() != mActiveTaskId) {
+      markMessageStart();
+      markHeaderStart();
+    }
+    else { // nothing to do
+    }
     mWasTerminalChunk = false;
     char * buffer = mBuffers[mBufferToWrite];
     LogSizeType &index = mIndex[mBufferToWrite];
@@ -85,6 +108,7 @@ nowtech::TransmitBuffers &nowtech::TransmitBuffers::operator<<(nowtech::Chunk co
       ++index;
     }
     ++mChunkCount[mBufferToWrite];
+    compactHeader();
     if(mWasTerminalChunk) {
       mActiveTaskId = nowtech::Chunk::cInvalidTaskId;
     }
@@ -95,30 +119,350 @@ nowtech::TransmitBuffers &nowtech::TransmitBuffers::operator<<(nowtech::Chunk co
   return *this;
 }
 
-void nowtech::TransmitBuffers::transmitIfNeeded() noexcept {
-  if(mChunkCount[mBufferToWrite] == 0) {
+void nowtech::TransmitBuffers::popDirectly() noexcept {
+  LogSizeType &index = mIndex[mBufferToWrite];
+  // The text of a single-chunk message lands right at index.
+  char * const destination = mBuffers[mBufferToWrite] + index - LogStorage::cTransmitBufferReserve;
+  char overwritten[LogStorage::cTransmitBufferReserve];
+  std::memcpy(overwritten, destination, LogStorage::cTransmitBufferReserve);
+  mWasTerminalChunk = false;
+  markHeaderStart();
+  if(mOsInterface.pop(destination)) {
+    TaskIdType const taskId = *reinterpret_cast<TaskIdType*>(destination);
+    char * const payload = destination + 1;
+    if(taskId != Chunk::cInvalidTaskId && payload[0] == Chunk::cFlushMarker) {
+      takeFlushMarker(destination);
+    }
+    else if(taskId != Chunk::cInvalidTaskId && payload[0] != Chunk::cAbortMessage) {
+      LogSizeType length = mChunkSize - 2;
+      if(payload[0] != Chunk::cSingleChunk) {
+        std::memmove(payload + 1, payload, mChunkSize - 1);
+        ++length;
+      }
+      else { // nothing to do
+      }
+      char * const text = mBuffers[mBufferToWrite] + index;
+      char * const end = static_cast<char*>(std::memchr(text, Chunk::cEndOfMessage, length));
+      if(end != nullptr) {
+        *end = Chunk::cEndOfLine;
+        index += end - text + 1;
+        mWasTerminalChunk = true;
+      }
+      else {
+        markMessageStart();
+        index += length;
+        mActiveTaskId = taskId;
+      }
+      ++mChunkCount[mBufferToWrite];
+      compactHeader();
+    }
+    else { // stray abort or invalid chunk, nothing to do
+    }
+  }
+  else { // nothing to do
+  }
+  if(!hasActiveTask()) {
+    mHeaderPending = false;
+  }
+  else { // nothing to do
+  }
+  std::memcpy(destination, overwritten, LogStorage::cTransmitBufferReserve);
+}
+
+nowtech::TransmitBuffers &nowtech::TransmitBuffers::operator<<(char const * const aText) noexcept {
+  char const *pointer = aText;
+  while(*pointer != 0) {
+    char * buffer = mBuffers[mBufferToWrite];
+    LogSizeType &index = mIndex[mBufferToWrite];
+    for(LogSizeType i = 1; i < mChunkSize && *pointer != 0; ++i) {
+      buffer[index] = *pointer;
+      ++index;
+      ++pointer;
+    }
+    ++mChunkCount[mBufferToWrite];
+    transmitIfNeeded();
+  }
+  return *this;
+}
+
+void nowtech::TransmitBuffers::abortActiveMessage() noexcept {
+  // The reader will not see the header of this message, so the next one can not refer to it.
+  mHeaderPending = false;
+  mKeyframeNeeded = true;
+  if(mMessageTransmitCount == mTransmitCount) {
+    mIndex[mBufferToWrite] = mMessageIndex;
+    mChunkCount[mBufferToWrite] = mMessageChunkCount;
+  }
+  else {
+    char * buffer = mBuffers[mBufferToWrite];
+    LogSizeType &index = mIndex[mBufferToWrite];
+    buffer[index] = Log::cSeparatorFailure;
+    ++index;
+    buffer[index] = Chunk::cEndOfLine;
+    ++index;
+    ++mChunkCount[mBufferToWrite];
+  }
+}
+
+void nowtech::TransmitBuffers::compactHeader() noexcept {
+  if(!mHeaderPending) {
+    return;
+  }
+  else if(mHeaderTransmitCount != mTransmitCount) {
+    // The header was split between two buffers, so it stays full.
+    mHeaderPending = false;
+    mKeyframeNeeded = true;
     return;
   }
+  else { // nothing to do
+  }
+  char * const buffer = mBuffers[mBufferToWrite];
+  LogSizeType &index = mIndex[mBufferToWrite];
+  // The tags stay in front of the header.
+  LogSizeType skipped = index > mHeaderIndex && buffer[mHeaderIndex] == Log::cSequenceTag ? Log::cSequenceTagLength : 0u;
+  skipped += index > mHeaderIndex + skipped && buffer[mHeaderIndex + skipped] == Log::cTopicTag ? Log::cTopicTagLength : 0u;
+  char * const start = buffer + mHeaderIndex + skipped;
+  LogSizeType const available = index > mHeaderIndex + skipped ? index - mHeaderIndex - skipped : 0u;
+  if(available == 0u) {
+    return;
+  }
+  else if(*start != Log::cHeaderKeyframe) {
+    // Message without header.
+    mHeaderPending = false;
+    return;
+  }
+  else { // nothing to do
+  }
+  char * const end = static_cast<char*>(std::memchr(start, ' ', available < cMaxHeaderLength ? available : cMaxHeaderLength));
+  if(end == nullptr) {
+    if(available >= cMaxHeaderLength || mWasTerminalChunk) {
+      mHeaderPending = false;
+      mKeyframeNeeded = true;
+    }
+    else { // the rest of the header is in the next chunk
+    }
+    return;
+  }
+  else { // nothing to do
+  }
+  mHeaderPending = false;
+  char const *field = start + 1;
+  if(end - field > 2 && field[0] == '0' && ((mTickBase == NumericSystem::cHexadecimal && field[1] == Log::cNumericMarkHexadecimal) || (mTickBase == NumericSystem::cBinary && field[1] == Log::cNumericMarkBinary))) {
+    // Prefix of LogConfig::appendBasePrefix, never a digit in this base.
+    field += 2;
+  }
+  else { // nothing to do
+  }
+  uint64_t tick = 0u;
+  bool const hasTick = field < end && *field != Log::cHeaderTask && *field != Log::cHeaderTopic;
+  while(field < end && *field != Log::cHeaderTask && *field != Log::cHeaderTopic) {
+    tick = tick * mTickBase + static_cast<uint64_t>(*field <= '9' ? *field - '0' : *field - 'a' + 10);
+    ++field;
+  }
+  char const *task = field;
+  if(field < end && *field == Log::cHeaderTask) {
+    ++task;
+    for(++field; field < end && *field != Log::cHeaderTopic; ++field) {
+    }
+  }
+  else { // nothing to do
+  }
+  LogSizeType const taskLength = static_cast<LogSizeType>(field - task);
+  char const *topic = field < end ? field + 1 : end;
+  LogSizeType const topicLength = static_cast<LogSizeType>(end - topic);
+  if(taskLength > cMaxHeaderField || topicLength > cMaxHeaderField) {
+    mKeyframeNeeded = true;
+    return;
+  }
+  else { // nothing to do
+  }
+  LogSizeType const fullLength = static_cast<LogSizeType>(end - start) + 1u;
+  bool keyframe = mKeyframeNeeded || (mKeyframePeriod > 0u && mSinceKeyframe + 1u >= mKeyframePeriod);
+  // sign, digits, 2 fields with their marks and the space
+  char compact[2u + std::numeric_limits<uint64_t>::digits + 2u * (cMaxHeaderField + 1u) + 1u];
+  LogSizeType length = 0u;
+  if(!keyframe) {
+    compact[length] = Log::cHeaderDelta;
+    ++length;
+    if(hasTick) {
+      int64_t const delta = static_cast<int64_t>(tick - mLastTick);
+      uint64_t magnitude = delta < 0 ? 0u - static_cast<uint64_t>(delta) : static_cast<uint64_t>(delta);
+      if(delta < 0) {
+        compact[length] = '-';
+        ++length;
+      }
+      else { // nothing to do
+      }
+      char digits[std::numeric_limits<uint64_t>::digits];
+      LogSizeType count = 0u;
+      do {
+        uint32_t const digit = static_cast<uint32_t>(magnitude % mTickBase);
+        digits[count] = static_cast<char>(digit < 10u ? '0' + digit : 'a' + digit - 10u);
+        ++count;
+        magnitude /= mTickBase;
+      } while(magnitude != 0u);
+      while(count > 0u) {
+        --count;
+        compact[length] = digits[count];
+        ++length;
+      }
+    }
+    else { // nothing to do
+    }
+    if(taskLength != std::strlen(mLastTask) || std::memcmp(task, mLastTask, taskLength) != 0) {
+      compact[length] = Log::cHeaderTask;
+      std::memcpy(compact + length + 1u, task, taskLength);
+      length += taskLength + 1u;
+    }
+    else { // nothing to do
+    }
+    if(topicLength != std::strlen(mLastTopic) || std::memcmp(topic, mLastTopic, topicLength) != 0) {
+      compact[length] = Log::cHeaderTopic;
+      std::memcpy(compact + length + 1u, topic, topicLength);
+      length += topicLength + 1u;
+    }
+    else { // nothing to do
+    }
+    compact[length] = ' ';
+    ++length;
+    keyframe = length >= fullLength;
+  }
+  else { // nothing to do
+  }
+  mLastTick = tick;
+  std::memcpy(mLastTask, task, taskLength);
+  mLastTask[taskLength] = 0;
+  std::memcpy(mLastTopic, topic, topicLength);
+  mLastTopic[topicLength] = 0;
+  if(keyframe) {
+    mSinceKeyframe = 0u;
+    mKeyframeNeeded = false;
+  }
   else {
-    if(mChunkCount[mBufferToWrite] == mBufferLength) {
-      while(mTransmitInProgress.load() == true) {
+    ++mSinceKeyframe;
+    std::memcpy(start, compact, length);
+    std::memmove(start + length, end + 1, static_cast<size_t>(buffer + index - (end + 1)));
+    index -= fullLength - length;
+  }
+}
+
+void nowtech::TransmitBuffers::transmitIfNeeded() noexcept {
+  if(mChunkCount[mBufferToWrite] == mBufferLength) {
+    while(mInFlightCount + mReadyCount + 1u == mBufferCount) {
+      if(mTransmitInProgress.load() == true) {
         mOsInterface.pause();
       }
-      mRefreshNeeded.store(true);
+      else if(mInFlightCount > 0) {
+        releaseTransmitted();
+      }
+      else {
+        transmitReady();
+      }
+    }
+    advanceBufferToWrite();
+  }
+  else { // nothing to do
+  }
+  if(mTransmitInProgress.load() == false) {
+    releaseTransmitted();
+    bool const refresh = mRefreshNeeded.load() && mChunkCount[mBufferToWrite] > 0 && mReadyCount + 1u < mBufferCount;
+    if(refresh) {
+      advanceBufferToWrite();
     }
     else { // nothing to do
     }
-    if(mTransmitInProgress.load() == false && mRefreshNeeded.load() == true) {
-      mTransmitInProgress.store(true);
-      mOsInterface.transmit(mBuffers[mBufferToWrite], mIndex[mBufferToWrite], &mTransmitInProgress);
-      mBufferToWrite = 1 - mBufferToWrite;
-      mIndex[mBufferToWrite] = 0;
-      mChunkCount[mBufferToWrite] = 0;
+    transmitReady();
+    if(refresh) {
       mRefreshNeeded.store(false);
       mOsInterface.startRefreshTimer(&mRefreshNeeded);
     }
     else { // nothing to do
     }
   }
+  else { // nothing to do
+  }
 }
 
+void nowtech::TransmitBuffers::drain(LogCrashWrite const aWrite) const noexcept {
+  // The buffers handed over to the OsInterface are its business.
+  LogSizeType buffer = mOldestBuffer;
+  for(LogSizeType i = 0; i < mInFlightCount; ++i) {
+    buffer = next(buffer);
+  }
+  for(LogSizeType i = 0; i <= mReadyCount; ++i) {
+    if(mIndex[buffer] > 0u) {
+      aWrite(mBuffers[buffer], mIndex[buffer]);
+    }
+    else { // nothing to do
+    }
+    buffer = next(buffer);
+  }
+}
+
+void nowtech::TransmitBuffers::takeFlushMarker(char const * const aChunk) noexcept {
+  std::memcpy(&mFlushTicket, aChunk + 2, sizeof(mFlushTicket));
+  mFlushPending = true;
+  if(mChunkCount[mBufferToWrite] > 0) {
+    // The buffer to write must be closed as well.
+    mFlushTarget = mTransmitCount + 1u;
+    mRefreshNeeded.store(true);
+  }
+  else {
+    mFlushTarget = mTransmitCount;
+  }
+  completeFlush();
+}
+
+void nowtech::TransmitBuffers::completeFlush() noexcept {
+  if(mFlushPending && mReleasedCount >= mFlushTarget && mFlushCompleted != nullptr) {
+    mFlushCompleted->store(mFlushTicket);
+    mFlushPending = false;
+  }
+  else { // nothing to do
+  }
+}
+
+void nowtech::TransmitBuffers::releaseTransmitted() noexcept {
+  if(mInFlightCount > 0 && mTransmitInProgress.load() == false) {
+    for(LogSizeType i = 0; i < mInFlightCount; ++i) {
+      mOldestBuffer = next(mOldestBuffer);
+    }
+    mReleasedCount += mInFlightCount;
+    mInFlightCount = 0;
+    completeFlush();
+  }
+  else { // nothing to do
+  }
+}
+
+void nowtech::TransmitBuffers::advanceBufferToWrite() noexcept {
+  ++mReadyCount;
+  ++mTransmitCount;
+  mBufferToWrite = next(mBufferToWrite);
+  mIndex[mBufferToWrite] = 0;
+  mChunkCount[mBufferToWrite] = 0;
+}
+
+void nowtech::TransmitBuffers::transmitReady() noexcept {
+  releaseTransmitted();
+  if(mInFlightCount == 0 && mReadyCount > 0) {
+    LogSizeType const count = mReadyCount < mGatherLimit ? mReadyCount : mGatherLimit;
+    LogSizeType buffer = mOldestBuffer;
+    for(LogSizeType i = 0; i < count; ++i) {
+      mSlices[i].buffer = mBuffers[buffer];
+      mSlices[i].length = mIndex[buffer];
+      buffer = next(buffer);
+    }
+    mInFlightCount = count;
+    mReadyCount -= count;
+    mTransmitInProgress.store(true);
+    if(count == 1u) {
+      mOsInterface.transmit(mSlices[0].buffer, mSlices[0].length, &mTransmitInProgress);
+    }
+    else {
+      mOsInterface.transmitGathered(mSlices, count, &mTransmitInProgress);
+    }
+  }
+  else { // nothing to do
+  }
+}
@@ -37,6 +37,8 @@ namespace nowtech {
     /// Counted in chunks
     LogSizeType const mBufferLength;
     LogSizeType const mChunkSize;
+    /// True if mBuffer was allocated here.
+    bool const mOwned;
     char * const mBuffer;
     Chunk mStuffStart;
     Chunk mStuffEnd;
@@ -46,11 +48,13 @@ namespace nowtech {
     Chunk mFound;
 
   public:
-    CircularBuffer(LogOsInterface &aOsInterface, LogSizeType const aBufferLength, LogSizeType const aChunkSize) noexcept
+    /// @param aMemory aBufferLength * aChunkSize bytes, or nullptr to allocate them.
+    CircularBuffer(LogOsInterface &aOsInterface, LogSizeType const aBufferLength, LogSizeType const aChunkSize, char * const aMemory) noexcept
       : mOsInterface(aOsInterface)
       , mBufferLength(aBufferLength)
       , mChunkSize(aChunkSize)
-      , mBuffer(new char[aBufferLength * aChunkSize])
+      , mOwned(aMemory == nullptr)
+      , mBuffer(mOwned ? new char[aBufferLength * aChunkSize] : aMemory)
       , mStuffStart(&aOsInterface, mBuffer, aBufferLength, Chunk::cInvalidTaskId)
       , mStuffEnd(&aOsInterface, mBuffer, aBufferLength, Chunk::cInvalidTaskId)
       , mFound(&aOsInterface, mBuffer, aBufferLength, Chunk::cInvalidTaskId) {
@@ -58,7 +62,11 @@ namespace nowtech {
 
     /// Not intended to be destroyed
     ~CircularBuffer() {
-      delete[] mBuffer;
+      if(mOwned) {
+        delete[] mBuffer;
+      }
+      else { // nothing to do
+      }
     }
 
     bool isEmpty() const noexcept {
@@ -69,6 +77,10 @@ namespace nowtech {
       return mCount == mBufferLength;
     }
 
+    LogSizeType getCount() const noexcept {
+      return mCount;
+    }
+
     bool isInspected() const noexcept {
       return mInspected;
     }
@@ -111,39 +123,115 @@ namespace nowtech {
   /// Auxiliary class, not part of the Log API.
   class TransmitBuffers final : public BanCopyMove {
   private:
+    /// Full headers longer than this, or with longer task or topic names are
+    /// left as they are in compact header mode.
+    static constexpr LogSizeType cMaxHeaderField  = 24u;
+    /// Keyframe mark, 64-bit tick, 2 fields with their marks and the space.
+    static constexpr LogSizeType cMaxHeaderLength = 1u + std::numeric_limits<uint64_t>::digits10 + 1u + 2u * (cMaxHeaderField + 1u) + 1u;
+
     LogOsInterface &mOsInterface;
 
     /// counted in chunks
     LogSizeType const mBufferLength;
     LogSizeType const mChunkSize;
+    LogSizeType const mBufferCount;
+    LogSizeType const mGatherLimit;
+    /// True if the buffers were allocated here, not given in a LogStorage.
+    bool const mOwned;
+    char ** const mBuffers;
+    LogSizeType * const mChunkCount;
+    LogSizeType * const mIndex;
+    LogBufferSlice * const mSlices;
+
+    /// The ring consists of the buffers handed over to the OsInterface, the
+    /// full ones waiting for transmission and the buffer to write, in this
+    /// order starting at mOldestBuffer.
+    LogSizeType mOldestBuffer = 0;
+    LogSizeType mInFlightCount = 0;
+    LogSizeType mReadyCount = 0;
     LogSizeType mBufferToWrite = 0;
-    char * mBuffers[2];
-    LogSizeType mChunkCount[2] = {
-      0,0
-    };
-    LogSizeType mIndex[2] = {
-      0,0
-    };
     uint8_t mActiveTaskId = Chunk::cInvalidTaskId;
     bool mWasTerminalChunk = false;
+
+    /// Number of times the buffer to write was replaced so far, used to tell
+    /// if the beginning of the active message is still in the buffer to write.
+    LogSizeType mTransmitCount = 0;
+
+    /// Where the active message starts, to let it be discarded on abort.
+    LogSizeType mMessageTransmitCount = 0;
+    LogSizeType mMessageIndex = 0;
+    LogSizeType mMessageChunkCount = 0;
     std::atomic<bool> mTransmitInProgress;
     std::atomic<bool> mRefreshNeeded;
 
+    /// See LogConfig::compactHeader. The header of the active message is
+    /// shortened as soon as it has completely arrived, if it is still in the
+    /// buffer to write.
+    bool mCompactHeader = false;
+    uint8_t mTickBase = NumericSystem::cDecimal;
+    uint32_t mKeyframePeriod = 0u;
+    uint32_t mSinceKeyframe = 0u;
+    bool mKeyframeNeeded = true;
+    bool mHeaderPending = false;
+    LogSizeType mHeaderTransmitCount = 0;
+    LogSizeType mHeaderIndex = 0;
+    uint64_t mLastTick = 0u;
+    char mLastTask[cMaxHeaderField + 1u] = {};
+    char mLastTopic[cMaxHeaderField + 1u] = {};
+
+    /// See Log::flush(). The ticket of the last flush marker is stored into
+    /// mFlushCompleted once the buffers closed before mFlushTarget are
+    /// transmitted.
+    std::atomic<uint32_t> *mFlushCompleted = nullptr;
+    uint32_t mFlushTicket = 0u;
+    bool mFlushPending = false;
+    LogSizeType mFlushTarget = 0;
+    LogSizeType mReleasedCount = 0;
+
   public:
-    TransmitBuffers(LogOsInterface &aOsInterface, LogSizeType const aBufferLength, LogSizeType const aChunkSize) noexcept
+    /// @param aStorage gives the buffers for aBufferCount, at least 2, or
+    /// nullptr to allocate them.
+    TransmitBuffers(LogOsInterface &aOsInterface, LogSizeType const aBufferLength, LogSizeType const aBufferCount, LogSizeType const aChunkSize, LogStorage const * const aStorage) noexcept
       : mOsInterface(aOsInterface)
       , mBufferLength(aBufferLength)
-      , mChunkSize(aChunkSize) {
-      mBuffers[0] = new char[aBufferLength * (aChunkSize - 1)];
-      mBuffers[1] = new char[aBufferLength * (aChunkSize - 1)];
+      , mChunkSize(aChunkSize)
+      , mBufferCount(aBufferCount < 2u ? 2u : aBufferCount)
+      , mGatherLimit(aOsInterface.getGatherLimit() < mBufferCount ? aOsInterface.getGatherLimit() : mBufferCount)
+      , mOwned(aStorage == nullptr)
+      , mBuffers(mOwned ? new char*[mBufferCount] : aStorage->transmitBufferStarts)
+      , mChunkCount(mOwned ? new LogSizeType[mBufferCount] : aStorage->transmitChunkCounts)
+      , mIndex(mOwned ? new LogSizeType[mBufferCount] : aStorage->transmitIndices)
+      , mSlices(mOwned ? new LogBufferSlice[mBufferCount] : aStorage->transmitSlices) {
+      LogSizeType const bufferSize = LogStorage::getTransmitBufferSize(aBufferLength, aChunkSize);
+      for(LogSizeType i = 0; i < mBufferCount; ++i) {
+        mBuffers[i] = (mOwned ? new char[bufferSize] : aStorage->transmitBuffers + i * bufferSize) + LogStorage::cTransmitBufferReserve;
+        mChunkCount[i] = 0u;
+        mIndex[i] = 0u;
+        mSlices[i].buffer = mBuffers[i] - LogStorage::cTransmitBufferReserve;
+        mSlices[i].length = bufferSize;
+      }
+      mOsInterface.registerTransmitBuffers(mSlices, mBufferCount);
       mTransmitInProgress.store(false);
       mRefreshNeeded.store(false);
       mOsInterface.startRefreshTimer(&mRefreshNeeded);
     }
 
     ~TransmitBuffers() noexcept {
-      delete[] mBuffers[0];
-      delete[] mBuffers[1];
+      // The sink may still be reading the buffers.
+      while(mTransmitInProgress.load() == true) {
+        mOsInterface.pause();
+      }
+      if(mOwned) {
+        for(LogSizeType i = 0; i < mBufferCount; ++i) {
+          delete[] (mBuffers[i] - LogStorage::cTransmitBufferReserve);
+        }
+        delete[] mBuffers;
+        delete[] mChunkCount;
+        delete[] mIndex;
+        delete[] mSlices;
+      }
+      else { // nothing to do
+      }
     }
 
     bool hasActiveTask() const noexcept {
@@ -158,10 +246,85 @@ namespace nowtech {
       return mWasTerminalChunk;
     }
 
+    bool isTransmitting() const noexcept {
+      return mTransmitInProgress.load();
+    }
+
+    /// Writes the contents of the ready buffers and the buffer to write with
+    /// aWrite, for Log::drainAfterCrash().
+    void drain(LogCrashWrite const aWrite) const noexcept;
+
+    /// Turns on shortening the headers, see LogConfig::compactHeader.
+    void enableCompactHeader(uint8_t const aTickBase, uint32_t const aKeyframePeriod) noexcept {
+      mCompactHeader = true;
+      mTickBase = aTickBase;
+      mKeyframePeriod = aKeyframePeriod;
+    }
+
+    /// Lets flush markers be answered, see Log::flush().
+    void enableFlush(std::atomic<uint32_t> *aFlushCompleted) noexcept {
+      mFlushCompleted = aFlushCompleted;
+    }
+
     /// Assumes that the buffer to write has space for it
     TransmitBuffers &operator<<(Chunk const &aChunk) noexcept;
 
+    /// Fast path for the case when there is no active task and the
+    /// CircularBuffer is empty. Pops the next chunk right into the buffer to
+    /// write. If it is a complete message marked with Chunk::cSingleChunk, it
+    /// is simply kept there. Otherwise it starts a new active message, unless
+    /// it is complete as well.
+    void popDirectly() noexcept;
+
+    /// Appends a zero-terminated text generated by the transmitter itself.
+    /// Must be called only when there is no active task.
+    TransmitBuffers &operator<<(char const * const aText) noexcept;
+
     void transmitIfNeeded() noexcept;
+
+  private:
+    /// Remembers where the message starting now begins.
+    void markMessageStart() noexcept {
+      mMessageTransmitCount = mTransmitCount;
+      mMessageIndex = mIndex[mBufferToWrite];
+      mMessageChunkCount = mChunkCount[mBufferToWrite];
+    }
+
+    /// Discards the active message if it is still completely in the buffer
+    /// to write, or terminates it with a truncation mark otherwise.
+    void abortActiveMessage() noexcept;
+
+    /// Remembers where the header of the message starting now begins.
+    void markHeaderStart() noexcept {
+      mHeaderPending = mCompactHeader;
+      mHeaderTransmitCount = mTransmitCount;
+      mHeaderIndex = mIndex[mBufferToWrite];
+    }
+
+    /// Replaces the full header of the active message with a compact one,
+    /// once it has arrived, and updates the state used for the next one.
+    void compactHeader() noexcept;
+
+    LogSizeType next(LogSizeType const aIndex) const noexcept {
+      return aIndex + 1u == mBufferCount ? 0u : aIndex + 1u;
+    }
+
+    /// Sets the target of the flush marker in aChunk, and makes the data
+    /// before it transmitted soon.
+    void takeFlushMarker(char const * const aChunk) noexcept;
+
+    /// Reports the pending flush if its target is reached.
+    void completeFlush() noexcept;
+
+    /// Returns the buffers the OsInterface has finished with to the ring.
+    void releaseTransmitted() noexcept;
+
+    /// Closes the buffer to write, makes it ready and starts writing the
+    /// next free one. There must be a free buffer.
+    void advanceBufferToWrite() noexcept;
+
+    /// Hands over as many ready buffers as the OsInterface accepts at once.
+    void transmitReady() noexcept;
   };
 
 } // namespace nowtech
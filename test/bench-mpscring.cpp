@@ -0,0 +1,129 @@
+/*
+ * Copyright 2018 Now Technologies Zrt.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+ * THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "LogMpscRing.h"
+#include <boost/lockfree/queue.hpp>
+#include <algorithm>
+#include <iostream>
+#include <cstdint>
+#include <chrono>
+#include <thread>
+
+// clang++ -std=c++14 -Isrc test/bench-mpscring.cpp -lpthread -O2 -o bench-mpscring
+// Compares LogMpscRing with the previous queue of LogStdThreadOstream, which
+// needed Boost only for this benchmark.
+
+constexpr size_t   cSlotCount      = 64u;
+constexpr size_t   cChunkSize      = 8u;
+constexpr int32_t  cChunksPerThread = 200000;
+constexpr int32_t  cMaxThreadCount  = 8;
+
+/// The previous solution: a queue of pointers into a slab and a free-list.
+class BoostQueue final {
+  boost::lockfree::queue<char *> mQueue;
+  boost::lockfree::queue<char *> mFreeList;
+  char *mBuffer;
+
+public:
+  BoostQueue(size_t const aSlotCount, size_t const aChunkSize)
+  : mQueue(aSlotCount)
+  , mFreeList(aSlotCount)
+  , mBuffer(new char[aSlotCount * aChunkSize]) {
+    for(size_t i = 0u; i < aSlotCount; ++i) {
+      mFreeList.bounded_push(mBuffer + i * aChunkSize);
+    }
+  }
+
+  ~BoostQueue() {
+    delete[] mBuffer;
+  }
+
+  bool tryPush(char const * const aChunkStart) noexcept {
+    char *payload;
+    bool result = mFreeList.pop(payload);
+    if(result) {
+      std::copy(aChunkStart, aChunkStart + cChunkSize, payload);
+      mQueue.bounded_push(payload);
+    }
+    else { // nothing to do
+    }
+    return result;
+  }
+
+  bool tryPop(char * const aChunkStart) noexcept {
+    char *payload;
+    bool result = mQueue.pop(payload);
+    if(result) {
+      std::copy(payload, payload + cChunkSize, aChunkStart);
+      mFreeList.bounded_push(payload);
+    }
+    else { // nothing to do
+    }
+    return result;
+  }
+};
+
+template<typename tQueue>
+void produce(tQueue *aQueue, int32_t const aId) {
+  char chunk[cChunkSize] = { static_cast<char>(aId + 1) };
+  for(int32_t i = 0; i < cChunksPerThread; ++i) {
+    while(!aQueue->tryPush(chunk)) {
+      std::this_thread::yield();
+    }
+  }
+}
+
+template<typename tQueue>
+double measure(int32_t const aThreadCount) {
+  tQueue queue(cSlotCount, cChunkSize);
+  std::thread threads[cMaxThreadCount];
+  auto start = std::chrono::steady_clock::now();
+  for(int32_t i = 0; i < aThreadCount; ++i) {
+    threads[i] = std::thread(produce<tQueue>, &queue, i);
+  }
+  char chunk[cChunkSize];
+  int64_t remaining = static_cast<int64_t>(aThreadCount) * cChunksPerThread;
+  while(remaining > 0) {
+    if(queue.tryPop(chunk)) {
+      --remaining;
+    }
+    else {
+      std::this_thread::yield();
+    }
+  }
+  for(int32_t i = 0; i < aThreadCount; ++i) {
+    threads[i].join();
+  }
+  std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+  return elapsed.count() / (static_cast<double>(aThreadCount) * cChunksPerThread);
+}
+
+int main() {
+  std::cout << "producers  LogMpscRing ns/chunk  boost::lockfree ns/chunk\n";
+  for(int32_t threadCount = 1; threadCount <= cMaxThreadCount; threadCount *= 2) {
+    double const ring = measure<nowtech::LogMpscRing>(threadCount);
+    double const boost = measure<BoostQueue>(threadCount);
+    std::cout << threadCount << "          " << ring << "                 " << boost << '\n';
+  }
+  return 0;
+}
@@ -0,0 +1,140 @@
+/*
+ * Copyright 2018 Now Technologies Zrt.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+ * THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "LogPosix.h"
+#include "LogStaticStorage.h"
+#include <pthread.h>
+#include <unistd.h>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+// clang++ -std=c++14 -Isrc src/Log.cpp src/LogPosix.cpp src/LogFdSink.cpp src/LogFutexQueue.cpp src/LogShmRing.cpp src/LogTscClock.cpp src/LogUtil.cpp test/test-noheap.cpp -lpthread -g3 -Og -o test-noheap
+
+// Every heap allocation through operator new is counted.
+std::atomic<uint32_t> gAllocationCount(0u);
+
+void *operator new(std::size_t aSize) {
+  gAllocationCount.fetch_add(1u);
+  void *result = std::malloc(aSize == 0u ? 1u : aSize);
+  if(result == nullptr) {
+    throw std::bad_alloc();
+  }
+  else { // nothing to do
+  }
+  return result;
+}
+
+void *operator new[](std::size_t aSize) {
+  return operator new(aSize);
+}
+
+void *operator new(std::size_t aSize, std::nothrow_t const &) noexcept {
+  gAllocationCount.fetch_add(1u);
+  return std::malloc(aSize == 0u ? 1u : aSize);
+}
+
+void *operator new[](std::size_t aSize, std::nothrow_t const &aNothrow) noexcept {
+  return operator new(aSize, aNothrow);
+}
+
+void operator delete(void *aPointer) noexcept {
+  std::free(aPointer);
+}
+
+void operator delete[](void *aPointer) noexcept {
+  std::free(aPointer);
+}
+
+void operator delete(void *aPointer, std::size_t) noexcept {
+  std::free(aPointer);
+}
+
+void operator delete[](void *aPointer, std::size_t) noexcept {
+  std::free(aPointer);
+}
+
+constexpr int32_t threadCount = 4;
+
+char names[threadCount][10] = {
+  "thread_0",
+  "thread_1",
+  "thread_2",
+  "thread_3"
+};
+
+namespace nowtech {
+namespace LogTopics {
+LogTopicInstance system;
+}
+}
+
+typedef nowtech::LogStaticStorage<16u, 64u, 64u, 32u, 4u> Storage;
+
+// All the buffers of the Log and the queue live here instead of the heap.
+Storage storage;
+
+// std::thread would allocate its state.
+void *logFromThread(void *aArgument) {
+  int32_t const n = static_cast<int32_t>(reinterpret_cast<intptr_t>(aArgument));
+  Log::registerCurrentTask(names[n]);
+  for(int64_t i = 0; i < 100; ++i) {
+    Log::send(*nowtech::LogTopics::system, n, ". thread variadic: ", i);
+    Log::i(nowtech::LogTopics::system) << n << ". thread shift chain: " << LC::cX4 << i << Log::end;
+  }
+  return nullptr;
+}
+
+int main() {
+  nowtech::LogConfig logConfig;
+  Storage::applyTo(logConfig);
+  logConfig.taskRepresentation = nowtech::LogConfig::TaskRepresentation::cName;
+  logConfig.refreshPeriod      = 200u;
+  uint32_t const allocationsBefore = gAllocationCount.load();
+  {
+    nowtech::LogFdSink sink(STDOUT_FILENO);
+    nowtech::LogPosix osInterface(sink, logConfig, storage);
+    nowtech::Log log(osInterface, logConfig, storage);
+    Log::registerTopic(nowtech::LogTopics::system, "system");
+    Log::registerCurrentTask("main");
+
+    uint64_t const uint64 = 123456789012345;
+    int64_t const int64 = -123456789012345;
+    Log::send(*nowtech::LogTopics::system, "uint64: ", uint64, " int64: ", int64);
+    Log::i() << "double: " << 3.14159 << " bool: " << true << Log::end;
+
+    pthread_t threads[threadCount];
+    for(int32_t i = 0; i < threadCount; ++i) {
+      pthread_create(threads + i, nullptr, logFromThread, reinterpret_cast<void*>(static_cast<intptr_t>(i)));
+    }
+    for(int32_t i = 0; i < threadCount; ++i) {
+      pthread_join(threads[i], nullptr);
+    }
+    Log::flush(1000u);
+  }
+  uint32_t const allocations = gAllocationCount.load() - allocationsBefore;
+  std::fprintf(stderr, "heap allocations from construction to destruction: %u\n", allocations);
+  return allocations == 0u ? EXIT_SUCCESS : EXIT_FAILURE;
+}
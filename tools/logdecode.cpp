@@ -0,0 +1,501 @@
+/*
+ * Copyright 2018 Now Technologies Zrt.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+ * THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "LogBinary.h"
+#include <elf.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <string>
+#include <vector>
+
+// clang++ -std=c++14 -Isrc tools/logdecode.cpp -O2 -o logdecode
+// Usage: logdecode [-p] [-s] [-r] <executable or dictionary> [log file]
+// Restores the text of a log written with LogConfig::binaryFormat. The
+// literals come from the nowtech_log_dict section of the executable, or from a
+// file extracted by objcopy --dump-section nowtech_log_dict=dict.bin app
+// -p and -s correspond to LogConfig::appendBasePrefix and alignSigned.
+// -r renders the ticks relative to the first one in the log, which is
+// useful with LogConfig::TickSource::cNanoseconds.
+// Textual lines, like the ones about dropped messages, are copied as they are.
+// Messages aborted by the transmitter end in @.
+
+namespace {
+
+  char const cSectionName[] = "nowtech_log_dict";
+  char const cDigit2char[] = "0123456789abcdef";
+  char const cSeparatorFailure = '@';
+
+  bool gBasePrefix = false;
+  bool gAlignSigned = false;
+  bool gRelativeTick = false;
+  bool gHasTickOrigin = false;
+  uint64_t gTickOrigin = 0u;
+
+  template<typename Header, typename Section>
+  bool findSection(std::vector<char> const &aFile, std::string &aResult) {
+    if(aFile.size() < sizeof(Header)) {
+      return false;
+    }
+    Header header;
+    std::memcpy(&header, aFile.data(), sizeof(header));
+    if(header.e_shoff == 0u || header.e_shoff + static_cast<uint64_t>(header.e_shnum) * sizeof(Section) > aFile.size() || header.e_shstrndx >= header.e_shnum) {
+      return false;
+    }
+    std::vector<Section> sections(header.e_shnum);
+    std::memcpy(sections.data(), aFile.data() + header.e_shoff, sections.size() * sizeof(Section));
+    Section const &names = sections[header.e_shstrndx];
+    for(auto const &section : sections) {
+      uint64_t const nameOffset = static_cast<uint64_t>(names.sh_offset) + section.sh_name;
+      if(nameOffset + sizeof(cSectionName) <= aFile.size() && std::memcmp(aFile.data() + nameOffset, cSectionName, sizeof(cSectionName)) == 0) {
+        if(section.sh_offset + section.sh_size > aFile.size()) {
+          return false;
+        }
+        aResult.assign(aFile.data() + section.sh_offset, section.sh_size);
+        return true;
+      }
+    }
+    return false;
+  }
+
+  bool loadDictionary(char const * const aPath, std::map<uint32_t, std::string> &aDictionary) {
+    std::ifstream in(aPath, std::ios::binary);
+    if(!in) {
+      return false;
+    }
+    std::vector<char> file((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    std::string contents;
+    if(file.size() >= EI_NIDENT && std::memcmp(file.data(), ELFMAG, SELFMAG) == 0) {
+      bool const found = file[EI_CLASS] == ELFCLASS64 ? findSection<Elf64_Ehdr, Elf64_Shdr>(file, contents) : findSection<Elf32_Ehdr, Elf32_Shdr>(file, contents);
+      if(!found) {
+        std::fprintf(stderr, "%s has no %s section\n", aPath, cSectionName);
+        return false;
+      }
+    }
+    else {
+      contents.assign(file.begin(), file.end());
+    }
+    size_t start = 0u;
+    while(start < contents.size()) {
+      size_t end = contents.find('\0', start);
+      if(end == std::string::npos) {
+        end = contents.size();
+      }
+      std::string const text = contents.substr(start, end - start);
+      uint32_t const id = nowtech::logLiteralId(text.c_str());
+      auto found = aDictionary.find(id);
+      if(found == aDictionary.end()) {
+        aDictionary.emplace(id, text);
+      }
+      else if(found->second != text) {
+        std::fprintf(stderr, "ID collision: \"%s\" and \"%s\"\n", found->second.c_str(), text.c_str());
+      }
+      else { // nothing to do
+      }
+      start = end + 1u;
+    }
+    return true;
+  }
+
+  class Parser final {
+    std::string const &mRecord;
+    size_t mIndex = 0u;
+
+  public:
+    explicit Parser(std::string const &aRecord) : mRecord(aRecord) {
+    }
+
+    bool isEnd() const {
+      return mIndex == mRecord.size();
+    }
+
+    bool byte(uint8_t &aResult) {
+      if(mIndex < mRecord.size()) {
+        aResult = static_cast<uint8_t>(mRecord[mIndex]);
+        ++mIndex;
+        return true;
+      }
+      else {
+        return false;
+      }
+    }
+
+    bool varint(uint64_t &aResult) {
+      aResult = 0u;
+      uint8_t value;
+      for(uint32_t shift = 0u; shift < 64u; shift += 7u) {
+        if(!byte(value)) {
+          return false;
+        }
+        aResult |= static_cast<uint64_t>(value & 0x7fu) << shift;
+        if((value & 0x80u) == 0u) {
+          return true;
+        }
+      }
+      return false;
+    }
+
+    bool littleEndian(uint64_t &aResult, uint8_t const aBytes) {
+      aResult = 0u;
+      uint8_t value;
+      for(uint8_t i = 0u; i < aBytes; ++i) {
+        if(!byte(value)) {
+          return false;
+        }
+        aResult |= static_cast<uint64_t>(value) << (i * 8u);
+      }
+      return true;
+    }
+
+    bool string(std::string &aResult) {
+      uint64_t length;
+      if(!varint(length) || length > mRecord.size() - mIndex) {
+        return false;
+      }
+      aResult = mRecord.substr(mIndex, length);
+      mIndex += length;
+      return true;
+    }
+  };
+
+  // Same as Log::append(T value, T base, uint8_t fill).
+  void renderInteger(std::string &aOutput, uint64_t const aMagnitude, bool const aNegative, uint8_t const aBase, uint8_t const aFill) {
+    if(aBase == 0u) {
+      aOutput += '#';
+      return;
+    }
+    uint32_t const base = aBase == nowtech::LogBinary::cBaseBinary ? 2u : (aBase == nowtech::LogBinary::cBaseDecimal ? 10u : 16u);
+    if(gBasePrefix && base == 2u) {
+      aOutput += "0b";
+    }
+    else if(gBasePrefix && base == 16u) {
+      aOutput += "0x";
+    }
+    else { // nothing to do
+    }
+    std::string digits;
+    uint64_t value = aMagnitude;
+    do {
+      digits += cDigit2char[value % base];
+      value /= base;
+    } while(value != 0u);
+    if(aNegative) {
+      aOutput += '-';
+    }
+    else if(gAlignSigned && aFill > 0u) {
+      aOutput += ' ';
+    }
+    else { // nothing to do
+    }
+    if(aFill > digits.size()) {
+      aOutput.append(aFill - digits.size(), '0');
+    }
+    else { // nothing to do
+    }
+    aOutput.append(digits.rbegin(), digits.rend());
+  }
+
+  // Same as Log::append(double value, uint8_t digits).
+  void renderDouble(std::string &aOutput, double const aValue, uint8_t const aDigitsNeeded) {
+    if(std::isnan(aValue)) {
+      aOutput += "nan";
+      return;
+    }
+    else if(std::isinf(aValue)) {
+      aOutput += "inf";
+      return;
+    }
+    else if(aValue == 0.0) {
+      aOutput += '0';
+      return;
+    }
+    else { // nothing to do
+    }
+    double value = aValue;
+    if(value < 0) {
+      value = -value;
+      aOutput += '-';
+    }
+    else if(gAlignSigned) {
+      aOutput += ' ';
+    }
+    else { // nothing to do
+    }
+    double const mantissa = std::floor(std::log10(value));
+    double normalized = value / std::pow(10.0, mantissa);
+    int firstDigit;
+    for(uint8_t i = 1u; i < aDigitsNeeded; i++) {
+      firstDigit = std::min(static_cast<int>(normalized), 9);
+      aOutput += cDigit2char[firstDigit];
+      normalized = 10.0 * (normalized - firstDigit);
+      if(i == 1u) {
+        aOutput += '.';
+      }
+      else { // nothing to do
+      }
+    }
+    firstDigit = std::min(static_cast<int>(std::round(normalized)), 9);
+    aOutput += cDigit2char[firstDigit];
+    aOutput += 'e';
+    if(mantissa >= 0) {
+      aOutput += '+';
+    }
+    else { // nothing to do
+    }
+    int32_t const exponent = static_cast<int32_t>(mantissa);
+    renderInteger(aOutput, static_cast<uint64_t>(exponent < 0 ? -static_cast<int64_t>(exponent) : exponent), exponent < 0, nowtech::LogBinary::cBaseDecimal, 0u);
+  }
+
+  /// @return true if the whole record was decoded.
+  // Same as Log::appendWallClock.
+  void renderWallClock(std::string &aOutput, uint64_t const aNs, uint8_t const aDigits, bool const aLocal, int64_t const aOffset) {
+    time_t const second = static_cast<time_t>(static_cast<int64_t>(aNs / 1000000000u) + aOffset);
+    tm calendar;
+    gmtime_r(&second, &calendar);
+    char buffer[48];
+    std::strftime(buffer, sizeof(buffer), "%Y-%m-%dT%H:%M:%S", &calendar);
+    aOutput += buffer;
+    if(aDigits > 0u && aDigits <= 9u) {
+      std::snprintf(buffer, sizeof(buffer), ".%09u", static_cast<uint32_t>(aNs % 1000000000u));
+      aOutput.append(buffer, aDigits + 1u);
+    }
+    else { // nothing to do
+    }
+    if(aLocal) {
+      int64_t const minutes = (aOffset < 0 ? -aOffset : aOffset) / 60;
+      std::snprintf(buffer, sizeof(buffer), "%c%02d:%02d", aOffset < 0 ? '-' : '+', static_cast<int>(minutes / 60), static_cast<int>(minutes % 60));
+      aOutput += buffer;
+    }
+    else {
+      aOutput += 'Z';
+    }
+  }
+
+  bool decode(std::string const &aRecord, std::map<uint32_t, std::string> const &aDictionary, std::string &aOutput) {
+    using nowtech::LogBinary;
+    Parser parser(aRecord);
+    while(!parser.isEnd()) {
+      uint8_t tag = 0u;
+      parser.byte(tag);
+      uint8_t const type = tag >> LogBinary::cTypeShift;
+      uint8_t const base = (tag >> LogBinary::cBaseShift) & LogBinary::cBaseMask;
+      bool const follows = (tag & LogBinary::cFollowsFlag) != 0u;
+      uint8_t fill = 0u;
+      if(follows && type != LogBinary::cBool && !parser.byte(fill)) {
+        return false;
+      }
+      else { // nothing to do
+      }
+      uint64_t value;
+      std::string text;
+      switch(type) {
+      case LogBinary::cUnsigned:
+      case LogBinary::cTaskId:
+        if(!parser.varint(value)) {
+          return false;
+        }
+        renderInteger(aOutput, value, false, base, fill);
+        break;
+      case LogBinary::cWallClock: {
+        uint64_t offset = 0u;
+        bool const local = base == LogBinary::cWallClockLocal;
+        if(!parser.varint(value) || (local && !parser.varint(offset))) {
+          return false;
+        }
+        renderWallClock(aOutput, value, fill, local, static_cast<int64_t>(offset >> 1u) ^ -static_cast<int64_t>(offset & 1u));
+        break;
+      }
+      case LogBinary::cTick:
+        if(!parser.varint(value)) {
+          return false;
+        }
+        if(gRelativeTick) {
+          if(!gHasTickOrigin) {
+            gTickOrigin = value;
+            gHasTickOrigin = true;
+          }
+          else { // nothing to do
+          }
+          renderInteger(aOutput, value >= gTickOrigin ? value - gTickOrigin : gTickOrigin - value, value < gTickOrigin, base, fill);
+        }
+        else {
+          renderInteger(aOutput, value, false, base, fill);
+        }
+        break;
+      case LogBinary::cSigned:
+        if(!parser.varint(value)) {
+          return false;
+        }
+        renderInteger(aOutput, (value >> 1u) + (value & 1u), (value & 1u) != 0u, base, fill);
+        break;
+      case LogBinary::cFloat: {
+        float number;
+        uint32_t bits;
+        if(!parser.littleEndian(value, sizeof(bits))) {
+          return false;
+        }
+        bits = static_cast<uint32_t>(value);
+        std::memcpy(&number, &bits, sizeof(number));
+        renderDouble(aOutput, number, fill);
+        break;
+      }
+      case LogBinary::cDouble: {
+        double number;
+        if(!parser.littleEndian(value, sizeof(value))) {
+          return false;
+        }
+        std::memcpy(&number, &value, sizeof(number));
+        renderDouble(aOutput, number, fill);
+        break;
+      }
+      case LogBinary::cLiteral: {
+        if(!parser.littleEndian(value, sizeof(uint32_t))) {
+          return false;
+        }
+        auto found = aDictionary.find(static_cast<uint32_t>(value));
+        if(found != aDictionary.end()) {
+          aOutput += found->second;
+        }
+        else {
+          char unknown[24];
+          std::snprintf(unknown, sizeof(unknown), "<literal %08x>", static_cast<uint32_t>(value));
+          aOutput += unknown;
+        }
+        break;
+      }
+      case LogBinary::cString:
+      case LogBinary::cTaskName:
+      case LogBinary::cTopic:
+        if(!parser.string(text)) {
+          return false;
+        }
+        aOutput += text;
+        break;
+      case LogBinary::cChar: {
+        uint8_t character;
+        if(!parser.byte(character)) {
+          return false;
+        }
+        aOutput += static_cast<char>(character);
+        break;
+      }
+      case LogBinary::cBool:
+        aOutput += follows ? "true" : "false";
+        break;
+      default:
+        return false;
+      }
+      if(type == LogBinary::cTaskId || type == LogBinary::cTaskName || type == LogBinary::cTick || type == LogBinary::cTopic || type == LogBinary::cWallClock) {
+        aOutput += ' ';
+      }
+      else { // nothing to do
+      }
+    }
+    return true;
+  }
+
+  std::string unescape(std::string const &aLine) {
+    std::string result;
+    for(size_t i = 1u; i < aLine.size(); ++i) {
+      if(aLine[i] == nowtech::LogBinary::cEscape && i + 1u < aLine.size()) {
+        ++i;
+        result += static_cast<char>(aLine[i] ^ nowtech::LogBinary::cEscapeFlip);
+      }
+      else {
+        result += aLine[i];
+      }
+    }
+    return result;
+  }
+}
+
+int main(int aArgc, char **aArgv) {
+  int argument = 1;
+  for(; argument < aArgc && aArgv[argument][0] == '-'; ++argument) {
+    if(std::strcmp(aArgv[argument], "-p") == 0) {
+      gBasePrefix = true;
+    }
+    else if(std::strcmp(aArgv[argument], "-s") == 0) {
+      gAlignSigned = true;
+    }
+    else if(std::strcmp(aArgv[argument], "-r") == 0) {
+      gRelativeTick = true;
+    }
+    else {
+      argument = aArgc;
+    }
+  }
+  if(argument >= aArgc || aArgc - argument > 2) {
+    std::fprintf(stderr, "Usage: %s [-p] [-s] [-r] <executable or dictionary> [log file]\n", aArgv[0]);
+    return 1;
+  }
+  std::map<uint32_t, std::string> dictionary;
+  if(!loadDictionary(aArgv[argument], dictionary)) {
+    std::fprintf(stderr, "Can not load dictionary from %s\n", aArgv[argument]);
+    return 1;
+  }
+  FILE * const input = argument + 1 < aArgc ? std::fopen(aArgv[argument + 1], "rb") : stdin;
+  if(input == nullptr) {
+    std::fprintf(stderr, "Can not open %s\n", aArgv[argument + 1]);
+    return 1;
+  }
+  std::string line;
+  std::string output;
+  int character;
+  while((character = std::fgetc(input)) != EOF) {
+    if(character != '\n') {
+      line += static_cast<char>(character);
+      continue;
+    }
+    if(line.empty() || line[0] != nowtech::LogBinary::cRecordStart) {
+      output = line;
+    }
+    else {
+      output.clear();
+      if(!decode(unescape(line), dictionary, output)) {
+        // Aborted messages are cut at a chunk boundary, possibly inside an item.
+        output.clear();
+        std::string record = unescape(line);
+        if(!record.empty() && record.back() == cSeparatorFailure) {
+          record.pop_back();
+        }
+        else { // nothing to do
+        }
+        decode(record, dictionary, output);
+        output += cSeparatorFailure;
+      }
+      else { // nothing to do
+      }
+    }
+    output += '\n';
+    std::fwrite(output.data(), 1u, output.size(), stdout);
+    line.clear();
+  }
+  return 0;
+}
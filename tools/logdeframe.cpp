@@ -0,0 +1,103 @@
+/*
+ * Copyright 2018 Now Technologies Zrt.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+ * THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "LogFramingSink.h"
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+// clang++ -std=c++14 -Isrc tools/logdeframe.cpp -O2 -o logdeframe
+// Usage: logdeframe [-b] < framed > plain
+// Decodes the SLIP frames of LogFramingSink. By default each frame is a
+// message and gets a line end. With -b the frames are whole buffers, like
+// compressed blocks, and are written as they are. Damaged frames are skipped,
+// and the damaged or lost frames are reported on stderr with their position.
+
+int main(int aArgc, char **aArgv) {
+  bool const buffers = aArgc > 1 && std::strcmp(aArgv[1], "-b") == 0;
+  if(aArgc > 2 || (aArgc == 2 && !buffers)) {
+    std::fprintf(stderr, "Usage: %s [-b] < framed > plain\n", aArgv[0]);
+    return 1;
+  }
+  std::string frame;
+  bool escaped = false;
+  bool first = true;
+  uint8_t expected = 0u;
+  uint64_t frames = 0u;
+  uint64_t damaged = 0u;
+  uint64_t lost = 0u;
+  int character;
+  while((character = std::fgetc(stdin)) != EOF) {
+    char const byte = static_cast<char>(character);
+    if(byte != nowtech::LogFramingSink::cEnd) {
+      if(escaped) {
+        escaped = false;
+        frame += byte == nowtech::LogFramingSink::cEscapedEnd ? nowtech::LogFramingSink::cEnd
+               : byte == nowtech::LogFramingSink::cEscapedEscape ? nowtech::LogFramingSink::cEscape : byte;
+      }
+      else if(byte == nowtech::LogFramingSink::cEscape) {
+        escaped = true;
+      }
+      else {
+        frame += byte;
+      }
+      continue;
+    }
+    escaped = false;
+    if(frame.empty()) {
+      continue;
+    }
+    uint16_t crc = nowtech::LogFramingSink::cCrcInitial;
+    for(size_t i = 0u; i + 2u < frame.size(); ++i) {
+      crc = nowtech::LogFramingSink::updateCrc(crc, frame[i]);
+    }
+    if(frame.size() < 3u || crc != static_cast<uint16_t>(static_cast<uint8_t>(frame[frame.size() - 2u]) | (static_cast<uint8_t>(frame.back()) << 8u))) {
+      ++damaged;
+      std::fprintf(stderr, "-=- damaged frame after frame %llu -=-\n", static_cast<unsigned long long>(frames));
+    }
+    else {
+      uint8_t const sequence = static_cast<uint8_t>(frame[0]);
+      if(!first && sequence != expected) {
+        uint8_t const gap = static_cast<uint8_t>(sequence - expected);
+        lost += gap;
+        std::fprintf(stderr, "-=- %u frames lost after frame %llu -=-\n", gap, static_cast<unsigned long long>(frames));
+      }
+      else { // nothing to do
+      }
+      first = false;
+      expected = static_cast<uint8_t>(sequence + 1u);
+      ++frames;
+      std::fwrite(frame.data() + 1u, 1u, frame.size() - 3u, stdout);
+      if(!buffers) {
+        std::fputc('\n', stdout);
+      }
+      else { // nothing to do
+      }
+    }
+    frame.clear();
+  }
+  std::fprintf(stderr, "%llu frames, %llu damaged, at least %llu lost\n", static_cast<unsigned long long>(frames),
+    static_cast<unsigned long long>(damaged), static_cast<unsigned long long>(lost));
+  return damaged + lost == 0u ? 0 : 2;
+}
@@ -0,0 +1,185 @@
+/*
+ * Copyright 2018 Now Technologies Zrt.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+ * THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "Log.h"
+#include <cstdio>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+// clang++ -std=c++14 -Isrc tools/logexpand.cpp -O2 -o logexpand
+// Usage: logexpand [-x] [-f fill] < compact > full
+// Restores the usual task tick topic headers of a log written with
+// LogConfig::compactHeader. -x is for hexadecimal ticks, and fill is the
+// minimum number of tick digits, like in LogConfig::tickFormat. The 0x prefix
+// of LogConfig::appendBasePrefix is kept from the keyframes.
+// Lines before the first full header are copied unchanged, as their
+// header can not be restored. So are lines without header.
+
+namespace {
+
+  uint32_t gBase = 10u;
+  int gFill = 0;
+
+  struct State final {
+    bool synchronized = false;
+    bool hasTick = false;
+    bool prefixed = false;
+    uint64_t tick = 0u;
+    std::string task;
+    std::string topic;
+  };
+
+  bool isDigit(char const aCharacter) {
+    return (aCharacter >= '0' && aCharacter <= '9') || (gBase == 16u && aCharacter >= 'a' && aCharacter <= 'f');
+  }
+
+  uint64_t parse(std::string const &aLine, size_t &aIndex) {
+    uint64_t result = 0u;
+    for(; aIndex < aLine.size() && isDigit(aLine[aIndex]); ++aIndex) {
+      result = result * gBase + static_cast<uint64_t>(aLine[aIndex] <= '9' ? aLine[aIndex] - '0' : aLine[aIndex] - 'a' + 10);
+    }
+    return result;
+  }
+
+  /// @return the index of the payload, or 0 if the header is invalid.
+  size_t update(std::string const &aLine, State &aState) {
+    bool const keyframe = aLine[0] == nowtech::Log::cHeaderKeyframe;
+    size_t index = 1u;
+    bool const negative = !keyframe && index < aLine.size() && aLine[index] == '-';
+    if(negative) {
+      ++index;
+    }
+    else { // nothing to do
+    }
+    if(keyframe && gBase == 16u && aLine.compare(index, 2u, "0x") == 0) {
+      // Only the keyframes have the prefix, never a digit.
+      index += 2u;
+      aState.prefixed = true;
+    }
+    else if(keyframe) {
+      aState.prefixed = false;
+    }
+    else { // nothing to do
+    }
+    if(index < aLine.size() && isDigit(aLine[index])) {
+      uint64_t const value = parse(aLine, index);
+      aState.tick = keyframe ? value : (negative ? aState.tick - value : aState.tick + value);
+      aState.hasTick = true;
+    }
+    else if(keyframe) {
+      aState.hasTick = false;
+    }
+    else { // nothing to do
+    }
+    if(keyframe) {
+      aState.task.clear();
+      aState.topic.clear();
+    }
+    else { // nothing to do
+    }
+    if(index < aLine.size() && aLine[index] == nowtech::Log::cHeaderTask) {
+      size_t const end = aLine.find_first_of(": ", index + 1u);
+      if(end == std::string::npos) {
+        return 0u;
+      }
+      aState.task = aLine.substr(index + 1u, end - index - 1u);
+      index = end;
+    }
+    else { // nothing to do
+    }
+    if(index < aLine.size() && aLine[index] == nowtech::Log::cHeaderTopic) {
+      size_t const end = aLine.find(' ', index + 1u);
+      if(end == std::string::npos) {
+        return 0u;
+      }
+      aState.topic = aLine.substr(index + 1u, end - index - 1u);
+      index = end;
+    }
+    else { // nothing to do
+    }
+    return index < aLine.size() && aLine[index] == ' ' ? index + 1u : 0u;
+  }
+
+  std::string render(uint64_t const aValue, bool const aPrefixed) {
+    char const * const format = gBase == 16u ? "%0*llx" : "%0*llu";
+    char buffer[24];
+    std::snprintf(buffer, sizeof(buffer), format, gFill, static_cast<unsigned long long>(aValue));
+    return aPrefixed ? std::string("0x") + buffer : std::string(buffer);
+  }
+}
+
+int main(int aArgc, char **aArgv) {
+  for(int i = 1; i < aArgc; ++i) {
+    if(std::strcmp(aArgv[i], "-x") == 0) {
+      gBase = 16u;
+    }
+    else if(std::strcmp(aArgv[i], "-f") == 0 && i + 1 < aArgc) {
+      ++i;
+      gFill = std::atoi(aArgv[i]);
+    }
+    else {
+      std::fprintf(stderr, "Usage: %s [-x] [-f fill] < compact > full\n", aArgv[0]);
+      return 1;
+    }
+  }
+  State state;
+  std::string line;
+  std::string output;
+  while(std::getline(std::cin, line)) {
+    output = line;
+    if(!line.empty() && (line[0] == nowtech::Log::cHeaderKeyframe || (line[0] == nowtech::Log::cHeaderDelta && state.synchronized))) {
+      State next = state;
+      size_t const payload = update(line, next);
+      if(payload > 0u) {
+        state = next;
+        state.synchronized = true;
+        output.clear();
+        if(!state.task.empty()) {
+          output += state.task + ' ';
+        }
+        else { // nothing to do
+        }
+        if(state.hasTick) {
+          output += render(state.tick, state.prefixed) + ' ';
+        }
+        else { // nothing to do
+        }
+        if(!state.topic.empty()) {
+          output += state.topic + ' ';
+        }
+        else { // nothing to do
+        }
+        output += line.substr(payload);
+      }
+      else { // nothing to do
+      }
+    }
+    else { // nothing to do
+    }
+    std::cout << output << '\n';
+  }
+  return 0;
+}
@@ -0,0 +1,90 @@
+/*
+ * Copyright 2018 Now Technologies Zrt.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+ * THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "LogMmapSink.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// clang++ -std=c++14 -Isrc tools/logringdump.cpp -O2 -o logringdump
+// Usage: logringdump <ring file> [newest MB]
+// Prints the contents of a LogMmapSink ring file in order, oldest first.
+// If the ring has wrapped, the first, possibly partial line is skipped. The
+// region of a write interrupted by a crash is left out.
+
+int main(int aArgc, char **aArgv) {
+  if(aArgc < 2) {
+    std::fprintf(stderr, "Usage: %s <ring file> [newest MB]\n", aArgv[0]);
+    return 1;
+  }
+  int const fd = open(aArgv[1], O_RDONLY);
+  struct stat status;
+  if(fd < 0 || fstat(fd, &status) != 0 || static_cast<size_t>(status.st_size) < sizeof(nowtech::LogMmapHeader)) {
+    std::fprintf(stderr, "Can not open %s\n", aArgv[1]);
+    return 1;
+  }
+  void * const memory = mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if(memory == MAP_FAILED) {
+    std::fprintf(stderr, "Can not map %s\n", aArgv[1]);
+    return 1;
+  }
+  nowtech::LogMmapHeader const &header = *static_cast<nowtech::LogMmapHeader const*>(memory);
+  if(std::memcmp(header.magic, nowtech::LogMmapHeader::cMagic, sizeof(header.magic)) != 0 || header.version != nowtech::LogMmapHeader::cVersion
+    || header.headerSize + header.capacity != static_cast<uint64_t>(status.st_size) || header.capacity == 0u) {
+    std::fprintf(stderr, "%s is not a log ring file\n", aArgv[1]);
+    return 1;
+  }
+  char const * const data = static_cast<char const*>(memory) + header.headerSize;
+  uint64_t const end = header.writePosition;
+  // An interrupted write may have overwritten the oldest bytes up to writeEnd - capacity.
+  uint64_t const start = header.writeEnd > header.capacity ? header.writeEnd - header.capacity : 0u;
+  uint64_t length = end > start ? end - start : 0u;
+  if(aArgc > 2) {
+    uint64_t const limit = std::strtoull(aArgv[2], nullptr, 10) * 1024u * 1024u;
+    length = limit < length ? limit : length;
+  }
+  else { // nothing to do
+  }
+  uint64_t position = end - length;
+  if(position > 0u) {
+    while(position < end && data[position % header.capacity] != '\n') {
+      ++position;
+    }
+    ++position;
+  }
+  else { // nothing to do
+  }
+  while(position < end) {
+    uint64_t const offset = position % header.capacity;
+    uint64_t const chunk = end - position < header.capacity - offset ? end - position : header.capacity - offset;
+    std::fwrite(data + offset, 1u, chunk, stdout);
+    position += chunk;
+  }
+  munmap(memory, static_cast<size_t>(status.st_size));
+  return 0;
+}
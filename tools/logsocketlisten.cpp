@@ -0,0 +1,154 @@
+/*
+ * Copyright 2018 Now Technologies Zrt.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+ * THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+// clang++ -std=c++14 tools/logsocketlisten.cpp -O2 -o logsocketlisten
+// Usage: logsocketlisten [-d] [-s delay_us] <path> > plain
+// Collector for LogUnixSocketSink, writes the received datagrams to stdout
+// as they are. Listens on a SOCK_SEQPACKET socket, or a SOCK_DGRAM one with
+// -d. For SOCK_SEQPACKET a new connection is accepted when the previous one
+// is closed. -s sleeps after each recvmmsg call to simulate a slow collector.
+// Stops on SIGINT or SIGTERM and reports the counts on stderr.
+
+namespace {
+
+constexpr unsigned cBatch = 64u;
+constexpr size_t cDatagramSize = 65536u;
+
+volatile std::sig_atomic_t gStop = 0;
+
+void stop(int) {
+  gStop = 1;
+}
+
+}
+
+int main(int aArgc, char **aArgv) {
+  bool datagram = false;
+  unsigned long delay = 0u;
+  char const *path = nullptr;
+  for(int i = 1; i < aArgc; ++i) {
+    if(std::strcmp(aArgv[i], "-d") == 0) {
+      datagram = true;
+    }
+    else if(std::strcmp(aArgv[i], "-s") == 0 && i + 1 < aArgc) {
+      delay = std::strtoul(aArgv[++i], nullptr, 10);
+    }
+    else if(path == nullptr) {
+      path = aArgv[i];
+    }
+    else {
+      path = nullptr;
+      break;
+    }
+  }
+  sockaddr_un address;
+  if(path == nullptr || std::strlen(path) >= sizeof(address.sun_path)) {
+    std::fprintf(stderr, "Usage: %s [-d] [-s delay_us] <path> > plain\n", aArgv[0]);
+    return 1;
+  }
+  struct sigaction action;
+  std::memset(&action, 0, sizeof(action));
+  action.sa_handler = stop;
+  sigaction(SIGINT, &action, nullptr);
+  sigaction(SIGTERM, &action, nullptr);
+  std::memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  std::strcpy(address.sun_path, path);
+  unlink(path);
+  int const listening = socket(AF_UNIX, datagram ? SOCK_DGRAM : SOCK_SEQPACKET, 0);
+  if(listening < 0 || bind(listening, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0
+    || (!datagram && listen(listening, 1) != 0)) {
+    std::perror(path);
+    return 1;
+  }
+  static char buffers[cBatch][cDatagramSize];
+  iovec vectors[cBatch];
+  mmsghdr messages[cBatch];
+  uint64_t datagrams = 0u;
+  uint64_t bytes = 0u;
+  uint64_t connections = 0u;
+  int connection = datagram ? listening : -1;
+  while(gStop == 0) {
+    if(connection < 0) {
+      connection = accept(listening, nullptr, nullptr);
+      if(connection >= 0) {
+        ++connections;
+      }
+      else { // nothing to do
+      }
+      continue;
+    }
+    else { // nothing to do
+    }
+    std::memset(messages, 0, sizeof(messages));
+    for(unsigned i = 0u; i < cBatch; ++i) {
+      vectors[i].iov_base = buffers[i];
+      vectors[i].iov_len = cDatagramSize;
+      messages[i].msg_hdr.msg_iov = vectors + i;
+      messages[i].msg_hdr.msg_iovlen = 1u;
+    }
+    int const count = recvmmsg(connection, messages, cBatch, MSG_WAITFORONE, nullptr);
+    // An empty SOCK_SEQPACKET datagram means the peer closed the connection.
+    bool closed = false;
+    if(count > 0) {
+      for(int i = 0; i < count; ++i) {
+        closed = closed || (!datagram && messages[i].msg_len == 0u);
+        std::fwrite(buffers[i], 1u, messages[i].msg_len, stdout);
+        bytes += messages[i].msg_len;
+        datagrams += messages[i].msg_len > 0u ? 1u : 0u;
+      }
+      std::fflush(stdout);
+      if(delay > 0u) {
+        usleep(delay);
+      }
+      else { // nothing to do
+      }
+    }
+    else if(!datagram && (count == 0 || errno != EINTR)) {
+      closed = true;
+    }
+    else { // nothing to do
+    }
+    if(closed) {
+      close(connection);
+      connection = -1;
+    }
+    else { // nothing to do
+    }
+  }
+  close(listening);
+  unlink(path);
+  std::fprintf(stderr, "%llu datagrams, %llu bytes, %llu connections\n", static_cast<unsigned long long>(datagrams),
+    static_cast<unsigned long long>(bytes), static_cast<unsigned long long>(connections));
+  return 0;
+}
@@ -0,0 +1,75 @@
+/*
+ * Copyright 2018 Now Technologies Zrt.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+ * THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "LogLz.h"
+#include <cstdio>
+#include <cstdint>
+#include <vector>
+
+// clang++ -std=c++14 -Isrc src/LogLz.cpp tools/logunz.cpp -O2 -o logunz
+// Usage: logunz < compressed > plain
+// Decompresses the output of LogCompressingSink. Stops at the first corrupt
+// or truncated block, after writing everything before it.
+
+int main() {
+  std::vector<char> input;
+  std::vector<char> output;
+  uint8_t header[nowtech::LogLz::cBlockHeaderLength];
+  uint64_t blocks = 0u;
+  int result = 0;
+  while(std::fread(header, 1u, sizeof(header), stdin) == sizeof(header)) {
+    if(header[0] != 'N' || header[1] != 'Z' || header[2] > nowtech::LogLz::cTypeStored) {
+      std::fprintf(stderr, "Bad block header after %llu blocks\n", static_cast<unsigned long long>(blocks));
+      result = 1;
+      break;
+    }
+    else { // nothing to do
+    }
+    uint32_t const rawLength = header[4] | (header[5] << 8u) | (header[6] << 16u) | (static_cast<uint32_t>(header[7]) << 24u);
+    uint32_t const payloadLength = header[8] | (header[9] << 8u) | (header[10] << 16u) | (static_cast<uint32_t>(header[11]) << 24u);
+    input.resize(payloadLength);
+    if(std::fread(input.data(), 1u, payloadLength, stdin) != payloadLength) {
+      std::fprintf(stderr, "Truncated block after %llu blocks\n", static_cast<unsigned long long>(blocks));
+      result = 1;
+      break;
+    }
+    else { // nothing to do
+    }
+    if(header[2] == nowtech::LogLz::cTypeStored) {
+      std::fwrite(input.data(), 1u, payloadLength, stdout);
+    }
+    else {
+      output.resize(rawLength);
+      if(nowtech::LogLz::decompress(input.data(), payloadLength, output.data(), rawLength) != rawLength) {
+        std::fprintf(stderr, "Corrupt block after %llu blocks\n", static_cast<unsigned long long>(blocks));
+        result = 1;
+        break;
+      }
+      else { // nothing to do
+      }
+      std::fwrite(output.data(), 1u, rawLength, stdout);
+    }
+    ++blocks;
+  }
+  return result;
+}